@@ -1,5 +1,7 @@
 #include "agents.h"
 #include "inference.h"
+#include "profiler.h"
+#include "rng.h"
 
 
 #include <iostream>
@@ -29,6 +31,7 @@ bool NNAgent::isNNAgent() const {
 // returns number of episodes finished in this round
 int GameAgent::makeBatchActions(int batch_size, vector<EnvState*>* active_states, vector<bool>* finished_episodes,
 	int* player1_wins, int* player2_wins, Session* session) const {
+	PROFILE_SCOPE(MAKE_BATCH_ACTIONS);
 
 	ASSERT(active_states != NULL, "Active states must not be null");
 	ASSERT(finished_episodes != NULL, "Finished episodes must not be null");
@@ -45,11 +48,10 @@ int GameAgent::makeBatchActions(int batch_size, vector<EnvState*>* active_states
 		}
 
 		// if still active, must make a move
-		EnvState* state = active_states->at(episode_num);
-		int action = this->getAction(state);
-		EnvState* next_state = state->nextState(action);
-		active_states->at(episode_num) = next_state;
-		delete state;
+		// take the action in place, so that no state is allocated per move
+		EnvState* next_state = active_states->at(episode_num);
+		int action = this->getAction(next_state);
+		next_state->applyAction(action);
 
 		// if this move finishes the episode, mark it finished and mark the winner
 		if (next_state->isTerminalState()) {
@@ -101,6 +103,7 @@ Session* NNAgent::createSession() const {
 
 int NNAgent::makeBatchActions(int batch_size, vector<EnvState*>* active_states, vector<bool>* finished_episodes,
 	int* player1_wins, int* player2_wins, Session* session) const {
+	PROFILE_SCOPE(MAKE_BATCH_ACTIONS);
 
 	ASSERT(active_states != NULL, "Active states must not be null");
 	ASSERT(finished_episodes != NULL, "Finished episodes must not be null");
@@ -146,11 +149,9 @@ int NNAgent::makeBatchActions(int batch_size, vector<EnvState*>* active_states,
 			continue;
 		}
 
-		EnvState* state = active_states->at(episode_num);
+		EnvState* next_state = active_states->at(episode_num);
 		int action = chosen_actions[episode_num];
-		EnvState* next_state = state->nextState(action);
-		active_states->at(episode_num) = next_state;
-		delete state;
+		next_state->applyAction(action);
 
 		// if this episode is now finished, mark it so
 		if (next_state->isTerminalState()) {
@@ -222,6 +223,12 @@ MCTSAgent::MCTSAgent(const ArgMap& arg_map) {
 	this->max_depth = arg_map.getInt("max_depth", DEFAULT_MAX_DEPTH);
 	cout << "max_depth " << this->max_depth << endl;
 	this->use_rave = arg_map.getBool("use_rave", DEFAULT_USE_RAVE);
+	this->fill_rollouts = arg_map.getBool("fill_rollouts", DEFAULT_FILL_ROLLOUTS);
+	this->use_transpositions = arg_map.getBool("use_transpositions", DEFAULT_USE_TRANSPOSITIONS);
+	this->rollouts_per_leaf = arg_map.getInt("rollouts_per_leaf", DEFAULT_ROLLOUTS_PER_LEAF);
+	this->search_threads = arg_map.getInt("search_threads", DEFAULT_SEARCH_THREADS);
+	this->ensemble_trees = arg_map.getInt("ensemble_trees", DEFAULT_ENSEMBLE_TREES);
+	this->virtual_loss = arg_map.getDouble("virtual_loss", DEFAULT_VIRTUAL_LOSS);
 	this->sample_actions = arg_map.getBool("sample_actions", DEFAULT_SAMPLE_ACTIONS);
 	this->c_b = arg_map.getDouble("c_b", DEFAULT_C_B);
 	this->c_rave = arg_map.getDouble("c_rave", DEFAULT_C_RAVE);
@@ -230,34 +237,37 @@ MCTSAgent::MCTSAgent(const ArgMap& arg_map) {
 
 int MCTSAgent::getAction(EnvState* state) const {
 
-	MCTS_Node* node = new MCTS_Node(state, true /* is_root */, this->num_simulations, this->sample_actions, false /* requires_nn */, this->use_rave,
-		this->c_b, this->c_rave);
+	// the root owns (and deletes) its state, so it searches from a copy of the episode's state
+	MCTS_Node* node = new MCTS_Node(state->clone(), true /* is_root */, this->num_simulations, this->sample_actions, false /* requires_nn */, this->use_rave,
+		this->c_b, this->c_rave, DEFAULT_W_A, this->fill_rollouts, this->use_transpositions, this->virtual_loss,
+		this->rollouts_per_leaf);
 
-	node = runAllSimulations(node, this->max_depth);
-
-	// argmax over mean reward
-	vector<double>* mean_rewards = new vector<double>(node->getState()->numActions(), 0.0);
-	node->getMeanRewards(mean_rewards);
+	// search independent trees of the state at once (if there are several), and merge their stats.
+	// the threads of each tree (if there are several) all search that one tree
+	vector<int> action_counts;
+	vector<double> mean_rewards;
+	node = runEnsembleSimulations(node, this->ensemble_trees, this->max_depth, &action_counts, &mean_rewards, this->search_threads);
 
 	// print some debug info
-	vector<int>* action_counts = node->getActionCounts();
 	int dim = (int) sqrt(node->getState()->numActions());
-	//printVector(*action_counts, "Master Action counts:", dim);
+	//printVector(action_counts, "Master Action counts:", dim);
 	//node->printMeanReward();
 	//node->printExplorationTerm();
 	
 	// choose best action
 	int action;
 	if (state->turn() == 1) {
-		action = argmax(*mean_rewards);
+		action = argmax(mean_rewards);
 	} else {
-		action = argmin(*mean_rewards);
+		action = argmin(mean_rewards);
 	}
 	//int action = argmax(action_counts);
 
 	if (!state->isLegalAction(action)) {
 		action = state->randomAction();
 	}
+
+	delete node;
 	
 	return action;
 
@@ -377,6 +387,7 @@ pair<int, int> runNNEpisodes(int num_episodes, const GameAgent& p1_agent, const
     --p2_model_dir <path to NN model to be used for Agent 2> [unnecessary for non-NN Player 2 Agents] \
     \
     --log_every <logging frequency F> [optional, prints a message after F episodes are run; defaults to 10] \
+    --seed <seed of the random number generators; runs with the same seed are identical> [optional; if omitted, every run differs] \
 
     Example:
 
@@ -397,11 +408,14 @@ pair<int, int> runNNEpisodes(int num_episodes, const GameAgent& p1_agent, const
 
 int main(int argc, char* argv[]) {
 
-	srand(time(NULL));
-
 	// parse all command line arguments into an ArgMap instance
 	ArgMap arg_map;
 	parseArgs(argc, argv, &arg_map);
+	profiler_on = arg_map.getBool("profile", DEFAULT_PROFILE);
+	int seed = arg_map.getInt("seed", DEFAULT_SEED);
+	if (seed != -1) {
+		seedRng(seed);
+	}
 
 	int num_episodes = arg_map.getInt("num_episodes");
 
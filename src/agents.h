@@ -112,7 +112,11 @@ public:
 
 /**
  * Chooses actions from a state by running several MCTS simulations, each from this state,
- * and then choosing the most visited action from the root node.
+ * and then choosing the action with the best mean reward from the root node.
+ * With the "ensemble_trees" option, several independent trees of the state are searched at once (one per thread),
+ * and their root stats are merged before choosing (see runEnsembleSimulations).
+ * With the "use_transpositions" option, move orders that reach the same position share one node (see TranspositionTable);
+ * it is off by default, since it costs a canonical hash per expansion and a table per tree, and transpositions are rare at small depths.
  */
 class MCTSAgent: public GameAgent {
 
@@ -132,6 +136,12 @@ private:
 	bool sample_actions;
 	double c_b;
 	double c_rave;
+	bool fill_rollouts;
+	bool use_transpositions;
+	int rollouts_per_leaf;
+	int search_threads;
+	int ensemble_trees;
+	double virtual_loss;
 };
 
 
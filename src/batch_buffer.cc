@@ -0,0 +1,150 @@
+#include "batch_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/* Returns SIZE rounded up to a whole number of cache lines. */
+static size_t cacheLineAligned(size_t size) {
+	return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+
+BatchBuffer::BatchBuffer(int capacity, const vector<int>& input_sizes, int output_size, const string& shm_name) {
+	ASSERT(shm_name.empty() || shm_name[0] == '/', "The name of a shared memory segment must start with a /, unlike " << shm_name);
+	this->_shm_name = shm_name;
+	this->_owns_segment = !shm_name.empty();
+	this->setLayout(capacity, input_sizes, output_size, true);
+	this->map(true, true);
+}
+
+BatchBuffer::BatchBuffer(int capacity, const vector<float*>& inputs, const vector<int>& input_sizes, int output_size) {
+	ASSERT(inputs.size() == input_sizes.size(), "Must have a region for each of the " << input_sizes.size() << " input fields");
+	this->_shm_name = "";
+	this->_owns_segment = false;
+	this->setLayout(capacity, input_sizes, output_size, false);
+	this->map(true, false);
+	for (int field = 0; field < inputs.size(); field++) {
+		ASSERT(inputs[field] != NULL, "Cannot use a null region for input field " << field);
+		this->_inputs[field] = inputs[field];
+	}
+}
+
+BatchBuffer::BatchBuffer(const string& shm_name) {
+	this->_shm_name = shm_name;
+	this->_owns_segment = false;
+
+	// the layout is read from the header at the start of the segment
+	int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+	ASSERT(fd >= 0, "Unable to open the shared memory segment " << shm_name << ": " << strerror(errno));
+	BatchBufferHeader header;
+	ssize_t num_read = pread(fd, &header, sizeof(header), 0);
+	close(fd);
+	ASSERT(num_read == sizeof(header) && header.magic == BATCH_BUFFER_MAGIC, shm_name << " is not a batch buffer");
+	vector<int> input_sizes(header.input_sizes, header.input_sizes + header.num_inputs);
+	this->setLayout(header.capacity, input_sizes, header.output_size, true);
+	this->map(false, true);
+}
+
+BatchBuffer::~BatchBuffer() {
+	munmap(this->_memory, this->_memory_size);
+	if (this->_owns_segment) {
+		shm_unlink(this->_shm_name.c_str());
+	}
+}
+
+void BatchBuffer::setLayout(int capacity, const vector<int>& input_sizes, int output_size, bool own_inputs) {
+	ASSERT(capacity > 0, "A batch buffer must have room for at least one row, not " << capacity);
+	ASSERT(0 < input_sizes.size() && input_sizes.size() <= BATCH_BUFFER_MAX_INPUTS,
+		"A batch buffer must have between 1 and " << BATCH_BUFFER_MAX_INPUTS << " input fields, not " << input_sizes.size());
+	ASSERT(output_size > 0, "Each row must have at least one output");
+
+	memset(&this->_header, 0, sizeof(BatchBufferHeader));
+	this->_header.magic = BATCH_BUFFER_MAGIC;
+	this->_header.capacity = capacity;
+	this->_header.num_inputs = input_sizes.size();
+	this->_header.output_size = output_size;
+	this->_memory_size = cacheLineAligned(sizeof(BatchBufferHeader));
+	for (int field = 0; field < input_sizes.size(); field++) {
+		ASSERT(input_sizes[field] > 0, "Input field " << field << " must hold at least one value per row");
+		this->_header.input_sizes[field] = input_sizes[field];
+		if (own_inputs) {
+			this->_memory_size += cacheLineAligned((size_t) capacity * input_sizes[field] * sizeof(float));
+		}
+	}
+	this->_memory_size += cacheLineAligned((size_t) capacity * output_size * sizeof(float));
+}
+
+void BatchBuffer::map(bool create, bool own_inputs) {
+	if (this->_shm_name.empty()) {
+		this->_memory = mmap(NULL, this->_memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	else {
+		int fd = shm_open(this->_shm_name.c_str(), create ? (O_RDWR | O_CREAT | O_EXCL) : O_RDWR, 0600);
+		ASSERT(fd >= 0, "Unable to open the shared memory segment " << this->_shm_name << ": " << strerror(errno));
+		struct stat segment;
+		if (create) {
+			int status = ftruncate(fd, this->_memory_size);
+			ASSERT(status == 0, "Unable to size the shared memory segment " << this->_shm_name << ": " << strerror(errno));
+		}
+		else {
+			fstat(fd, &segment);
+			ASSERT(segment.st_size == this->_memory_size, "The shared memory segment " << this->_shm_name << " is the wrong size for its layout");
+		}
+		this->_memory = mmap(NULL, this->_memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+	}
+	ASSERT(this->_memory != MAP_FAILED, "Unable to map " << this->_memory_size << " bytes for a batch buffer: " << strerror(errno));
+	if (create) {
+		memcpy(this->_memory, &this->_header, sizeof(BatchBufferHeader));
+	}
+
+	// the regions follow the header, in order, each on fresh cache lines
+	char* region = (char*) this->_memory + cacheLineAligned(sizeof(BatchBufferHeader));
+	for (int field = 0; field < this->_header.num_inputs; field++) {
+		this->_inputs[field] = NULL;
+		if (own_inputs) {
+			this->_inputs[field] = (float*) region;
+			region += cacheLineAligned((size_t) this->_header.capacity * this->_header.input_sizes[field] * sizeof(float));
+		}
+	}
+	this->_outputs = (float*) region;
+}
+
+int BatchBuffer::capacity() const {
+	return this->_header.capacity;
+}
+
+int BatchBuffer::numInputs() const {
+	return this->_header.num_inputs;
+}
+
+int BatchBuffer::inputSize(int field) const {
+	ASSERT(0 <= field && field < this->_header.num_inputs, "There is no input field " << field);
+	return this->_header.input_sizes[field];
+}
+
+int BatchBuffer::outputSize() const {
+	return this->_header.output_size;
+}
+
+float* BatchBuffer::input(int field, int row) {
+	ASSERT(0 <= field && field < this->_header.num_inputs, "There is no input field " << field);
+	ASSERT(0 <= row && row < this->_header.capacity, "Row " << row << " is out of range in a buffer of " << this->_header.capacity);
+	return this->_inputs[field] + (size_t) row * this->_header.input_sizes[field];
+}
+
+float* BatchBuffer::output(int row) {
+	ASSERT(0 <= row && row < this->_header.capacity, "Row " << row << " is out of range in a buffer of " << this->_header.capacity);
+	return this->_outputs + (size_t) row * this->_header.output_size;
+}
+
+const string& BatchBuffer::shmName() const {
+	return this->_shm_name;
+}
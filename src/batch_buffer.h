@@ -0,0 +1,103 @@
+#ifndef BATCH_BUFFER_H
+#define BATCH_BUFFER_H
+
+#include "utils.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+
+/* The most input fields a batch buffer can have (the NN inputs fed separately, such as the board planes and the turn mask). */
+const int BATCH_BUFFER_MAX_INPUTS = 4;
+
+/* The layout of a batch buffer, which starts a shared memory segment so that a process attaching to it can find its regions. */
+struct BatchBufferHeader {
+	uint32_t magic;
+	uint32_t capacity;
+	uint32_t num_inputs;
+	uint32_t input_sizes[BATCH_BUFFER_MAX_INPUTS];
+	uint32_t output_size;
+};
+
+/* The magic number that starts a batch buffer's segment, which changes whenever its layout does. */
+const uint32_t BATCH_BUFFER_MAGIC = 0x31424248; // "HBB1"
+
+
+/**
+ * Preallocated float32 memory for one NN batch of up to CAPACITY rows: a region per input field, holding INPUT_SIZES[f] values
+ * for each row, and a region holding OUTPUT_SIZE values (the action probabilities) for each row.  Every region is row-major,
+ * and starts on its own cache line, so row R of a field is the R-th slice of the tensor an NN is fed.
+ *
+ * Worker threads encode their states straight into their rows, and the evaluator runs the NN on the regions in place, and
+ * writes its outputs back into the buffer, so nothing is copied between the encoding and the inference.
+ *
+ * The memory is either the buffer's own mapping (which can be a named POSIX shared memory segment, so that an evaluator
+ * process can map the same memory), or memory that someone else owns, such as the tensors an NN is fed.
+ * In a segment, the regions follow a BatchBufferHeader, and each starts at the next multiple of CACHE_LINE_SIZE bytes.
+ */
+class BatchBuffer {
+
+public:
+
+	/**
+	 * Maps zeroed memory for CAPACITY rows of the given layout.  If SHM_NAME is not empty (it must start with a "/"), the
+	 * memory is a new shared memory segment of that name, which is removed again when the buffer is deleted.
+	 */
+	BatchBuffer(int capacity, const vector<int>& input_sizes, int output_size, const string& shm_name="");
+
+	/* Uses INPUTS[f] (which must outlive the buffer) as the region of input field f, and maps memory for the outputs only. */
+	BatchBuffer(int capacity, const vector<float*>& inputs, const vector<int>& input_sizes, int output_size);
+
+	/* Maps the existing shared memory segment SHM_NAME, which was created by a BatchBuffer (possibly in another process). */
+	BatchBuffer(const string& shm_name);
+
+	/* Unmaps the buffer's memory, and removes its segment if it created one. */
+	~BatchBuffer();
+
+	/* Returns the number of rows the buffer has room for. */
+	int capacity() const;
+
+	/* Returns the number of input fields. */
+	int numInputs() const;
+
+	/* Returns the number of values that input field FIELD holds for each row. */
+	int inputSize(int field) const;
+
+	/* Returns the number of outputs each row holds. */
+	int outputSize() const;
+
+	/* Returns the values of input field FIELD for row ROW (inputSize(FIELD) of them, followed by those of the next row). */
+	float* input(int field, int row);
+
+	/* Returns the outputs of row ROW (outputSize() of them, followed by those of the next row). */
+	float* output(int row);
+
+	/* Returns the name of the buffer's shared memory segment, or "" if it is not in one. */
+	const string& shmName() const;
+
+private:
+
+	/* Sets up the layout, and computes the size in bytes of the mapping (the regions of the fields in OWN_INPUTS, and the outputs). */
+	void setLayout(int capacity, const vector<int>& input_sizes, int output_size, bool own_inputs);
+
+	/* Maps the memory (in the segment, if there is one), and points the regions into it. */
+	void map(bool create, bool own_inputs);
+
+	BatchBufferHeader _header;
+	float* _inputs[BATCH_BUFFER_MAX_INPUTS];
+	float* _outputs;
+
+	string _shm_name;
+	/* Whether deleting the buffer removes its segment. */
+	bool _owns_segment;
+	void* _memory;
+	size_t _memory_size;
+
+};
+
+
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+#include <string.h> // memset
+
+#if defined(__BMI2__)
+#include <immintrin.h> // _pdep_u64
+#endif
+
+using namespace std;
+
+
+/* Number of 64-bit words in a Bitboard.  Six words hold 384 cells, which covers boards up to 19 x 19. */
+const int BITBOARD_NUM_WORDS = 6;
+
+/* The largest number of cells (positions) that a Bitboard can represent. */
+const int BITBOARD_MAX_CELLS = BITBOARD_NUM_WORDS * 64;
+
+
+/**
+ * A fixed-size set of board positions, stored as a multi-word bitmask.
+ * Bit K of the mask is set if position K is in the set (position K lives in word K / 64, at bit K % 64).
+ * Boards of up to 8 x 8 fit in the first word; larger boards spill over into the following words.
+ * The mask lives inline (no heap memory), so copying a Bitboard is a flat copy of a few words.
+ *
+ * The small, hot methods are defined inline at the bottom of this header, since they run on every move of every rollout.
+ */
+class Bitboard {
+
+public:
+
+	/* Creates an empty Bitboard. */
+	Bitboard();
+
+	/* Creates a Bitboard whose first NUM_BITS positions are all set. NUM_BITS must be between 0 and BITBOARD_MAX_CELLS. */
+	static Bitboard full(int num_bits);
+
+	/* Returns true if position POS is in the set. */
+	bool test(int pos) const;
+
+	/* Adds position POS to the set. */
+	void set(int pos);
+
+	/* Removes position POS from the set. */
+	void clear(int pos);
+
+	/* Returns the number of positions in the set (uses popcount on each word). */
+	int count() const;
+
+	/* Returns true if the set is empty. */
+	bool empty() const;
+
+	/**
+	 * Returns the K-th smallest position in the set (K is 0-indexed).
+	 * Uses pdep to select the K-th set bit of a word when the CPU supports BMI2, and a bit-clearing loop otherwise.
+	 * Returns -1 if K is not smaller than count().
+	 */
+	int select(int k) const;
+
+	/* Returns the smallest position in the set, or -1 if the set is empty. */
+	int first() const;
+
+	/* Returns the smallest position in the set that is larger than POS, or -1 if there is none. */
+	int next(int pos) const;
+
+	/* Returns the positions in this set or in OTHER. */
+	Bitboard operator|(const Bitboard& other) const;
+
+	/* Returns the positions in both this set and OTHER. */
+	Bitboard operator&(const Bitboard& other) const;
+
+	/* Returns the positions in this set that are not in OTHER. */
+	Bitboard andNot(const Bitboard& other) const;
+
+	/* Returns the set with every position moved up by N (position K becomes K + N).  N must be between 0 and 63. */
+	Bitboard shiftUp(int n) const;
+
+	/* Returns the set with every position moved down by N (position K becomes K - N).  N must be between 0 and 63. */
+	Bitboard shiftDown(int n) const;
+
+	/* Returns true if this set and OTHER contain exactly the same positions. */
+	bool operator==(const Bitboard& other) const;
+
+	/* Returns true if this set and OTHER differ. */
+	bool operator!=(const Bitboard& other) const;
+
+	/* Returns the K-th 64-bit word of the mask. */
+	uint64_t word(int k) const;
+
+private:
+
+	uint64_t _words[BITBOARD_NUM_WORDS];
+
+};
+
+
+/**
+ * Returns the position of the K-th (0-indexed) set bit in WORD.
+ * Expects WORD to have more than K bits set.
+ */
+inline int selectBitInWord(uint64_t word, int k) {
+#if defined(__BMI2__)
+	return __builtin_ctzll(_pdep_u64(1ULL << k, word));
+#else
+	for (int i = 0; i < k; i++) {
+		word &= word - 1; // clear the lowest set bit
+	}
+	return __builtin_ctzll(word);
+#endif
+}
+
+
+
+/***** Inline definitions *****/
+
+inline Bitboard::Bitboard() {
+	memset(this->_words, 0, sizeof(this->_words));
+}
+
+inline Bitboard Bitboard::full(int num_bits) {
+	Bitboard result;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		int bits_in_word = num_bits - (w * 64);
+		if (bits_in_word >= 64) {
+			result._words[w] = ~0ULL;
+		} else if (bits_in_word > 0) {
+			result._words[w] = (1ULL << bits_in_word) - 1;
+		}
+	}
+	return result;
+}
+
+inline bool Bitboard::test(int pos) const {
+	return (this->_words[pos >> 6] >> (pos & 63)) & 1ULL;
+}
+
+inline void Bitboard::set(int pos) {
+	this->_words[pos >> 6] |= (1ULL << (pos & 63));
+}
+
+inline void Bitboard::clear(int pos) {
+	this->_words[pos >> 6] &= ~(1ULL << (pos & 63));
+}
+
+inline int Bitboard::count() const {
+	int total = 0;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		total += __builtin_popcountll(this->_words[w]);
+	}
+	return total;
+}
+
+inline bool Bitboard::empty() const {
+	uint64_t any = 0;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		any |= this->_words[w];
+	}
+	return any == 0;
+}
+
+inline int Bitboard::select(int k) const {
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		int word_count = __builtin_popcountll(this->_words[w]);
+		if (k < word_count) {
+			return (w << 6) + selectBitInWord(this->_words[w], k);
+		}
+		k -= word_count;
+	}
+	return -1;
+}
+
+inline int Bitboard::first() const {
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		if (this->_words[w] != 0) {
+			return (w << 6) + __builtin_ctzll(this->_words[w]);
+		}
+	}
+	return -1;
+}
+
+inline int Bitboard::next(int pos) const {
+	pos += 1;
+	int w = pos >> 6;
+	if (w >= BITBOARD_NUM_WORDS) {
+		return -1;
+	}
+	uint64_t rest = this->_words[w] & (~0ULL << (pos & 63));
+	while (true) {
+		if (rest != 0) {
+			return (w << 6) + __builtin_ctzll(rest);
+		}
+		w += 1;
+		if (w >= BITBOARD_NUM_WORDS) {
+			return -1;
+		}
+		rest = this->_words[w];
+	}
+}
+
+inline Bitboard Bitboard::operator|(const Bitboard& other) const {
+	Bitboard result;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		result._words[w] = this->_words[w] | other._words[w];
+	}
+	return result;
+}
+
+inline Bitboard Bitboard::operator&(const Bitboard& other) const {
+	Bitboard result;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		result._words[w] = this->_words[w] & other._words[w];
+	}
+	return result;
+}
+
+inline Bitboard Bitboard::andNot(const Bitboard& other) const {
+	Bitboard result;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		result._words[w] = this->_words[w] & ~other._words[w];
+	}
+	return result;
+}
+
+inline Bitboard Bitboard::shiftUp(int n) const {
+	if (n == 0) {
+		return *this;
+	}
+	Bitboard result;
+	result._words[0] = this->_words[0] << n;
+	for (int w = 1; w < BITBOARD_NUM_WORDS; w++) {
+		result._words[w] = (this->_words[w] << n) | (this->_words[w - 1] >> (64 - n));
+	}
+	return result;
+}
+
+inline Bitboard Bitboard::shiftDown(int n) const {
+	if (n == 0) {
+		return *this;
+	}
+	Bitboard result;
+	for (int w = 0; w < BITBOARD_NUM_WORDS - 1; w++) {
+		result._words[w] = (this->_words[w] >> n) | (this->_words[w + 1] << (64 - n));
+	}
+	result._words[BITBOARD_NUM_WORDS - 1] = this->_words[BITBOARD_NUM_WORDS - 1] >> n;
+	return result;
+}
+
+inline bool Bitboard::operator==(const Bitboard& other) const {
+	uint64_t diff = 0;
+	for (int w = 0; w < BITBOARD_NUM_WORDS; w++) {
+		diff |= this->_words[w] ^ other._words[w];
+	}
+	return diff == 0;
+}
+
+inline bool Bitboard::operator!=(const Bitboard& other) const {
+	return !(*this == other);
+}
+
+inline uint64_t Bitboard::word(int k) const {
+	return this->_words[k];
+}
+
+
+
+#endif
@@ -15,19 +15,33 @@ int DEFAULT_NUM_STATES = 4096;
 int DEFAULT_NUM_SIMULATIONS = 1000;
 int DEFAULT_MAX_DEPTH = 4;
 
+int DEFAULT_ARENA_CHUNK_SIZE = 256 * 1024;
+int DEFAULT_TRANSPOSITIONS_PER_SIMULATION = 4;
+
 int DEFAULT_MINIBATCH_SIZE = 256;
+int DEFAULT_MAX_IN_FLIGHT = 1;
+int DEFAULT_PIPELINE_GROUPS = 1;
+int DEFAULT_INFERENCE_WAIT_US = 2000;
+int DEFAULT_EVALUATOR_CONNECT_TIMEOUT_MS = 60000;
 int DEFAULT_NUM_THREADS = 4;
+int DEFAULT_SEARCH_THREADS = 1;
+int DEFAULT_ENSEMBLE_TREES = 1;
 int DEFAULT_LOG_EVERY = 512;
+int DEFAULT_SEED = -1;
 
 int DEFAULT_STATES_PER_FILE = pow(2, 20);
 
 bool DEFAULT_SAMPLE_ACTIONS = true;
 bool DEFAULT_REQUIRES_NN = false;
 bool DEFAULT_USE_RAVE = true;
+bool DEFAULT_FILL_ROLLOUTS = true;
+bool DEFAULT_USE_TRANSPOSITIONS = false;
+int DEFAULT_ROLLOUTS_PER_LEAF = 1;
 
 double DEFAULT_C_B = 0.03;
 double DEFAULT_C_RAVE = 3000;
 double DEFAULT_W_A = 40;
+double DEFAULT_VIRTUAL_LOSS = 1;
 
 int DEFAULT_START_AT = 0;
 
@@ -35,6 +49,8 @@ int DEFAULT_NN_BATCH_SIZE = 128;
 
 bool DEFAULT_DISPLAY_STATE = false;
 
+bool DEFAULT_PROFILE = true;
+
 string DEFAULT_PROFILER_LOG_PATH = "profiler_log.txt";
 
 
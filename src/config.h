@@ -24,14 +24,28 @@ extern int DEFAULT_MAX_DEPTH; // default depth to expand the MCTS tree before pe
 extern bool DEFAULT_SAMPLE_ACTIONS; // the default of whether MCTS should sample actions proportional to scores or act greedily (True; samples actions)
 extern bool DEFAULT_REQUIRES_NN; // the default of whether MCTS is bootstrapped with a neural network apprentice (False)
 extern bool DEFAULT_USE_RAVE; // the default of whether MCTS uses Rapid Value Estimation (RAVE)
+extern bool DEFAULT_FILL_ROLLOUTS; // the default of whether MCTS rollouts fill the board in one go, when the game supports it (True)
+extern bool DEFAULT_USE_TRANSPOSITIONS; // the default of whether MCTS shares one node between move orders that reach the same position (False)
+extern int DEFAULT_ROLLOUTS_PER_LEAF; // the default number of rollouts MCTS plays from each leaf it reaches, whose results are propagated up the tree together (1)
 
 extern double DEFAULT_C_B; // the default for the hyperparameter that weighs MCTS exploration vs exploitation (0.05)
 extern double DEFAULT_C_RAVE; // the default for the hyperparameter that governs how fast RAVE is downweighted as the number of samples increase (3000)
 extern double DEFAULT_W_A; // the default for the hyperparameter that weighs the apprentice (NN) predictions against MCTS (40)
+extern double DEFAULT_VIRTUAL_LOSS; // the default reward (normalized) that tree-parallel MCTS counts as lost on each edge a thread is still searching below (1)
+
+extern int DEFAULT_ARENA_CHUNK_SIZE; // the default size in bytes of each chunk that an MCTS tree's node arena allocates (256 KB)
+extern int DEFAULT_TRANSPOSITIONS_PER_SIMULATION; // the default number of transposition table slots an MCTS tree reserves per simulation (4)
 
 extern int DEFAULT_MINIBATCH_SIZE; // the default minibatch size for querying the NN apprentice (128)
+extern int DEFAULT_MAX_IN_FLIGHT; // the default number of NN evaluations that each N-MCTS tree may wait on at once (1)
+extern int DEFAULT_PIPELINE_GROUPS; // the default number of groups each N-MCTS worker splits its trees into, to search one group while another is evaluated (1)
+extern int DEFAULT_INFERENCE_WAIT_US; // the default longest time in microseconds that an NN request waits for the rest of its inference batch (2000)
+extern int DEFAULT_EVALUATOR_CONNECT_TIMEOUT_MS; // the default longest time in milliseconds to wait for an evaluator process to accept a connection, while it loads its model (60000)
 extern int DEFAULT_NUM_THREADS; // the default number of worker threads to use to parallelize MCTS (4)
+extern int DEFAULT_SEARCH_THREADS; // the default number of threads that search a single MCTS tree together (1)
+extern int DEFAULT_ENSEMBLE_TREES; // the default number of independent MCTS trees (one per thread) whose stats are merged to choose each move (1)
 extern int DEFAULT_LOG_EVERY; // the default number of states after which to log (512)
+extern int DEFAULT_SEED; // the default seed of the run's random number generators (-1; seeds them from the system, so every run differs)
 
 extern int DEFAULT_STATES_PER_FILE; // the default number of states to write to each output file (1024)
 extern int DEFAULT_START_AT; // the default file number from which to start reading states (0; means start reading from 0.csv in the given data directory)
@@ -40,5 +54,7 @@ extern int DEFAULT_NN_BATCH_SIZE; // how many states to send to the NN for infer
 
 extern bool DEFAULT_DISPLAY_STATE; // whether to display the state during episodes
 
+extern bool DEFAULT_PROFILE; // whether to profile blocks of code (cheap enough to leave on, see profiler.h)
+
 extern string DEFAULT_PROFILER_LOG_PATH; // file to log the profiler info
 #endif
@@ -5,6 +5,128 @@
 
 using namespace std;
 
+
+int EnvState::legalActions(int* actions) const {
+	int num_legal = 0;
+	for (int action = 0; action < this->numActions(); action++) {
+		if (this->isLegalAction(action)) {
+			actions[num_legal] = action;
+			num_legal += 1;
+		}
+	}
+	return num_legal;
+}
+
+uint64_t EnvState::canonicalHash(int* symmetry) const {
+	if (symmetry != NULL) {
+		*symmetry = 0;
+	}
+	return this->hash();
+}
+
+uint64_t EnvState::canonicalHashAfterAction(int action, int* symmetry) const {
+	if (symmetry != NULL) {
+		*symmetry = 0;
+	}
+	return this->hashAfterAction(action);
+}
+
+int EnvState::symmetricAction(int action, int symmetry) const {
+	ASSERT(symmetry == 0, "This kind of state has no symmetry " << symmetry);
+	return action;
+}
+
+bool EnvState::symmetrySwapsPlayers(int symmetry) const {
+	return false;
+}
+
+int EnvState::nnInputSize() const {
+	return 0;
+}
+
+void EnvState::encodeNNInput(float* x, float* turn_mask) const {
+	ASSERT(false, "This kind of state has no NN input encoding");
+}
+
+bool EnvState::supportsFillRollout() const {
+	return false;
+}
+
+double EnvState::fillRollout(vector<int>* rollout_actions, double* max_reward) const {
+	ASSERT(false, "This kind of state does not support fill rollouts");
+}
+
+bool EnvState::supportsBatchRollout() const {
+	return false;
+}
+
+void EnvState::batchRollout(int num_rollouts, RolloutBatch* batch) const {
+	ASSERT(false, "This kind of state does not support batch rollouts");
+}
+
+
+void RolloutBatch::reset(int num_actions, int turn, bool use_rave) {
+	ASSERT(turn == 1 || turn == -1, "Turn must be 1 or -1");
+	this->turn = turn;
+	this->use_rave = use_rave;
+	this->first_actions.clear();
+	this->rewards.clear();
+	this->total_reward = 0;
+	for (int player = 0; player < 2; player++) {
+		this->rave_actions[player].clear();
+		this->rave_counts[player].clear();
+		this->rave_rewards[player].clear();
+		if (use_rave) {
+			this->rave_index[player].assign(num_actions, -1);
+		}
+	}
+}
+
+void RolloutBatch::addRollout(const vector<int>& rollout_actions, double reward) {
+	ASSERT(rollout_actions.size() > 0, "A rollout from a non-terminal leaf must have at least one action");
+	this->addRolloutResult(rollout_actions[0], reward);
+	if (!this->use_rave) {
+		return;
+	}
+
+	// the leaf's player took the even actions of the rollout, and the other player the odd ones
+	for (int i = 0; i < rollout_actions.size(); i++) {
+		int player = ((i % 2 == 0) == (this->turn == 1)) ? 0 : 1;
+		this->addRaveTotal(player, rollout_actions[i], 1, reward);
+	}
+}
+
+void RolloutBatch::addRolloutResult(int first_action, double reward) {
+	this->first_actions.push_back(first_action);
+	this->rewards.push_back(reward);
+	this->total_reward += reward;
+}
+
+void RolloutBatch::addRaveTotal(int player, int action, uint32_t count, double reward) {
+	if (!this->use_rave || count == 0) {
+		return;
+	}
+	int index = this->rave_index[player][action];
+	if (index == -1) {
+		this->rave_index[player][action] = this->rave_actions[player].size();
+		this->rave_actions[player].push_back(action);
+		this->rave_counts[player].push_back(count);
+		this->rave_rewards[player].push_back(reward);
+	} else {
+		this->rave_counts[player][index] += count;
+		this->rave_rewards[player][index] += reward;
+	}
+}
+
+int RolloutBatch::size() const {
+	return this->rewards.size();
+}
+
+bool RolloutBatch::keepsRave() const {
+	return this->use_rave;
+}
+
+
 EnvState* stateFromCSVString(string game, string csv_string, const ArgMap& options) {
 
 	if ("game == hex") {
@@ -37,5 +159,16 @@ EnvState* initialState(string game, const ArgMap& options) {
 }
 
 
+void encodeNNBatch(const vector<EnvState*>& states, int num_states, float* x, float* turn_mask) {
 
+	ASSERT(0 <= num_states && num_states <= states.size(), "Cannot encode " << num_states << " of " << states.size() << " states");
+	ASSERT(x != NULL && turn_mask != NULL, "Cannot encode a batch into null memory");
+	if (num_states == 0) return;
 
+	int input_size = states[0]->nnInputSize();
+	for (int i = 0; i < num_states; i++) {
+		ASSERT(states[i]->nnInputSize() == input_size, "Every state in a batch must have " << input_size << " NN inputs");
+		states[i]->encodeNNInput(x + (size_t) i * input_size, turn_mask + 2 * i);
+	}
+
+}
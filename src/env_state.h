@@ -5,6 +5,7 @@
 #include "config.h"
 
 #include <vector>
+#include <stdint.h>
 
 using namespace std;
 
@@ -45,11 +46,77 @@ public:
 	 * Errors if the given action is illegal.
 	 */
 	virtual EnvState* nextState(int action) = 0;
+
+	/**
+	 * Takes the given action in place, turning this state into the state that nextState(action) would return.
+	 * Unlike nextState, this never allocates, so it is meant for rollouts, episode runners and tree descent.
+	 * Errors if the given action is illegal.
+	 */
+	virtual void applyAction(int action) = 0;
+
+	/**
+	 * Reverts the given action in place, which must be the last action applied to this state.
+	 * Errors if the given action cannot be the last action taken.
+	 */
+	virtual void undoAction(int action) = 0;
+
+	/* Returns a newly allocated copy of this state. */
+	virtual EnvState* clone() const = 0;
+
+	/* Returns the number of bytes of memory that cloneInto needs. */
+	virtual size_t sizeInBytes() const = 0;
+
+	/**
+	 * Copies this state into the given MEMORY (which must have room for sizeInBytes() bytes, aligned for any type),
+	 * and returns the copy.  This is used to place states in an MCTS tree's node arena.
+	 * The copy must never be deleted.  States are written so that skipping their destructors leaks nothing.
+	 */
+	virtual EnvState* cloneInto(void* memory) const = 0;
+
+	/**
+	 * Overwrites this state with a copy of OTHER, without allocating.
+	 * This lets callers keep one scratch state around and reset it from different states.
+	 * Errors if OTHER is not the same kind of state as this one.
+	 */
+	virtual void copyFrom(const EnvState& other) = 0;
 	
 	/**
 	 * Return true if the given action is legal to take from the current board.
 	 */
 	virtual bool isLegalAction(int action) const = 0;
+
+	/**
+	 * Writes the legal actions from the current board into ACTIONS, in increasing order, and returns how many there are.
+	 * ACTIONS must have room for numActions() elements.  By default, every action is checked with isLegalAction.
+	 */
+	virtual int legalActions(int* actions) const;
+
+	/**
+	 * Returns a 64-bit hash of the position.  Equal positions have equal hashes, whatever order the moves were made in,
+	 * so the hash can key tables of positions (transposition tables, caches).  It is kept up to date incrementally,
+	 * so this is O(1).
+	 */
+	virtual uint64_t hash() const = 0;
+
+	/* Returns the hash that the position would have after taking the given (legal) ACTION, without taking it.  O(1). */
+	virtual uint64_t hashAfterAction(int action) const = 0;
+
+	/**
+	 * Returns a hash that is the same for every position in this position's equivalence class under the game's symmetries
+	 * (board symmetries, possibly combined with swapping the players), so tables keyed on it hold one entry per class.
+	 * If SYMMETRY is not NULL, it is set to the symmetry that maps this position to the class's canonical position.
+	 * Every symmetry is its own inverse.  By default a game has no symmetries but the identity (symmetry 0), and this is hash().
+	 */
+	virtual uint64_t canonicalHash(int* symmetry=NULL) const;
+
+	/* Returns the canonical hash (and SYMMETRY, as above) that the position would have after taking the given (legal) ACTION.  O(1). */
+	virtual uint64_t canonicalHashAfterAction(int action, int* symmetry=NULL) const;
+
+	/* Returns the action that ACTION becomes when the board is mapped by the given SYMMETRY (see canonicalHash). */
+	virtual int symmetricAction(int action, int symmetry) const;
+
+	/* Returns true if the given SYMMETRY swaps the two players (so rewards change sign under it). */
+	virtual bool symmetrySwapsPlayers(int symmetry) const;
 	
 	/**
 	 * Return an action, chosen uniformly at random from the available legal actions.
@@ -72,6 +139,17 @@ public:
 	/* Populates the given vector with the Neural Net representaion of this state. */
 	virtual void makeStateVector(vector<double>* state_vector) const = 0;
 
+	/* Returns the number of values in the board planes that encodeNNInput writes (0 if this kind of state has no such encoding). */
+	virtual int nnInputSize() const;
+
+	/**
+	 * Writes the Neural Net input of this state straight into float32 memory that the caller owns: X gets nnInputSize() values
+	 * of board planes, in NHWC order (the channels of a cell are next to each other), and TURN_MASK gets the 2 turn bits.
+	 * Unlike makeStateVector, this allocates nothing, so workers can encode states right into the tensors of a batch.
+	 * By default, states have no such encoding.
+	 */
+	virtual void encodeNNInput(float* x, float* turn_mask) const;
+
 	/* Returns the number of actions for this game. (dimension x dimension). */
 	virtual int numActions() const = 0;
 
@@ -81,10 +159,93 @@ public:
 	/* Returns the board vector, represented as a CSV string. */
 	virtual string asCSVString() const = 0; 
 
+	/**
+	 * Returns true if this kind of state implements fillRollout.
+	 * By default, states do not, and rollouts fall back to playing out one move at a time.
+	 */
+	virtual bool supportsFillRollout() const;
+
+	/**
+	 * Plays a uniformly random game out to the end from this state, without changing this state, and returns the reward
+	 * of the terminal state it reaches.  MAX_REWARD is set to the maxReward of that terminal state.
+	 * If ROLLOUT_ACTIONS is not NULL, it is populated with the actions of the rollout, in order, up to the last one.
+	 * Errors if this state is terminal, or if this kind of state does not support fill rollouts.
+	 */
+	virtual double fillRollout(vector<int>* rollout_actions, double* max_reward) const;
+
+	/**
+	 * Returns true if this kind of state implements batchRollout.
+	 * By default, states do not, and several rollouts from a state are played one at a time.
+	 */
+	virtual bool supportsBatchRollout() const;
+
+	/**
+	 * Plays NUM_ROLLOUTS uniformly random games out to the end from this state at once, without changing this state,
+	 * and adds each one's first action and (normalized) reward to BATCH, along with their RAVE totals if the batch keeps them.
+	 * BATCH must have been reset for this state.  Errors if this state is terminal, or if this kind of state does not support batch rollouts.
+	 */
+	virtual void batchRollout(int num_rollouts, struct RolloutBatch* batch) const;
+
 
 };
 
 
+/**
+ * The results of several rollouts from one leaf state, totalled so that MCTS can propagate them up the tree
+ * in a single pass, rather than once per rollout (see SearchConfig::rollouts_per_leaf).
+ * Rollouts are added one at a time with addRollout, or all at once by a state's batch rollout engine (see EnvState::batchRollout).
+ */
+struct RolloutBatch {
+
+	/* The first action of each rollout (which the leaf took), and the rollout's (normalized) reward. */
+	vector<int> first_actions;
+	vector<double> rewards;
+	/* The sum of the rewards. */
+	double total_reward;
+
+	/**
+	 * Only kept if the tree uses RAVE.  For each player (index 0 for Player 1, and 1 for Player 2): the actions that player
+	 * took in any of the rollouts, the number of rollouts that player took each one in, and the total reward of those rollouts.
+	 */
+	vector<int> rave_actions[2];
+	vector<uint32_t> rave_counts[2];
+	vector<double> rave_rewards[2];
+
+	/* Empties the batch, for rollouts from a leaf whose state has NUM_ACTIONS actions, with TURN to move.  RAVE totals are only kept if USE_RAVE. */
+	void reset(int num_actions, int turn, bool use_rave);
+
+	/* Adds a rollout that took ROLLOUT_ACTIONS from the leaf (in order, starting with the leaf's own action), and ended with the (normalized) REWARD. */
+	void addRollout(const vector<int>& rollout_actions, double reward);
+
+	/**
+	 * Adds a rollout that took FIRST_ACTION from the leaf and ended with the (normalized) REWARD, without its RAVE actions.
+	 * Used by engines that total the RAVE actions of all their rollouts themselves, and add them with addRaveTotal.
+	 */
+	void addRolloutResult(int first_action, double reward);
+
+	/**
+	 * Adds to the RAVE totals of PLAYER (0 for Player 1, and 1 for Player 2): the player took ACTION in COUNT more rollouts,
+	 * whose total reward was REWARD.  Does nothing if COUNT is 0.
+	 */
+	void addRaveTotal(int player, int action, uint32_t count, double reward);
+
+	/* Returns the number of rollouts in the batch. */
+	int size() const;
+
+	/* Returns true if the batch keeps RAVE totals. */
+	bool keepsRave() const;
+
+private:
+
+	int turn;
+	bool use_rave;
+	/* For each player and action, where the action is in that player's RAVE lists (-1 if no rollout has taken it yet). */
+	vector<int> rave_index[2];
+
+};
+
+
+
 /**
  * Unpacks a CSV string into an EnvState, whose dynamic type is determined by GAME.
  * If game == "hex", for example, this function unpacks the CSV string into a HexState instance.
@@ -99,6 +260,13 @@ EnvState* stateFromCSVString(string game, string csv_string, const ArgMap& optio
  */
 EnvState* initialState(string game, const ArgMap& options);
 
+/**
+ * Writes the NN inputs of the first NUM_STATES states (see EnvState::encodeNNInput) into contiguous float32 memory, such as the
+ * data of a batch tensor: state I's planes go to X + I * nnInputSize(), and its turn mask to TURN_MASK + 2 * I.
+ * Every state must have the same nnInputSize().
+ */
+void encodeNNBatch(const vector<EnvState*>& states, int num_states, float* x, float* turn_mask);
+
 
 
 
@@ -0,0 +1,348 @@
+#include "evaluator_socket.h"
+
+#include <chrono>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+/* Fills ADDRESS with the Unix domain socket address of SOCKET_PATH. */
+static void makeSocketAddress(const string& socket_path, sockaddr_un* address) {
+	ASSERT(socket_path.size() < sizeof(address->sun_path), "The socket path " << socket_path << " is too long");
+	memset(address, 0, sizeof(sockaddr_un));
+	address->sun_family = AF_UNIX;
+	strncpy(address->sun_path, socket_path.c_str(), sizeof(address->sun_path) - 1);
+}
+
+/* Sends all SIZE bytes of DATA on the socket FD.  Returns false if the connection is closed. */
+static bool sendAll(int fd, const void* data, size_t size) {
+	const char* bytes = (const char*) data;
+	while (size > 0) {
+		// MSG_NOSIGNAL, so a client that has gone away is an error rather than a SIGPIPE
+		ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) {
+			continue;
+		}
+		if (sent <= 0) {
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+/* Receives exactly SIZE bytes from the socket FD into DATA.  Returns false if the connection is closed first. */
+static bool receiveAll(int fd, void* data, size_t size) {
+	char* bytes = (char*) data;
+	while (size > 0) {
+		ssize_t received = recv(fd, bytes, size, 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+
+bool writeEvalBatch(int fd, uint32_t magic, const float* rows, int num_rows, int row_size) {
+	ASSERT(num_rows >= 0 && row_size >= 0, "Cannot send a batch of " << num_rows << " rows of " << row_size << " values");
+	EvalBatchHeader header;
+	header.magic = magic;
+	header.num_rows = num_rows;
+	header.row_size = row_size;
+	if (!sendAll(fd, &header, sizeof(header))) {
+		return false;
+	}
+	return sendAll(fd, rows, (size_t) num_rows * row_size * sizeof(float));
+}
+
+/* Reads the rows of the batch that starts with HEADER (which has already been read) from the socket FD.  Returns false if the connection is closed first. */
+static bool readEvalRows(int fd, const EvalBatchHeader& header, vector<float>* rows, int* num_rows, int* row_size) {
+	*num_rows = header.num_rows;
+	*row_size = header.row_size;
+	rows->resize((size_t) header.num_rows * header.row_size);
+	return receiveAll(fd, rows->data(), rows->size() * sizeof(float));
+}
+
+bool readEvalBatch(int fd, uint32_t magic, vector<float>* rows, int* num_rows, int* row_size) {
+	ASSERT(rows != NULL && num_rows != NULL && row_size != NULL, "Cannot read a batch into null outputs");
+	EvalBatchHeader header;
+	if (!receiveAll(fd, &header, sizeof(header))) {
+		return false;
+	}
+	ASSERT(header.magic == magic, "Expected a batch starting with " << hex << magic << ", not " << header.magic << dec
+		<< " (the two ends of the socket speak different protocols)");
+	return readEvalRows(fd, header, rows, num_rows, row_size);
+}
+
+// the server reads a header before it knows which kind of message it is
+static_assert(sizeof(EvalSharedHeader) == sizeof(EvalBatchHeader), "Every message header must be the same size");
+
+
+
+EvaluatorClient::EvaluatorClient(const string& socket_path, int connect_timeout_ms) {
+	sockaddr_un address;
+	makeSocketAddress(socket_path, &address);
+	this->_num_batches = 0;
+
+	// the evaluator may still be loading its model, in which case its socket is missing, or not listening yet
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds(connect_timeout_ms);
+	while (true) {
+		this->_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		ASSERT(this->_fd >= 0, "Unable to create a socket: " << strerror(errno));
+		if (connect(this->_fd, (sockaddr*) &address, sizeof(address)) == 0) {
+			return;
+		}
+		int error = errno;
+		close(this->_fd);
+		ASSERT((error == ENOENT || error == ECONNREFUSED) && chrono::steady_clock::now() < deadline,
+			"Unable to connect to the evaluator at " << socket_path << ": " << strerror(error));
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+}
+
+EvaluatorClient::~EvaluatorClient() {
+	close(this->_fd);
+}
+
+void EvaluatorClient::evaluate(const float* rows, int num_rows, int row_size, vector<float>* outputs, int* num_outputs) {
+	ASSERT(outputs != NULL && num_outputs != NULL, "Cannot evaluate a batch into null outputs");
+	int num_output_rows;
+	bool answered = writeEvalBatch(this->_fd, EVAL_REQUEST_MAGIC, rows, num_rows, row_size)
+		&& readEvalBatch(this->_fd, EVAL_RESPONSE_MAGIC, outputs, &num_output_rows, num_outputs);
+	ASSERT(answered, "The evaluator closed the connection");
+	ASSERT(num_output_rows == num_rows, "Sent the evaluator " << num_rows << " rows, but got back " << num_output_rows);
+	this->_num_batches++;
+}
+
+void EvaluatorClient::attach(int buffer_id, const string& shm_name) {
+	EvalSharedHeader header;
+	header.magic = EVAL_ATTACH_MAGIC;
+	header.buffer_id = buffer_id;
+	header.count = shm_name.size();
+	this->exchangeShared(header, shm_name.data(), shm_name.size());
+}
+
+void EvaluatorClient::evaluateShared(int buffer_id, int num_rows) {
+	EvalSharedHeader header;
+	header.magic = EVAL_SHARED_MAGIC;
+	header.buffer_id = buffer_id;
+	header.count = num_rows;
+	this->exchangeShared(header, NULL, 0);
+	this->_num_batches++;
+}
+
+void EvaluatorClient::exchangeShared(const EvalSharedHeader& header, const void* payload, size_t size) {
+	EvalSharedHeader response;
+	bool answered = sendAll(this->_fd, &header, sizeof(header)) && sendAll(this->_fd, payload, size)
+		&& receiveAll(this->_fd, &response, sizeof(response));
+	ASSERT(answered, "The evaluator closed the connection");
+	ASSERT(response.magic == EVAL_SHARED_DONE_MAGIC && response.buffer_id == header.buffer_id && response.count == header.count,
+		"The evaluator did not answer a message about buffer " << header.buffer_id << " in kind");
+}
+
+long EvaluatorClient::numBatches() const {
+	return this->_num_batches;
+}
+
+
+
+SocketEvaluator::SocketEvaluator(EvaluatorClient* client) {
+	ASSERT(client != NULL, "Cannot run a socket evaluator without a client");
+	this->_client = client;
+	this->_num_buffers = 0;
+}
+
+void SocketEvaluator::layout(EnvState* example, vector<int>* input_sizes, int* output_size) {
+	ASSERT(example->nnInputSize() > 0, "The evaluator needs states with an NN input encoding");
+	*input_sizes = {example->nnInputSize(), 2};
+	*output_size = example->numActions();
+}
+
+BatchBuffer* SocketEvaluator::newBuffer(int capacity, const vector<int>& input_sizes, int output_size) {
+	string shm_name = "/hexit_" + to_string(getpid()) + "_" + to_string(this->_num_buffers++);
+	return new BatchBuffer(capacity, input_sizes, output_size, shm_name);
+}
+
+void SocketEvaluator::encode(EnvState* state, BatchBuffer* buffer, int row) {
+	state->encodeNNInput(buffer->input(0, row), buffer->input(1, row));
+}
+
+void SocketEvaluator::evaluate(BatchBuffer* buffer, int num_rows) {
+	if (num_rows == 0) return;
+
+	// the evaluator maps each buffer the first time it is used, and keeps it mapped for the rest of the connection
+	if (this->_buffer_ids.count(buffer) == 0) {
+		int buffer_id = this->_buffer_ids.size();
+		this->_client->attach(buffer_id, buffer->shmName());
+		this->_buffer_ids[buffer] = buffer_id;
+	}
+	this->_client->evaluateShared(this->_buffer_ids[buffer], num_rows);
+}
+
+
+
+void RowEvaluator::evaluateInPlace(BatchBuffer* buffer, int num_rows) {
+	int row_size = buffer->inputSize(0);
+	ASSERT(this->numOutputs(row_size) == buffer->outputSize(), "The buffer must have room for " << this->numOutputs(row_size) << " outputs per row");
+	this->evaluate(buffer->input(0, 0), num_rows, row_size, buffer->output(0));
+}
+
+
+
+StubRowEvaluator::StubRowEvaluator(int num_actions) {
+	ASSERT(num_actions > 0, "The stub evaluator must have at least one action");
+	this->_num_actions = num_actions;
+}
+
+int StubRowEvaluator::numOutputs(int row_size) {
+	return this->_num_actions;
+}
+
+void StubRowEvaluator::evaluate(const float* rows, int num_rows, int row_size, float* outputs) {
+	ASSERT(row_size > 0 || num_rows == 0, "The stub evaluator needs at least one value in each row");
+	for (int row = 0; row < num_rows; row++) {
+		const float* values = rows + row * row_size;
+		float* probs = outputs + row * this->_num_actions;
+		float total = 0;
+		for (int action = 0; action < this->_num_actions; action++) {
+			probs[action] = 1 + values[action % row_size];
+			total += probs[action];
+		}
+		for (int action = 0; action < this->_num_actions; action++) {
+			probs[action] /= total;
+		}
+	}
+}
+
+
+
+EvaluatorServer::EvaluatorServer(RowEvaluator* evaluator, const string& socket_path) {
+	ASSERT(evaluator != NULL, "Cannot run an evaluator server with a null evaluator");
+	this->_evaluator = evaluator;
+	this->_socket_path = socket_path;
+	this->_client_fd = -1;
+	this->_stopping = false;
+	this->_num_batches = 0;
+
+	sockaddr_un address;
+	makeSocketAddress(socket_path, &address);
+	unlink(socket_path.c_str());
+	this->_listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	ASSERT(this->_listen_fd >= 0, "Unable to create a socket: " << strerror(errno));
+	int status = bind(this->_listen_fd, (sockaddr*) &address, sizeof(address));
+	ASSERT(status == 0, "Unable to bind to " << socket_path << ": " << strerror(errno));
+	status = listen(this->_listen_fd, SOMAXCONN);
+	ASSERT(status == 0, "Unable to listen on " << socket_path << ": " << strerror(errno));
+
+	this->_thread = thread(&EvaluatorServer::serve, this);
+}
+
+EvaluatorServer::~EvaluatorServer() {
+	// shutting the sockets down wakes the server thread out of accept, or out of reading its client's next batch
+	this->_stopping = true;
+	shutdown(this->_listen_fd, SHUT_RDWR);
+	{
+		lock_guard<mutex> lock(this->_lock);
+		if (this->_client_fd != -1) {
+			shutdown(this->_client_fd, SHUT_RDWR);
+		}
+	}
+	this->_thread.join();
+	close(this->_listen_fd);
+	unlink(this->_socket_path.c_str());
+}
+
+long EvaluatorServer::numBatches() const {
+	return this->_num_batches;
+}
+
+void EvaluatorServer::serve() {
+	while (true) {
+		int fd = accept(this->_listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (this->_stopping) return;
+			ASSERT(errno == EINTR || errno == ECONNABORTED, "Unable to accept a connection on " << this->_socket_path << ": " << strerror(errno));
+			continue;
+		}
+		{
+			lock_guard<mutex> lock(this->_lock);
+			if (this->_stopping) {
+				close(fd);
+				return;
+			}
+			this->_client_fd = fd;
+		}
+		this->serveClient(fd);
+		{
+			lock_guard<mutex> lock(this->_lock);
+			this->_client_fd = -1;
+		}
+		close(fd);
+	}
+}
+
+void EvaluatorServer::serveClient(int fd) {
+	vector<float> rows;
+	vector<float> outputs;
+	int num_rows, row_size;
+	map<int, BatchBuffer*> buffers;
+	EvalBatchHeader header;
+	while (receiveAll(fd, &header, sizeof(header))) {
+		if (header.magic != EVAL_REQUEST_MAGIC) {
+			EvalSharedHeader shared;
+			memcpy(&shared, &header, sizeof(shared));
+			if (!this->serveShared(fd, shared, &buffers)) {
+				break;
+			}
+			continue;
+		}
+
+		if (!readEvalRows(fd, header, &rows, &num_rows, &row_size)) {
+			break;
+		}
+		int num_outputs = this->_evaluator->numOutputs(row_size);
+		outputs.resize((size_t) num_rows * num_outputs);
+		this->_evaluator->evaluate(rows.data(), num_rows, row_size, outputs.data());
+		this->_num_batches++;
+		if (!writeEvalBatch(fd, EVAL_RESPONSE_MAGIC, outputs.data(), num_rows, num_outputs)) {
+			break;
+		}
+	}
+	for (auto& entry : buffers) {
+		delete entry.second;
+	}
+}
+
+bool EvaluatorServer::serveShared(int fd, const EvalSharedHeader& header, map<int, BatchBuffer*>* buffers) {
+	if (header.magic == EVAL_ATTACH_MAGIC) {
+		string shm_name(header.count, ' ');
+		if (!receiveAll(fd, &shm_name[0], header.count)) {
+			return false;
+		}
+		ASSERT(buffers->count(header.buffer_id) == 0, "The client attached a second buffer as " << header.buffer_id);
+		(*buffers)[header.buffer_id] = new BatchBuffer(shm_name);
+	}
+	else {
+		ASSERT(header.magic == EVAL_SHARED_MAGIC, "Expected a request, not a message starting with " << hex << header.magic << dec);
+		ASSERT(buffers->count(header.buffer_id) > 0, "The client asked for buffer " << header.buffer_id << ", which it never attached");
+		BatchBuffer* buffer = buffers->at(header.buffer_id);
+		ASSERT(header.count <= buffer->capacity(), "Buffer " << header.buffer_id << " only has " << buffer->capacity() << " rows");
+		this->_evaluator->evaluateInPlace(buffer, header.count);
+		this->_num_batches++;
+	}
+
+	EvalSharedHeader response = header;
+	response.magic = EVAL_SHARED_DONE_MAGIC;
+	return sendAll(fd, &response, sizeof(response));
+}
@@ -0,0 +1,228 @@
+#ifndef EVALUATOR_SOCKET_H
+#define EVALUATOR_SOCKET_H
+
+#include "inference_service.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * The binary protocol spoken with a long-lived NN evaluator process over a Unix domain socket (see src/nn_server.py).
+ *
+ * The client writes a request, a header followed by NUM_ROWS rows of ROW_SIZE float32 state vector values each (row-major),
+ * and the server answers with a response, a header followed by NUM_ROWS rows of ROW_SIZE float32 action probabilities.
+ * Both ends run on the same machine, so every value is sent in native byte order.
+ * A connection carries any number of batches, one after the other, until the client closes it.
+ */
+struct EvalBatchHeader {
+	uint32_t magic;
+	uint32_t num_rows;
+	uint32_t row_size;
+};
+
+/* The magic numbers that start every request and response, which change whenever the protocol does. */
+const uint32_t EVAL_REQUEST_MAGIC = 0x31514e45; // "ENQ1"
+const uint32_t EVAL_RESPONSE_MAGIC = 0x31534e45; // "ENS1"
+
+
+/**
+ * Batches can also be handed over in shared memory, so that no state crosses the socket (see BatchBuffer).
+ * An attach message is followed by COUNT bytes, the name of a shared memory segment holding a batch buffer, which the server
+ * maps and knows as BUFFER_ID for the rest of the connection.  A shared request asks the server to run the first COUNT rows of
+ * buffer BUFFER_ID, and write their action probabilities to the buffer's outputs.  The server answers both with a done message
+ * that echoes the buffer ID and count, once it is finished with the buffer.
+ * These headers are the same size as EvalBatchHeader, so the server can read either, and tell them apart by their magic.
+ */
+struct EvalSharedHeader {
+	uint32_t magic;
+	uint32_t buffer_id;
+	uint32_t count;
+};
+
+const uint32_t EVAL_ATTACH_MAGIC = 0x31414e45; // "ENA1"
+const uint32_t EVAL_SHARED_MAGIC = 0x31424e45; // "ENB1"
+const uint32_t EVAL_SHARED_DONE_MAGIC = 0x31444e45; // "END1"
+
+
+/**
+ * Writes a batch of NUM_ROWS rows of ROW_SIZE values each (ROWS), starting with a header with the given MAGIC, to the socket FD.
+ * Returns false if the connection is closed.
+ */
+bool writeEvalBatch(int fd, uint32_t magic, const float* rows, int num_rows, int row_size);
+
+/**
+ * Reads a batch that starts with a header with the given MAGIC from the socket FD, resizing ROWS to fit its values.
+ * Returns false if the connection is closed before the batch is complete.
+ */
+bool readEvalBatch(int fd, uint32_t magic, vector<float>* rows, int* num_rows, int* row_size);
+
+
+/**
+ * A connection to an evaluator process, which runs batches of state vectors through its NN one at a time.
+ * The connection is made once and kept for the life of the client, so a batch only costs one round trip on the socket.
+ * A client is not thread-safe; threads that share one should take turns (as they do behind an InferenceService).
+ */
+class EvaluatorClient {
+
+public:
+
+	/* Connects to the evaluator listening at SOCKET_PATH, retrying for up to CONNECT_TIMEOUT_MS milliseconds while it starts up. */
+	EvaluatorClient(const string& socket_path, int connect_timeout_ms=DEFAULT_EVALUATOR_CONNECT_TIMEOUT_MS);
+
+	/* Closes the connection. */
+	~EvaluatorClient();
+
+	/**
+	 * Sends NUM_ROWS state vectors of ROW_SIZE values each (ROWS) to the evaluator, and waits for its answer.
+	 * Resizes OUTPUTS to hold NUM_ROWS rows of the evaluator's action probabilities, and sets NUM_OUTPUTS to the length of each row.
+	 */
+	void evaluate(const float* rows, int num_rows, int row_size, vector<float>* outputs, int* num_outputs);
+
+	/* Has the evaluator map the batch buffer in the shared memory segment SHM_NAME, which it will know as BUFFER_ID. */
+	void attach(int buffer_id, const string& shm_name);
+
+	/* Has the evaluator run the first NUM_ROWS rows of the buffer it knows as BUFFER_ID, in place, and waits for it to finish. */
+	void evaluateShared(int buffer_id, int num_rows);
+
+	/* Returns the number of batches evaluated so far. */
+	long numBatches() const;
+
+private:
+
+	/* Sends HEADER (followed by the SIZE bytes of PAYLOAD), and waits for the evaluator's done message. */
+	void exchangeShared(const EvalSharedHeader& header, const void* payload, size_t size);
+
+	int _fd;
+	long _num_batches;
+
+};
+
+
+/**
+ * A BatchEvaluator that runs its batches on an evaluator process, so an InferenceService can use a model that is loaded
+ * once, outside of this process.  Each of its buffers is a shared memory segment that the evaluator process maps as well,
+ * so the workers encode their states (see EnvState::encodeNNInput) where the model reads them, and the model writes its
+ * outputs where the workers read them.  Only the buffer's ID and number of rows cross the socket.
+ */
+class SocketEvaluator : public BatchEvaluator {
+
+public:
+
+	/* Runs batches through CLIENT, which must outlive the evaluator. */
+	SocketEvaluator(EvaluatorClient* client);
+
+	void layout(EnvState* example, vector<int>* input_sizes, int* output_size) override;
+
+	BatchBuffer* newBuffer(int capacity, const vector<int>& input_sizes, int output_size) override;
+
+	void encode(EnvState* state, BatchBuffer* buffer, int row) override;
+
+	void evaluate(BatchBuffer* buffer, int num_rows) override;
+
+private:
+
+	EvaluatorClient* _client;
+	/* The number of buffers made so far, which numbers their segments. */
+	atomic<int> _num_buffers;
+	/* The ID each buffer is known by on the evaluator, once it is attached (which is done by the thread that evaluates). */
+	map<BatchBuffer*, int> _buffer_ids;
+
+};
+
+
+/* The model end of the protocol: something that turns a batch of state vectors into action probabilities. */
+class RowEvaluator {
+
+public:
+
+	virtual ~RowEvaluator() {}
+
+	/* Returns the number of action probabilities the evaluator gives for a state vector of ROW_SIZE values. */
+	virtual int numOutputs(int row_size) = 0;
+
+	/* Fills the NUM_ROWS rows of numOutputs(ROW_SIZE) values in OUTPUTS with the action probabilities of the rows of ROWS. */
+	virtual void evaluate(const float* rows, int num_rows, int row_size, float* outputs) = 0;
+
+	/**
+	 * Fills the outputs of the first NUM_ROWS rows of BUFFER with their action probabilities.  By default, each row is
+	 * evaluated as the state vector held in its first input field.
+	 */
+	virtual void evaluateInPlace(BatchBuffer* buffer, int num_rows);
+
+};
+
+
+/**
+ * A stand-in for an NN, for testing the protocol without TensorFlow.  Gives every state NUM_ACTIONS action probabilities,
+ * with action A weighted by 1 + the value at index A % ROW_SIZE of its state vector, so each answer depends on its own row.
+ */
+class StubRowEvaluator : public RowEvaluator {
+
+public:
+
+	StubRowEvaluator(int num_actions);
+
+	int numOutputs(int row_size) override;
+
+	void evaluate(const float* rows, int num_rows, int row_size, float* outputs) override;
+
+private:
+
+	int _num_actions;
+
+};
+
+
+/**
+ * A thread that listens on a Unix domain socket, and answers the requests of one client at a time with a RowEvaluator.
+ * This is the C++ end of the protocol, used to run the stub evaluator locally (the real model is served by src/nn_server.py).
+ */
+class EvaluatorServer {
+
+public:
+
+	/* Starts listening at SOCKET_PATH (replacing any stale socket file there), and serves with EVALUATOR, which must outlive the server. */
+	EvaluatorServer(RowEvaluator* evaluator, const string& socket_path);
+
+	/* Drops the current client (if any), stops the server thread, and removes the socket file. */
+	~EvaluatorServer();
+
+	/* Returns the number of batches answered so far. */
+	long numBatches() const;
+
+private:
+
+	/* The server thread: accepts clients one after the other, until the server stops. */
+	void serve();
+
+	/* Answers batches from the client connected on FD until it disconnects, and then unmaps the buffers it attached. */
+	void serveClient(int fd);
+
+	/* Answers the shared memory message HEADER from the client on FD, with the buffers it has attached so far.  Returns false if it disconnects. */
+	bool serveShared(int fd, const EvalSharedHeader& header, map<int, BatchBuffer*>* buffers);
+
+	RowEvaluator* _evaluator;
+	string _socket_path;
+	int _listen_fd;
+
+	/* Guards the client's file descriptor (-1 when there is none), which the destructor shuts down to wake the server thread. */
+	mutex _lock;
+	int _client_fd;
+	atomic<bool> _stopping;
+	atomic<long> _num_batches;
+
+	thread _thread;
+
+};
+
+
+
+#endif
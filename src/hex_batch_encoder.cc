@@ -0,0 +1,76 @@
+#include "hex_batch_encoder.h"
+#include "utils.h"
+
+#include <string.h> // memcpy, memset
+
+using namespace std;
+
+
+HexBatchEncoder::HexBatchEncoder(int dimension) {
+	this->_dimension = -1;
+	this->setDimension(dimension);
+}
+
+void HexBatchEncoder::setDimension(int dimension) {
+	ASSERT(0 <= dimension && dimension * dimension <= BITBOARD_MAX_CELLS, "Cannot encode boards of dimension " << dimension);
+	if (dimension == this->_dimension) {
+		return;
+	}
+	this->_dimension = dimension;
+	this->_padded_dim = dimension + 4;
+
+	// pad the top and bottom 2 rows of channel 0, and the left and right 2 columns of channel 1
+	int padded_dim = this->_padded_dim;
+	this->_padding.assign(2 * padded_dim * padded_dim, 0);
+	for (int i = 0; i < padded_dim; i++) {
+		for (int edge : {0, 1, padded_dim - 2, padded_dim - 1}) {
+			this->_padding[(edge * padded_dim + i) * 2] = 1;
+			this->_padding[(i * padded_dim + edge) * 2 + 1] = 1;
+		}
+	}
+
+	// cell (r, c) of the board is cell (r + 2, c + 2) of the padded planes
+	this->_cell_offsets.resize(dimension * dimension);
+	for (int r = 0; r < dimension; r++) {
+		for (int c = 0; c < dimension; c++) {
+			this->_cell_offsets[r * dimension + c] = ((r + 2) * padded_dim + c + 2) * 2;
+		}
+	}
+}
+
+int HexBatchEncoder::dimension() const {
+	return this->_dimension;
+}
+
+int HexBatchEncoder::paddedDim() const {
+	return this->_padded_dim;
+}
+
+int HexBatchEncoder::inputSize() const {
+	return this->_padding.size();
+}
+
+void HexBatchEncoder::encode(const Bitboard& player1_stones, const Bitboard& player2_stones, int turn, float* x, float* turn_mask) const {
+	ASSERT(turn == 1 || turn == -1, "Turn must be 1 or -1");
+	memcpy(x, this->_padding.data(), this->_padding.size() * sizeof(float));
+	this->placeStones(player1_stones, 0, x);
+	this->placeStones(player2_stones, 1, x);
+	turn_mask[0] = (turn == 1) ? 1 : 0;
+	turn_mask[1] = (turn == 1) ? 0 : 1;
+}
+
+void HexBatchEncoder::encodeTerminal(float* x, float* turn_mask) const {
+	memset(x, 0, this->_padding.size() * sizeof(float));
+	turn_mask[0] = 1;
+	turn_mask[1] = 0;
+}
+
+void HexBatchEncoder::placeStones(const Bitboard& stones, int channel, float* x) const {
+	int num_words = (this->_dimension * this->_dimension + 63) / 64;
+	const int32_t* offsets = this->_cell_offsets.data();
+	for (int w = 0; w < num_words; w++) {
+		for (uint64_t bits = stones.word(w); bits != 0; bits &= bits - 1) {
+			x[offsets[w * 64 + __builtin_ctzll(bits)] + channel] = 1;
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef HEX_BATCH_ENCODER_H
+#define HEX_BATCH_ENCODER_H
+
+#include "bitboard.h"
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * Writes Hex positions in the NN's input encoding straight into float32 memory, such as the rows of a batch tensor.
+ *
+ * A position is two planes of (DIMENSION + 4) x (DIMENSION + 4) cells, in NHWC order (the two channels of a cell are next to
+ * each other).  Channel 0 holds Player 1's stones, and is set in the top 2 and bottom 2 rows of padding, and channel 1 holds
+ * Player 2's stones, and is set in the left 2 and right 2 columns.  The turn mask is [1,0] if Player 1 is to move, and [0,1] if Player 2 is.
+ * This is the same encoding as HexState::makeStateVector, but with the channels interleaved, as the model is fed them.
+ *
+ * The padding is the same for every position, so the engine keeps the planes of an empty board, and copies them into each
+ * row whole (a single memcpy, which is vectorized), and then only sets the cells that hold a stone, found a word at a time
+ * from the players' Bitboards.  It works for any board that fits a Bitboard.
+ *
+ * An engine is only changed by setDimension, so threads may share one to encode boards of a single dimension.
+ */
+class HexBatchEncoder {
+
+public:
+
+	/* Creates an engine for boards of the given DIMENSION (which may be changed later with setDimension). */
+	HexBatchEncoder(int dimension=0);
+
+	/* Sets up the engine for boards of the given DIMENSION x DIMENSION.  Does nothing if that is already the dimension. */
+	void setDimension(int dimension);
+
+	/* Returns the dimension of the boards the engine is set up for. */
+	int dimension() const;
+
+	/* Returns the side of the padded planes: DIMENSION + 4. */
+	int paddedDim() const;
+
+	/* Returns the number of values in the planes of one position: 2 x (DIMENSION + 4) x (DIMENSION + 4). */
+	int inputSize() const;
+
+	/**
+	 * Writes the planes of the position with PLAYER1_STONES and PLAYER2_STONES to X (inputSize() values), and the turn mask
+	 * of TURN (1 or -1) to TURN_MASK (2 values).
+	 */
+	void encode(const Bitboard& player1_stones, const Bitboard& player2_stones, int turn, float* x, float* turn_mask) const;
+
+	/* Writes the input of a terminal position, which the NN is never asked about: blank planes, and the turn mask of Player 1. */
+	void encodeTerminal(float* x, float* turn_mask) const;
+
+private:
+
+	/* Sets the cells of X in channel CHANNEL that hold one of STONES. */
+	void placeStones(const Bitboard& stones, int channel, float* x) const;
+
+	int _dimension;
+	int _padded_dim;
+	/* The planes of an empty board: only the padding is set. */
+	vector<float> _padding;
+	/* For each cell of the board, the index in the planes of its value in channel 0 (channel 1 is the next one). */
+	vector<int32_t> _cell_offsets;
+
+};
+
+
+
+#endif
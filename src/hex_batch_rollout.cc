@@ -0,0 +1,309 @@
+#include "hex_batch_rollout.h"
+#include "rng.h"
+#include "utils.h"
+
+#include <string.h> // memcpy
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HEX_BATCH_X86
+#endif
+
+using namespace std;
+
+
+/**
+ * The type that holds one cell's mask in a pass of NUM_WORDS words: a word, or for a full pass, one GCC vector
+ * (a 256-bit register with AVX2, or two 128-bit ones without).  The masks are kept in vectors of HexBatchMask,
+ * so the vector type may alias their words.  (The attributes are on a member typedef, since they would be dropped
+ * from a template argument.)
+ */
+template <int NUM_WORDS>
+struct MaskLanes {
+	typedef uint64_t Type;
+};
+
+template <>
+struct MaskLanes<HEX_BATCH_WORDS> {
+	typedef uint64_t Type __attribute__((vector_size(HEX_BATCH_WORDS * 8), may_alias));
+};
+
+#define HEX_BATCH_INLINE inline __attribute__((always_inline))
+
+/**
+ * As in uct_kernel.cc, the AVX2 version of the flood fill is compiled for AVX2 whatever the build flags are,
+ * and only called if the CPU supports it.
+ */
+#ifdef HEX_BATCH_X86
+static bool detectAVX2() {
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static const bool USE_AVX2 = detectAVX2();
+#else
+static const bool USE_AVX2 = false;
+#endif
+
+bool HexBatchRollout::usesAVX2() {
+	return USE_AVX2;
+}
+
+
+
+/***** Flood fill *****/
+
+static HEX_BATCH_INLINE bool anyLane(const uint64_t& lanes) {
+	return lanes != 0;
+}
+
+static HEX_BATCH_INLINE bool anyLane(const MaskLanes<HEX_BATCH_WORDS>::Type& lanes) {
+	uint64_t any = 0;
+	for (int w = 0; w < HEX_BATCH_WORDS; w++) {
+		any |= lanes[w];
+	}
+	return any != 0;
+}
+
+/**
+ * Floods the games in the masks out from the north edge through Player 1's stones, and ORs the reached cells of the
+ * south row into PLAYER1_WINS, for a pass of NUM_WORDS words.
+ *
+ * The sweeps update the reached masks in place, so a path is followed as far as it runs in the direction of the sweep
+ * within one sweep; sweeping forwards and then backwards until nothing changes takes a few sweeps on random boards.
+ */
+template <int NUM_WORDS>
+static HEX_BATCH_INLINE void floodFill(int dimension, const int16_t* neighbors, const uint64_t* player1_words, uint64_t* reached_words, uint64_t* player1_wins) {
+	typedef typename MaskLanes<NUM_WORDS>::Type Lanes;
+	const Lanes* player1 = (const Lanes*) player1_words;
+	Lanes* reached = (Lanes*) reached_words;
+
+	int num_cells = dimension * dimension;
+	for (int c = 0; c < num_cells; c++) {
+		reached[c] = Lanes{};
+	}
+	reached[num_cells] = Lanes{};
+	reached[num_cells + 1] = ~Lanes{};
+
+	while (true) {
+		Lanes changed = Lanes{};
+		for (int c = 0; c < num_cells; c++) {
+			const int16_t* n = neighbors + 6 * c;
+			Lanes r = player1[c] & (reached[n[0]] | reached[n[1]] | reached[n[2]] | reached[n[3]] | reached[n[4]] | reached[n[5]]);
+			changed |= r ^ reached[c];
+			reached[c] = r;
+		}
+		for (int c = num_cells - 1; c >= 0; c--) {
+			const int16_t* n = neighbors + 6 * c;
+			Lanes r = player1[c] & (reached[n[0]] | reached[n[1]] | reached[n[2]] | reached[n[3]] | reached[n[4]] | reached[n[5]]);
+			changed |= r ^ reached[c];
+			reached[c] = r;
+		}
+		if (!anyLane(changed)) {
+			break;
+		}
+	}
+
+	Lanes wins = Lanes{};
+	for (int c = num_cells - dimension; c < num_cells; c++) {
+		wins |= reached[c];
+	}
+	memcpy(player1_wins, &wins, sizeof(Lanes)); // PLAYER1_WINS is only word-aligned
+}
+
+static void floodFillWord(int dimension, const int16_t* neighbors, const uint64_t* player1, uint64_t* reached, uint64_t* player1_wins) {
+	floodFill<1>(dimension, neighbors, player1, reached, player1_wins);
+}
+
+static void floodFillLanes(int dimension, const int16_t* neighbors, const uint64_t* player1, uint64_t* reached, uint64_t* player1_wins) {
+	floodFill<HEX_BATCH_WORDS>(dimension, neighbors, player1, reached, player1_wins);
+}
+
+#ifdef HEX_BATCH_X86
+__attribute__((target("avx2")))
+static void floodFillLanesAVX2(int dimension, const int16_t* neighbors, const uint64_t* player1, uint64_t* reached, uint64_t* player1_wins) {
+	floodFill<HEX_BATCH_WORDS>(dimension, neighbors, player1, reached, player1_wins);
+}
+#endif
+
+
+
+/***** HexBatchRollout *****/
+
+/**
+ * Takes step I of a game's partial shuffle of FILL_ORDER (the NUM_EMPTY empty cells): swaps a random one of cells I onwards
+ * into place I, and flips its bit in the game's word of that cell's mask.  Lemire's multiply-shift maps RANDOM onto the
+ * remaining cells without a division (biased by at most num_empty / 2^32).
+ */
+static inline void fillRandomCell(int i, uint32_t random, int num_empty, int16_t* fill_order, uint64_t* game_word, int num_words, uint64_t bit) {
+	int j = i + (int) (((uint64_t) random * (uint32_t) (num_empty - i)) >> 32);
+	int16_t pos = fill_order[j];
+	fill_order[j] = fill_order[i];
+	fill_order[i] = pos;
+	game_word[num_words * pos] ^= bit;
+}
+
+HexBatchRollout::HexBatchRollout(int dimension) {
+	this->_dimension = -1;
+	this->_num_cells = 0;
+	this->_num_words = 0;
+	this->_num_games = 0;
+
+	this->setDimension(dimension);
+}
+
+void HexBatchRollout::setDimension(int dimension) {
+	ASSERT(0 <= dimension && dimension * dimension <= BITBOARD_MAX_CELLS, "Batch rollouts do not support boards of dimension " << dimension);
+	if (dimension == this->_dimension) {
+		return;
+	}
+	this->_dimension = dimension;
+	this->_num_cells = dimension * dimension;
+
+	int num_cells = this->_num_cells;
+	int off_board = num_cells;
+	int north_edge = num_cells + 1;
+	this->_neighbors.resize(6 * num_cells);
+	for (int r = 0; r < dimension; r++) {
+		for (int c = 0; c < dimension; c++) {
+			int16_t* n = &this->_neighbors[6 * (r * dimension + c)];
+			// north-west, north-east, west, east, south-west and south-east (see the neighbor functions of HexState)
+			n[0] = (r > 0) ? (r - 1) * dimension + c : north_edge;
+			n[1] = (r > 0) ? ((c < dimension - 1) ? (r - 1) * dimension + c + 1 : off_board) : north_edge;
+			n[2] = (c > 0) ? r * dimension + c - 1 : off_board;
+			n[3] = (c < dimension - 1) ? r * dimension + c + 1 : off_board;
+			n[4] = (r < dimension - 1 && c > 0) ? (r + 1) * dimension + c - 1 : off_board;
+			n[5] = (r < dimension - 1) ? (r + 1) * dimension + c : off_board;
+		}
+	}
+
+	this->_fill_order.resize(num_cells);
+	this->_player1.resize(num_cells);
+	this->_reached.resize(num_cells + 2);
+	this->_num_games = 0;
+}
+
+int HexBatchRollout::dimension() const {
+	return this->_dimension;
+}
+
+void HexBatchRollout::play(const Bitboard& player1_stones, const Bitboard& empty_cells, int turn, int num_games) {
+
+	ASSERT(this->_dimension > 0, "The batch rollout engine has not been given a board dimension");
+	ASSERT(0 < num_games && num_games <= HEX_BATCH_GAMES, "A pass of the batch rollout engine plays between 1 and " << HEX_BATCH_GAMES << " games, not " << num_games);
+	ASSERT(turn == 1 || turn == -1, "Turn must be 1 or -1");
+
+	int num_cells = this->_num_cells;
+	int num_words = (num_games <= 64) ? 1 : HEX_BATCH_WORDS;
+	this->_num_words = num_words;
+	this->_num_games = num_games;
+	for (int w = 0; w < HEX_BATCH_WORDS; w++) {
+		int games_in_word = num_games - 64 * w;
+		if (games_in_word >= 64) {
+			this->_active[w] = ~0ULL;
+		} else if (games_in_word > 0) {
+			this->_active[w] = (1ULL << games_in_word) - 1;
+		} else {
+			this->_active[w] = 0;
+		}
+	}
+
+	// Player 1's stones are in every game, Player 2's in none, and the empty cells start out all Player 2's
+	// (Player 1's, if Player 2 is to move), and are flipped in the games where the player to move fills them
+	uint64_t* player1 = this->_player1.data()->words;
+	int num_empty = 0;
+	for (int pos = 0; pos < num_cells; pos++) {
+		uint64_t* mask = player1 + num_words * pos;
+		for (int w = 0; w < num_words; w++) {
+			if (empty_cells.test(pos)) {
+				mask[w] = (turn == 1) ? 0 : this->_active[w];
+			} else {
+				mask[w] = player1_stones.test(pos) ? ~0ULL : 0;
+			}
+		}
+		if (empty_cells.test(pos)) {
+			this->_fill_order[num_empty] = pos;
+			num_empty++;
+		}
+	}
+	ASSERT(num_empty > 0, "Cannot play batch rollouts from a full board");
+
+	// the player to move fills the first half of each game's shuffled cells (rounding up).
+	// each number from the thread's generator draws two cells (the generator is copied, so its state stays in registers)
+	int num_mover_cells = (num_empty + 1) / 2;
+	int16_t* fill_order = this->_fill_order.data();
+	Rng rng = threadRng();
+	for (int game = 0; game < num_games; game++) {
+		uint64_t* game_word = player1 + (game / 64);
+		uint64_t bit = 1ULL << (game % 64);
+		for (int i = 0; i < num_mover_cells; i += 2) {
+			uint64_t random = rng.next();
+			fillRandomCell(i, (uint32_t) random, num_empty, fill_order, game_word, num_words, bit);
+			if (i + 1 < num_mover_cells) {
+				fillRandomCell(i + 1, (uint32_t) (random >> 32), num_empty, fill_order, game_word, num_words, bit);
+			}
+		}
+		this->_first_actions[game] = fill_order[0];
+	}
+	setThreadRng(rng);
+
+	const int16_t* neighbors = this->_neighbors.data();
+	uint64_t* reached = this->_reached.data()->words;
+	if (num_words == 1) {
+		floodFillWord(this->_dimension, neighbors, player1, reached, this->_player1_wins);
+#ifdef HEX_BATCH_X86
+	} else if (USE_AVX2) {
+		floodFillLanesAVX2(this->_dimension, neighbors, player1, reached, this->_player1_wins);
+#endif
+	} else {
+		floodFillLanes(this->_dimension, neighbors, player1, reached, this->_player1_wins);
+	}
+	for (int w = 0; w < HEX_BATCH_WORDS; w++) {
+		this->_player1_wins[w] = (w < num_words) ? (this->_player1_wins[w] & this->_active[w]) : 0;
+	}
+}
+
+int HexBatchRollout::numGames() const {
+	return this->_num_games;
+}
+
+int HexBatchRollout::winner(int game) const {
+	ASSERT(0 <= game && game < this->_num_games, "There is no game " << game << " in the last pass");
+	return ((this->_player1_wins[game / 64] >> (game % 64)) & 1) ? 1 : -1;
+}
+
+int HexBatchRollout::numPlayer1Wins() const {
+	int num_wins = 0;
+	for (int w = 0; w < this->_num_words; w++) {
+		num_wins += __builtin_popcountll(this->_player1_wins[w]);
+	}
+	return num_wins;
+}
+
+int HexBatchRollout::firstAction(int game) const {
+	ASSERT(0 <= game && game < this->_num_games, "There is no game " << game << " in the last pass");
+	return this->_first_actions[game];
+}
+
+Bitboard HexBatchRollout::player1Stones(int game) const {
+	ASSERT(0 <= game && game < this->_num_games, "There is no game " << game << " in the last pass");
+	Bitboard stones;
+	const uint64_t* word = this->_player1.data()->words + (game / 64);
+	for (int pos = 0; pos < this->_num_cells; pos++) {
+		if ((word[this->_num_words * pos] >> (game % 64)) & 1) {
+			stones.set(pos);
+		}
+	}
+	return stones;
+}
+
+void HexBatchRollout::cellTotals(int pos, int player, int* num_filled, int* num_player1_wins) const {
+	ASSERT(0 <= pos && pos < this->_num_cells, "Illegal position " << pos << " for cellTotals");
+	const uint64_t* mask = this->_player1.data()->words + this->_num_words * pos;
+	*num_filled = 0;
+	*num_player1_wins = 0;
+	for (int w = 0; w < this->_num_words; w++) {
+		uint64_t filled = ((player == 1) ? mask[w] : ~mask[w]) & this->_active[w];
+		*num_filled += __builtin_popcountll(filled);
+		*num_player1_wins += __builtin_popcountll(filled & this->_player1_wins[w]);
+	}
+}
@@ -0,0 +1,110 @@
+#ifndef HEX_BATCH_ROLLOUT_H
+#define HEX_BATCH_ROLLOUT_H
+
+#include "bitboard.h"
+
+#include <stdint.h>
+#include <vector>
+
+using namespace std;
+
+
+/* Number of 64-bit words of games in one pass of the engine, and the number of games that makes. */
+const int HEX_BATCH_WORDS = 4;
+const int HEX_BATCH_GAMES = HEX_BATCH_WORDS * 64;
+
+
+/* One cell's mask for a full pass, aligned so that it loads into a single SIMD register. */
+struct alignas(HEX_BATCH_WORDS * 8) HexBatchMask {
+	uint64_t words[HEX_BATCH_WORDS];
+};
+
+
+/**
+ * A playout engine that plays many random Hex games out from one position at once.
+ *
+ * The games are bit-sliced: every cell has a mask with one bit per game (game G is bit G % 64 of word G / 64), so one 64-bit
+ * word holds a cell of 64 games, and one 256-bit SIMD register holds it for all HEX_BATCH_GAMES games of a pass.
+ * Like HexState::fillRollout, each game fills the empty cells at random, alternating players starting with the player to move
+ * (a full Hex board always has exactly one winner, which is the one a move-by-move playout would reach).
+ * The winners of all the games are then found together by a flood fill over the masks: a cell is reached from the north edge
+ * in a game if Player 1 holds it and one of its six neighbours is reached, which is a few bitwise operations for all the games at once.
+ *
+ * The fills are still drawn game by game, as a partial shuffle of the empty cells, so that every game gives exactly
+ * half of them to each player (random bits per cell would be faster, but would unbalance the games).
+ * On CPUs with AVX2 (checked once, at startup) the flood fill of a full pass runs on 256-bit registers.
+ *
+ * An engine is not thread-safe (each thread should use its own), and draws its random numbers from the calling thread's generator.
+ */
+class HexBatchRollout {
+
+public:
+
+	/* Creates an engine for boards of the given DIMENSION (which may be changed later with setDimension). */
+	HexBatchRollout(int dimension=0);
+
+	/* Sets up the engine for boards of the given DIMENSION x DIMENSION.  Does nothing if that is already the dimension. */
+	void setDimension(int dimension);
+
+	/* Returns the dimension of the boards the engine is set up for. */
+	int dimension() const;
+
+	/**
+	 * Plays NUM_GAMES random games (between 1 and HEX_BATCH_GAMES) out from the position with PLAYER1_STONES and
+	 * EMPTY_CELLS (every other cell holding a Player 2 stone), with TURN (1 or -1) to move, and keeps their results
+	 * until the next call.  There must be at least one empty cell, and the position must not already be won.
+	 * Passes of 64 games or fewer only work on one word of each mask.
+	 */
+	void play(const Bitboard& player1_stones, const Bitboard& empty_cells, int turn, int num_games);
+
+	/* Returns the number of games played by the last call to play. */
+	int numGames() const;
+
+	/* Returns 1 if Player 1 won game GAME of the last pass, and -1 if Player 2 did. */
+	int winner(int game) const;
+
+	/* Returns the number of games of the last pass that Player 1 won. */
+	int numPlayer1Wins() const;
+
+	/* Returns the first action of game GAME of the last pass (the cell the player to move filled first). */
+	int firstAction(int game) const;
+
+	/* Returns Player 1's stones on the full board that game GAME of the last pass ended with (Player 2 holds every other cell). */
+	Bitboard player1Stones(int game) const;
+
+	/**
+	 * Sets NUM_FILLED to the number of games of the last pass in which PLAYER (1 or -1) filled the (empty) cell POS,
+	 * and NUM_PLAYER1_WINS to the number of those games that Player 1 won.  Each is a popcount per word of the masks.
+	 */
+	void cellTotals(int pos, int player, int* num_filled, int* num_player1_wins) const;
+
+	/* Returns true if the flood fill uses AVX2 on this CPU. */
+	static bool usesAVX2();
+
+private:
+
+	int _dimension;
+	int _num_cells;
+	/* For each cell, the indices of its six neighbours in _reached: off-board neighbours are _num_cells (never reached), or _num_cells + 1 (always reached) north of row 0. */
+	vector<int16_t> _neighbors;
+	/* The empty cells of the position being played, which each game shuffles in place (a partial shuffle of any order is still uniformly random). */
+	vector<int16_t> _fill_order;
+
+	/**
+	 * The masks of a pass: the games in which Player 1 holds each cell, and the games in which the flood fill has reached it.
+	 * A pass of up to 64 games packs its masks one word per cell, at the start of the arrays.
+	 */
+	vector<HexBatchMask> _player1;
+	vector<HexBatchMask> _reached;
+	/* The games of the pass, and the ones Player 1 won. */
+	uint64_t _active[HEX_BATCH_WORDS];
+	uint64_t _player1_wins[HEX_BATCH_WORDS];
+	int _num_words;
+	int _num_games;
+	int16_t _first_actions[HEX_BATCH_GAMES];
+
+};
+
+
+
+#endif
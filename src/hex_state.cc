@@ -1,23 +1,49 @@
 #include "hex_state.h"
+#include "hex_batch_encoder.h"
+#include "hex_batch_rollout.h"
+#include "rng.h"
 #include "utils.h"
 
 #include <math.h>
 #include <iostream>
 #include <numeric>
-#include <stdlib.h> // srand, rand
+#include <new> // placement new
 
 
 using namespace std;
 
 
 HexState::HexState(int dimension, vector<int> board, string reward_type) {
-	this->_board = board;
 	this->_dimension = dimension;
-	this->_reward_type = reward_type;
-
+	this->_num_cells = dimension * dimension;
+	if (reward_type == "basic") {
+		this->_reward_type = HEX_REWARD_BASIC;
+	} else {
+		ASSERT(reward_type == "win_fast", "Only basic and win fast rewards supported, not " << reward_type);
+		this->_reward_type = HEX_REWARD_WIN_FAST;
+	}
+
+	ASSERT(this->_num_cells <= BITBOARD_MAX_CELLS, "Hex boards can have at most " << BITBOARD_MAX_CELLS << " cells");
+	ASSERT(board.size() == this->_num_cells, "Board vector must have " << this->_num_cells << " elements");
+
+	// place the stones into each player's Bitboard, and hash them
+	for (int symmetry = 0; symmetry < HEX_NUM_SYMMETRIES; symmetry++) {
+		this->_hashes[symmetry] = zobristBoardKey(dimension);
+	}
+	for (int pos = 0; pos < this->_num_cells; pos++) {
+		if (board[pos] == 1) {
+			this->_player1_stones.set(pos);
+			this->toggleStoneHashes(pos, 1);
+		} else if (board[pos] == -1) {
+			this->_player2_stones.set(pos);
+			this->toggleStoneHashes(pos, -1);
+		} else {
+			this->_empty_cells.set(pos);
+		}
+	}
 
 	// determine whose turn
-	int sum_pieces = accumulate(this->_board.begin(), this->_board.end(), 0);
+	int sum_pieces = this->_player1_stones.count() - this->_player2_stones.count();
 	ASSERT(sum_pieces == 0 || sum_pieces == 1, "incorrect sum_pieces");
 	if (sum_pieces == 0) {
 		this->_turn = 1;
@@ -25,19 +51,8 @@ HexState::HexState(int dimension, vector<int> board, string reward_type) {
 		this->_turn = -1;
 	}
 
-	// determine winner
-	this->_winner = this->determineWinner();
-	this->_is_terminal = (this->_winner != 0);
-
-	// determine legal actions
-	int num_total_actions = pow(dimension, 2);
-	if (!this->_is_terminal) {
-		for (int pos = 0; pos < num_total_actions; pos++) {
-			if (board[pos] == 0) {
-				this->_legal_actions.insert(pos);
-			}
-		}
-	}
+	// build the connectivity forest over all the stones, and determine winner
+	this->rebuildConnectivity();
 
 }
 
@@ -63,62 +78,185 @@ double HexState::reward() const {
 		return 0.0;
 	}
 
-	if (this->_reward_type == "basic") {
-		return (double) this->_winner;
-	}
+	return this->_winner * this->rewardMagnitude(this->numPiecesPlayed());
+}
 
-	if (this->_reward_type == "win_fast") {
-		int num_pieces_played = 0;
-		for (int piece : this->board()) {
-			if (piece != 0) {
-				num_pieces_played += 1;
-			}
-		}
-		return (double) (this->_winner * ((this->numActions() + 1) - num_pieces_played));
+double HexState::maxReward() const {
+	return this->rewardMagnitude(this->numPiecesPlayed());
+}
+
+int HexState::turn() const {
+	return this->_turn;
+}
+
+HexState* HexState::nextState(int action) {
+
+	ASSERT(this->isLegalAction(action), "illegal action " << action << " in nextState function for HexState");
+
+	if (this->isTerminalState()) {
+		return this;
 	}
 
-	return 0.0;
+	ASSERT(this->at(action) == 0, "Cannot make action " << action << " since it is already made in this Hex game");
+	HexState* next_state = new HexState(*this);
+	next_state->placeStone(action);
+	return next_state;
 }
 
-double HexState::maxReward() const {
+void HexState::applyAction(int action) {
+	ASSERT(this->isLegalAction(action), "illegal action " << action << " in applyAction function for HexState");
+	this->placeStone(action);
+}
 
-	if (this->_reward_type == "basic") {
-		return 1.0;
+void HexState::undoAction(int action) {
+
+	// the last stone was placed by the player whose turn it is not
+	int last_player = -1 * this->_turn;
+	ASSERT(0 <= action && action < this->_num_cells, "Illegal action " << action << " in undoAction function for HexState");
+	ASSERT(this->at(action) == last_player, "Cannot undo action " << action << " since it was not the last player's stone");
+
+	if (last_player == 1) {
+		this->_player1_stones.clear(action);
+	} else {
+		this->_player2_stones.clear(action);
 	}
+	this->_empty_cells.set(action);
+	this->toggleStoneHashes(action, last_player);
+	this->_turn = last_player;
+
+	this->rebuildConnectivity();
+}
+
+HexState* HexState::clone() const {
+	return new HexState(*this);
+}
+
+size_t HexState::sizeInBytes() const {
+	// the forest is the last member, so everything after its used elements is left off
+	size_t forest_offset = (const char*) &this->_connectivity - (const char*) this;
+	return forest_offset + this->_connectivity.sizeInBytes();
+}
+
+HexState* HexState::cloneInto(void* memory) const {
+	return new (memory) HexState(*this);
+}
 
-	if (this->_reward_type == "win_fast") {
-		int num_pieces_played = 0;
-		for (int piece : this->board()) {
-			if (piece != 0) {
-				num_pieces_played += 1;
+void HexState::copyFrom(const EnvState& other) {
+	const HexState* other_hex = dynamic_cast<const HexState*>(&other);
+	ASSERT(other_hex != NULL, "Can only copy a HexState from another HexState");
+	*this = *other_hex;
+}
+
+bool HexState::supportsFillRollout() const {
+	return true;
+}
+
+double HexState::fillRollout(vector<int>* rollout_actions, double* max_reward) const {
+
+	ASSERT(!this->isTerminalState(), "Cannot do a fill rollout from a terminal state");
+	ASSERT(max_reward != NULL, "Max reward must not be null");
+
+	// shuffle the empty cells (Fisher-Yates)
+	int fill_order[BITBOARD_MAX_CELLS];
+	int num_empty = 0;
+	for (int pos = this->_empty_cells.first(); pos != -1; pos = this->_empty_cells.next(pos)) {
+		fill_order[num_empty] = pos;
+		num_empty++;
+	}
+	Rng& rng = threadRng();
+	for (int i = num_empty - 1; i > 0; i--) {
+		int j = rng.uniformInt(i + 1);
+		int tmp = fill_order[i];
+		fill_order[i] = fill_order[j];
+		fill_order[j] = tmp;
+	}
+
+	// fill the board, alternating players starting with the player to move.
+	// a full Hex board always has exactly one winner, so checking Player 1 is enough
+	Bitboard player1_stones = this->_player1_stones;
+	int first_player = this->_turn;
+	for (int i = (first_player == 1) ? 0 : 1; i < num_empty; i += 2) {
+		player1_stones.set(fill_order[i]);
+	}
+	int winner = this->northSouthPathExists(player1_stones) ? 1 : -1;
+
+	// find the move that decided the game, by replaying the winner's cells in fill order.
+	// the loser's cells cannot affect the winner's connectivity, so they are skipped.
+	// with basic rewards and no actions requested, the decisive move does not matter
+	int decisive_move = num_empty - 1;
+	if (this->_reward_type != HEX_REWARD_BASIC || rollout_actions != NULL) {
+		HexState replay(*this);
+		int first = (winner == first_player) ? 0 : 1;
+		for (int i = first; i < num_empty; i += 2) {
+			int pos = fill_order[i];
+			if (winner == 1) {
+				replay._player1_stones.set(pos);
+			} else {
+				replay._player2_stones.set(pos);
+			}
+			replay.connectStone(pos, winner);
+			if (replay.determineWinner() == winner) {
+				decisive_move = i;
+				break;
 			}
 		}
-		return (double) ((this->numActions() + 1) - num_pieces_played);
 	}
 
-	ASSERT(false, "Only basic and win fast rewards supported");
+	if (rollout_actions != NULL) {
+		rollout_actions->assign(fill_order, fill_order + decisive_move + 1);
+	}
+
+	int num_pieces_played = this->numPiecesPlayed() + decisive_move + 1;
+	*max_reward = this->rewardMagnitude(num_pieces_played);
+	return winner * (*max_reward);
 }
 
-int HexState::turn() const {
-	return this->_turn;
+bool HexState::supportsBatchRollout() const {
+	return true;
 }
 
-HexState* HexState::nextState(int action) {
+void HexState::batchRollout(int num_rollouts, RolloutBatch* batch) const {
 
-	ASSERT(this->isLegalAction(action), "illegal action " << action << " in nextState function for HexState");
+	ASSERT(!this->isTerminalState(), "Cannot do batch rollouts from a terminal state");
+	ASSERT(batch != NULL, "Batch must not be null");
 
-	if (this->isTerminalState()) {
-		return this;
-	}
+	// each thread has its own engine, which keeps its masks between calls
+	thread_local HexBatchRollout engine;
+	engine.setDimension(this->_dimension);
 
-	ASSERT(this->at(action) == 0, "Cannot make action " << action << " since it is already made in this Hex game");
-	vector<int> new_board(this->board());
-	new_board[action] = this->turn();
-	return new HexState(this->_dimension, new_board, this->_reward_type);
+	for (int num_played = 0; num_played < num_rollouts; num_played += HEX_BATCH_GAMES) {
+		int num_games = min(num_rollouts - num_played, HEX_BATCH_GAMES);
+		engine.play(this->_player1_stones, this->_empty_cells, this->_turn, num_games);
+		for (int game = 0; game < num_games; game++) {
+			batch->addRolloutResult(engine.firstAction(game), engine.winner(game));
+		}
+
+		if (!batch->keepsRave()) {
+			continue;
+		}
+		// a game's reward is its winner, so a cell's total reward is (Player 1's wins - Player 2's wins) over the games it was filled in
+		for (int pos = this->_empty_cells.first(); pos != -1; pos = this->_empty_cells.next(pos)) {
+			for (int player_index = 0; player_index < 2; player_index++) {
+				int num_filled, num_player1_wins;
+				engine.cellTotals(pos, (player_index == 0) ? 1 : -1, &num_filled, &num_player1_wins);
+				batch->addRaveTotal(player_index, pos, num_filled, 2 * num_player1_wins - num_filled);
+			}
+		}
+	}
 }
 
 bool HexState::equals(const EnvState& other) const {
 
+	// compare Bitboards directly when the other state is also a Hex state
+	const HexState* other_hex = dynamic_cast<const HexState*>(&other);
+	if (other_hex != NULL) {
+		// the hashes differ for almost every pair of different boards, so check them first
+		return this->_hashes[0] == other_hex->_hashes[0] &&
+			this->_dimension == other_hex->_dimension &&
+			this->_player1_stones == other_hex->_player1_stones &&
+			this->_player2_stones == other_hex->_player2_stones;
+	}
+
 	vector<int> this_board = this->board();
 	vector<int> other_board = other.board();
 	if (this_board.size() != other_board.size()) {
@@ -133,35 +271,85 @@ bool HexState::equals(const EnvState& other) const {
 }
 
 bool HexState::isLegalAction(int action) const {
-	return this->_legal_actions.count(action) > 0;
+	if (this->_is_terminal || action < 0 || action >= this->_num_cells) {
+		return false;
+	}
+	return this->_empty_cells.test(action);
 }
 
-int HexState::randomAction() const {
-	int num_legal_moves = this->_legal_actions.size();
-	if (num_legal_moves <= 0) {
-		cout << "NUm legal moves <= 0" << endl;
-		this->printBoard();
-		cout << "is terminal? " << this->isTerminalState() << endl;
-		for (int pos = 0; pos < 25; pos++) {
-			cout << this->_board[pos] << " ";
-			if (this->_board[pos] == 0) {
-				cout << "POS: " << pos << endl;
-				//this->_legal_actions.insert(pos);
-			}
-		}
-		cout << endl;
+int HexState::legalActions(int* actions) const {
+	if (this->_is_terminal) {
+		return 0;
+	}
+	int num_legal = 0;
+	for (int pos = this->_empty_cells.first(); pos != -1; pos = this->_empty_cells.next(pos)) {
+		actions[num_legal] = pos;
+		num_legal += 1;
+	}
+	return num_legal;
+}
+
+uint64_t HexState::hash() const {
+	return this->_hashes[0];
+}
+
+uint64_t HexState::hashAfterAction(int action) const {
+	return this->_hashes[0] ^ zobristKey(action, this->_turn);
+}
+
+uint64_t HexState::canonicalHash(int* symmetry) const {
+	return this->smallestImageHash(this->_hashes, this->_turn, symmetry);
+}
+
+uint64_t HexState::canonicalHashAfterAction(int action, int* symmetry) const {
+	ASSERT(0 <= action && action < this->_num_cells, "Illegal action " << action << " in canonicalHashAfterAction for HexState");
+	uint64_t hashes[HEX_NUM_SYMMETRIES];
+	for (int s = 0; s < HEX_NUM_SYMMETRIES; s++) {
+		int player = this->symmetrySwapsPlayers(s) ? -this->_turn : this->_turn;
+		hashes[s] = this->_hashes[s] ^ zobristKey(this->symmetricAction(action, s), player);
+	}
+	return this->smallestImageHash(hashes, -this->_turn, symmetry);
+}
+
+int HexState::symmetricAction(int action, int symmetry) const {
+	ASSERT(0 <= symmetry && symmetry < HEX_NUM_SYMMETRIES, "Hex has no symmetry " << symmetry);
+	int cell = action;
+	if (symmetry & HEX_TRANSPOSE_SWAP) {
+		cell = this->pos(this->col(cell), this->row(cell));
+	}
+	if (symmetry & HEX_ROTATE) {
+		cell = this->_num_cells - 1 - cell;
 	}
+	return cell;
+}
+
+bool HexState::symmetrySwapsPlayers(int symmetry) const {
+	return (symmetry & HEX_TRANSPOSE_SWAP) != 0;
+}
+
+int HexState::randomAction() const {
+	int num_legal_moves = this->_is_terminal ? 0 : this->_empty_cells.count();
 	ASSERT(num_legal_moves > 0, "No legal moves available from this hex state.");
 	
-	int r = rand() % num_legal_moves;
-	set<int>::const_iterator it(this->_legal_actions.begin());
-	advance(it, r);
-	return *it;}
+	int r = threadRng().uniformInt(num_legal_moves);
+	return this->_empty_cells.select(r);
+}
 
 
 
 vector<int> HexState::board() const {
-	return this->_board;
+	vector<int> board(this->_num_cells, 0);
+	for (int pos = this->_player1_stones.first(); pos != -1; pos = this->_player1_stones.next(pos)) {
+		board[pos] = 1;
+	}
+	for (int pos = this->_player2_stones.first(); pos != -1; pos = this->_player2_stones.next(pos)) {
+		board[pos] = -1;
+	}
+	return board;
+}
+
+int HexState::numPiecesPlayed() const {
+	return this->_num_cells - this->_empty_cells.count();
 }
 
 void HexState::makeStateVector(vector<double>* state_vector) const {
@@ -205,21 +393,18 @@ void HexState::makeStateVector(vector<double>* state_vector) const {
 		state_vector->at((row_num * row_size) + right_col + channel_size) = 1.0;
 	}
 
-	// place Player stones
-	for (int pos = 0; pos < this->numActions(); pos++) {
-
+	// place Player 1 stones in first channel
+	for (int pos = this->_player1_stones.first(); pos != -1; pos = this->_player1_stones.next(pos)) {
 		int r = this->row(pos) + 2;
 		int c = this->col(pos) + 2;
+		state_vector->at((r * row_size) + c) = 1.0;
+	}
 
-		// Player 1 stone in first channel
-		if (this->_board[pos] == 1) {
-			state_vector->at((r * row_size) + c) = 1.0;
-		}
-
-		// Player 2 stone in second channel
-		if (this->_board[pos] == -1) {
-			state_vector->at((r * row_size) + c + channel_size) = 1.0;
-		}
+	// place Player 2 stones in second channel
+	for (int pos = this->_player2_stones.first(); pos != -1; pos = this->_player2_stones.next(pos)) {
+		int r = this->row(pos) + 2;
+		int c = this->col(pos) + 2;
+		state_vector->at((r * row_size) + c + channel_size) = 1.0;
 	}
 
 	// add the 2 bits for the turn
@@ -235,8 +420,29 @@ void HexState::makeStateVector(vector<double>* state_vector) const {
 
 }
 
+int HexState::nnInputSize() const {
+	int padded_dim = this->_dimension + 4;
+	return 2 * padded_dim * padded_dim;
+}
+
+void HexState::encodeNNInput(float* x, float* turn_mask) const {
+
+	ASSERT(x != NULL && turn_mask != NULL, "Cannot encode a state into null memory");
+
+	// each thread has its own engine, which keeps the padding of its dimension between calls
+	thread_local HexBatchEncoder encoder;
+	encoder.setDimension(this->_dimension);
+	if (this->isTerminalState()) {
+		encoder.encodeTerminal(x, turn_mask);
+	}
+	else {
+		encoder.encode(this->_player1_stones, this->_player2_stones, this->turn(), x, turn_mask);
+	}
+
+}
+
 int HexState::numActions() const {
-	return pow(this->_dimension, 2);
+	return this->_num_cells;
 }
 
 
@@ -248,7 +454,13 @@ int HexState::numActions() const {
 
 int HexState::at(int pos) const {
 	ASSERT(0 <= pos && pos < this->numActions(), "Illegal position argument to at function");
-	return this->_board[pos];
+	if (this->_player1_stones.test(pos)) {
+		return 1;
+	}
+	if (this->_player2_stones.test(pos)) {
+		return -1;
+	}
+	return 0;
 
 }
 
@@ -335,128 +547,196 @@ int HexState::eastNeighbor(int pos) const {
 
 }
 
-vector<int> HexState::neighbors(int pos) const {
+int HexState::neighbors(int pos, int* neighbor_list) const {
 	
-	int nw = this->northwestNeighbor(pos);
-    int ne = this->northeastNeighbor(pos);
-    int sw = this->southwestNeighbor(pos);
-    int se = this->southeastNeighbor(pos);
-    int w = this->westNeighbor(pos);
-    int e = this->eastNeighbor(pos);
+	int all_neighbors[6] = {
+		this->northwestNeighbor(pos),
+		this->northeastNeighbor(pos),
+		this->southwestNeighbor(pos),
+		this->southeastNeighbor(pos),
+		this->westNeighbor(pos),
+		this->eastNeighbor(pos)
+	};
+
+	int num_neighbors = 0;
+	for (int neighbor : all_neighbors) {
+		if (neighbor != -1) {
+			neighbor_list[num_neighbors] = neighbor;
+			num_neighbors++;
+		}
+	}
+
+	return num_neighbors;
+}
 
-    vector<int> all_neighbors = {nw, ne, sw, se, w, e};
-    vector<int> existing_neighbors;
-    for (int neighbor : all_neighbors) {
-    	if (neighbor != -1) {
-    		existing_neighbors.push_back(neighbor);
-    	}
-    }
 
-    return existing_neighbors;
+int HexState::northEdge() const {
+	return this->_num_cells;
 }
 
+int HexState::southEdge() const {
+	return this->_num_cells + 1;
+}
 
-bool HexState::southwardPathExists(int start_pos, int end_row, vector<bool>& visited) const {
-	
-	ASSERT(0 <= start_pos && start_pos < this->numActions(), "Illegal start position argument to southwardPathExists function");
-	ASSERT(0 <= end_row && end_row < this->_dimension, "Illegal end row argument to southwardPathExists function");
-	ASSERT(visited.size() == this->numActions(), "Visited bitvector is incorrect size in southwardPathExists function");
+int HexState::westEdge() const {
+	return this->_num_cells + 2;
+}
 
-	// this spot must be occupied by Player 1
-	if (this->at(start_pos) != 1) {
-		return false;
-	}
+int HexState::eastEdge() const {
+	return this->_num_cells + 3;
+}
 
-	// if we are in the end row, return true
-	if (this->row(start_pos) == end_row) {
-		return true;
-	}
 
-	// mark this spot visited
-	visited[start_pos] = true;
+void HexState::connectStone(int pos, int player) {
 
-	vector<int> neighbors = this->neighbors(start_pos);
-	for (int neighbor : neighbors) {
-		if (!visited[neighbor]) {
-			if (this->southwardPathExists(neighbor, end_row, visited)) {
-				return true;
-			}
+	ASSERT(player == 1 || player == -1, "Player must be 1 or -1");
+	const Bitboard& own_stones = (player == 1) ? this->_player1_stones : this->_player2_stones;
+
+	// merge with every neighboring stone of the same player
+	int neighbor_list[6];
+	int num_neighbors = this->neighbors(pos, neighbor_list);
+	for (int n = 0; n < num_neighbors; n++) {
+		if (own_stones.test(neighbor_list[n])) {
+			this->_connectivity.unite(pos, neighbor_list[n]);
 		}
 	}
 
-	return false;
-
+	// merge with this player's virtual edges
+	if (player == 1) {
+		if (this->row(pos) == 0) {
+			this->_connectivity.unite(pos, this->northEdge());
+		}
+		if (this->row(pos) == this->_dimension - 1) {
+			this->_connectivity.unite(pos, this->southEdge());
+		}
+	} else {
+		if (this->col(pos) == 0) {
+			this->_connectivity.unite(pos, this->westEdge());
+		}
+		if (this->col(pos) == this->_dimension - 1) {
+			this->_connectivity.unite(pos, this->eastEdge());
+		}
+	}
 }
 
-bool HexState::eastwardPathExists(int start_pos, int end_col, vector<bool>& visited) const {
 
-	ASSERT(0 <= start_pos && start_pos < this->numActions(), "Illegal start position argument to eastwardPathExists function");
-	ASSERT(0 <= end_col && end_col < this->_dimension, "Illegal end col argument to eastwardPathExists function");
-	ASSERT(visited.size() == this->numActions(), "Visited bitvector is incorrect size in eastwardPathExists function");
+void HexState::placeStone(int pos) {
 
-	// this spot must be occupied by Player 2
-	if (this->at(start_pos) != -1) {
-		return false;
+	int player = this->_turn;
+	if (player == 1) {
+		this->_player1_stones.set(pos);
+	} else {
+		this->_player2_stones.set(pos);
 	}
+	this->_empty_cells.clear(pos);
+	this->toggleStoneHashes(pos, player);
+	this->_turn *= -1;
 
-	// if we are in the end col, return true
-	if (this->col(start_pos) == end_col) {
-		return true;
+	// only the player who just moved can have completed a path
+	this->connectStone(pos, player);
+	if (player == 1 && this->_connectivity.connected(this->northEdge(), this->southEdge())) {
+		this->_winner = 1;
+	} else if (player == -1 && this->_connectivity.connected(this->westEdge(), this->eastEdge())) {
+		this->_winner = -1;
 	}
+	this->_is_terminal = (this->_winner != 0);
+}
 
-	// mark this spot visited
-	visited[start_pos] = true;
 
-	vector<int> neighbors = this->neighbors(start_pos);
-	for (int neighbor : neighbors) {
-		if (!visited[neighbor]) {
-			if (this->eastwardPathExists(neighbor, end_col, visited)) {
-				return true;
-			}
+void HexState::toggleStoneHashes(int pos, int player) {
+	// rotating a cell reverses its index, and transposing it swaps its row and column
+	int transposed = (this->col(pos) * this->_dimension) + this->row(pos);
+	this->_hashes[0] ^= zobristKey(pos, player);
+	this->_hashes[HEX_ROTATE] ^= zobristKey(this->_num_cells - 1 - pos, player);
+	this->_hashes[HEX_TRANSPOSE_SWAP] ^= zobristKey(transposed, -player);
+	this->_hashes[HEX_ROTATE | HEX_TRANSPOSE_SWAP] ^= zobristKey(this->_num_cells - 1 - transposed, -player);
+}
+
+uint64_t HexState::smallestImageHash(const uint64_t* hashes, int turn, int* symmetry) const {
+	int best_symmetry = 0;
+	uint64_t best_hash = 0;
+	for (int s = 0; s < HEX_NUM_SYMMETRIES; s++) {
+		int image_turn = this->symmetrySwapsPlayers(s) ? -turn : turn;
+		uint64_t image_hash = hashes[s] ^ ((image_turn == -1) ? zobristTurnKey() : 0);
+		if (s == 0 || image_hash < best_hash) {
+			best_symmetry = s;
+			best_hash = image_hash;
 		}
 	}
-
-	return false;
-
+	if (symmetry != NULL) {
+		*symmetry = best_symmetry;
+	}
+	return best_hash;
 }
 
-bool HexState::northSouthPathExists() const {
-	int end_row = this->_dimension - 1;
+bool HexState::northSouthPathExists(const Bitboard& stones) const {
 
-	// look for southward paths starting at all the positions on the top row
-	for (int pos = 0; pos < this->_dimension; pos++) {
-		vector<bool> visited(this->numActions(), false);
-		if (this->southwardPathExists(pos, end_row, visited)) {
+	int dim = this->_dimension;
+	Bitboard all_cells = Bitboard::full(this->_num_cells);
+	Bitboard south_row = all_cells.andNot(Bitboard::full(this->_num_cells - dim));
+	Bitboard not_west = all_cells.andNot(this->columnMask(0));
+	Bitboard not_east = all_cells.andNot(this->columnMask(dim - 1));
+
+	Bitboard reached = stones & Bitboard::full(dim);
+	while (true) {
+		if (!(reached & south_row).empty()) {
 			return true;
 		}
+
+		// position K has neighbors K - dim, K + dim, and (depending on its column) K - dim + 1, K + dim - 1, K - 1 and K + 1
+		Bitboard west_movers = reached & not_west;
+		Bitboard east_movers = reached & not_east;
+		Bitboard grown = reached | reached.shiftDown(dim) | reached.shiftUp(dim) |
+			east_movers.shiftDown(dim - 1) | west_movers.shiftUp(dim - 1) |
+			west_movers.shiftDown(1) | east_movers.shiftUp(1);
+		grown = grown & stones;
+
+		if (grown == reached) {
+			return false;
+		}
+		reached = grown;
 	}
+}
 
-	return false;
+Bitboard HexState::columnMask(int col) const {
+	Bitboard mask;
+	for (int r = 0; r < this->_dimension; r++) {
+		mask.set(this->pos(r, col));
+	}
+	return mask;
 }
 
-bool HexState::westEastPathExists() const {
-	int end_col = this->_dimension - 1;
+double HexState::rewardMagnitude(int num_pieces_played) const {
 
-	// look for eastward paths starting at all the positions on the left col
-	for (int pos = 0; pos < this->numActions(); pos += this->_dimension) {
-		vector<bool> visited(this->numActions(), false);
-		if (this->eastwardPathExists(pos, end_col, visited)) {
-			return true;
-		}
+	if (this->_reward_type == HEX_REWARD_BASIC) {
+		return 1.0;
 	}
 
-	return false;
+	return (double) ((this->numActions() + 1) - num_pieces_played);
+}
+
+
+void HexState::rebuildConnectivity() {
+	this->_connectivity.reset(this->_num_cells + UNION_FIND_NUM_VIRTUAL);
+	for (int pos = this->_player1_stones.first(); pos != -1; pos = this->_player1_stones.next(pos)) {
+		this->connectStone(pos, 1);
+	}
+	for (int pos = this->_player2_stones.first(); pos != -1; pos = this->_player2_stones.next(pos)) {
+		this->connectStone(pos, -1);
+	}
+	this->_winner = this->determineWinner();
+	this->_is_terminal = (this->_winner != 0);
 }
 
 
-int HexState::determineWinner() const {
+int HexState::determineWinner() {
 	// check if there is a North to South path
-	if (this->northSouthPathExists()) {
+	if (this->_connectivity.connected(this->northEdge(), this->southEdge())) {
 		return 1;
 	}
 
 	// check if there is a West to East path
-	if (this->westEastPathExists()) {
+	if (this->_connectivity.connected(this->westEdge(), this->eastEdge())) {
 		return -1;
 	}
 
@@ -2,20 +2,42 @@
 #define HEX_STATE_H
 
 #include "env_state.h"
+#include "bitboard.h"
+#include "union_find.h"
+#include "zobrist.h"
 #include <vector>
-#include <set>
 #include <string>
 
 using namespace std;
 
+
+/**
+ * The symmetries of a Hex board.  Rotating the board by 180 degrees leaves every position as it was, and transposing it
+ * (swapping rows and columns) while swapping the players' colours does too, since the players' edges swap along with them.
+ * A symmetry is a combination of the two, and is numbered by bits: HEX_ROTATE, HEX_TRANSPOSE_SWAP, both, or neither (0).
+ * Each is its own inverse, and they commute, so composing two symmetries XORs their numbers.
+ */
+const int HEX_ROTATE = 1;
+const int HEX_TRANSPOSE_SWAP = 2;
+const int HEX_NUM_SYMMETRIES = 4;
+
+
+/* The reward functions a HexState can use (see the HexState constructor). */
+enum HexRewardType {
+	HEX_REWARD_BASIC,
+	HEX_REWARD_WIN_FAST
+};
+
 class HexState : public EnvState {
 
 public:
 
 	/** Creates a new Hex game state.  The board is of size DIMENSION x DIMENSION, and the stones are specified by the given BOARD vector.
 	 * 1 represents a white stone, and -1 represents a black.
+	 * Internally the stones are stored as one Bitboard per player, so DIMENSION x DIMENSION may be at most BITBOARD_MAX_CELLS.
 	 * Also takes in a string which specifies which reward function to use. 
 	 * "basic" means a simple 1/0/-1 reward. "win_fast" means ((num_total_hexagons + 1) - num_hexagons_played) * winner()
+	 * Errors if the reward type is neither of these.
 	 */
 	HexState(int dimension, vector<int> board, string reward_type="win_fast");
 
@@ -69,14 +91,101 @@ public:
 	 * Errors if the given action is illegal.
 	 */
 	virtual HexState* nextState(int action);
+
+	/**
+	 * Places a stone for the current player at the given position, in place.
+	 * The connectivity forest is updated incrementally, so this is near-constant time and never allocates.
+	 * Errors if the given action is illegal.
+	 */
+	void applyAction(int action);
+
+	/**
+	 * Removes the stone at the given position, which must have been the last stone placed, in place.
+	 * Union-find merges cannot be split, so this rebuilds the connectivity forest from the remaining stones,
+	 * which costs O(number of cells).  It still never allocates.
+	 */
+	void undoAction(int action);
+
+	/* Returns a newly allocated copy of this state. */
+	HexState* clone() const;
+
+	/**
+	 * Returns the number of bytes of this state that are in use.  This leaves off the part of the connectivity forest
+	 * that this board's cells do not need, so a state's size grows with its board rather than always being sizeof(HexState).
+	 */
+	size_t sizeInBytes() const;
+
+	/* Copies this state into the given memory.  All of a HexState lives inline, so this is a flat copy of its used bytes. */
+	HexState* cloneInto(void* memory) const;
+
+	/**
+	 * Overwrites this state with a copy of OTHER.  All of a HexState lives inline, so this is a flat copy of OTHER's used bytes.
+	 * A state made by cloneInto only has room for boards up to its own size; states made any other way have room for any board.
+	 * Errors if OTHER is not a HexState.
+	 */
+	void copyFrom(const EnvState& other);
+
+	/* Hex states support fill rollouts. */
+	bool supportsFillRollout() const;
+
+	/**
+	 * Hex cannot end in a draw, and filling the board is the same as playing it out, so the rollout is done in one go:
+	 * the empty cells are shuffled once and assigned alternately to the two players (starting with the player to move),
+	 * and a single flood fill over the full board determines the winner.
+	 *
+	 * To report the same reward as a move-by-move playout (which matters for win_fast), the move that decided the game
+	 * is then recovered by replaying only the winner's cells, in fill order, until the winner's edges connect.
+	 * ROLLOUT_ACTIONS (if not NULL) holds the fill order up to and including that decisive move.
+	 */
+	double fillRollout(vector<int>* rollout_actions, double* max_reward) const;
+
+	/* Hex states support batch rollouts. */
+	bool supportsBatchRollout() const;
+
+	/**
+	 * Plays the rollouts on this thread's HexBatchRollout engine (see hex_batch_rollout.h), up to HEX_BATCH_GAMES at a time.
+	 * Every rollout's reward is its winner (as for normalized fill rollouts).  The RAVE totals credit each player with every cell
+	 * they filled, rather than stopping at the move that decided the game as fillRollout does.
+	 */
+	void batchRollout(int num_rollouts, RolloutBatch* batch) const;
 	
 	/**
 	 * Return true if the given action is legal to take from the current board.
 	 */
 	bool isLegalAction(int action) const;
+
+	/**
+	 * Writes the legal actions (the empty cells, unless the game is over) into ACTIONS, in increasing order, and returns how many there are.
+	 * Walks the set bits of the empty-cell Bitboard, rather than checking every cell.
+	 */
+	int legalActions(int* actions) const;
+
+	/* Returns the Zobrist hash of the board (see zobrist.h).  Since the turn follows from the stones, it is not hashed separately. */
+	uint64_t hash() const;
+
+	/* Returns the Zobrist hash of the board after the player whose turn it is plays ACTION. */
+	uint64_t hashAfterAction(int action) const;
+
+	/**
+	 * Returns the smallest hash of the board's images under the four symmetries (see HEX_ROTATE), with the player to move
+	 * included (the players swap under HEX_TRANSPOSE_SWAP).  The image hashes are kept up to date along with the hash, so this is O(1).
+	 * Since Player 1 always moves first, the colour-swapped image of a position is never itself a legal position:
+	 * two different positions that share a canonical hash are always 180 degree rotations of each other.
+	 */
+	uint64_t canonicalHash(int* symmetry=NULL) const;
+
+	/* Returns the canonical hash of the board after the player whose turn it is plays ACTION.  O(1). */
+	uint64_t canonicalHashAfterAction(int action, int* symmetry=NULL) const;
+
+	/* Returns the cell that ACTION's cell is mapped to by the given SYMMETRY. */
+	int symmetricAction(int action, int symmetry) const;
+
+	/* Returns true if SYMMETRY includes HEX_TRANSPOSE_SWAP. */
+	bool symmetrySwapsPlayers(int symmetry) const;
 	
 	/**
 	 * Return an action, chosen uniformly at random from the available legal actions.
+	 * Picks a random index into the empty cells, and selects that set bit of the empty-cell Bitboard, so this is O(1) in the number of cells.
 	 * If there are no legal actions, error.
 	 */
 	int randomAction() const;
@@ -84,9 +193,13 @@ public:
 	
 	/**
 	 * Returns the vector that represents the board.
+	 * This builds a fresh vector from the Bitboards, so avoid it in hot code.
 	 */
 	vector<int> board() const;
 
+	/* Returns the number of stones that have been played on this board. */
+	int numPiecesPlayed() const;
+
 
 	/* Populates the given vector with the Neural Net representaion of this state. 
 	 * Creates channels out of the board.
@@ -97,13 +210,23 @@ public:
 	 */
 	void makeStateVector(vector<double>* state_vector) const;
 
+	/* Returns the size of the two padded channels of makeStateVector: 2 x (DIMENSION + 4) x (DIMENSION + 4). */
+	int nnInputSize() const;
+
+	/**
+	 * Writes the two padded channels of makeStateVector to X in NHWC order (X[(row * (DIMENSION + 4) + col) * 2 + channel]),
+	 * and its turn bits to TURN_MASK.  A terminal state gets blank channels, and the turn mask of Player 1.
+	 * Encodes on this thread's HexBatchEncoder (see hex_batch_encoder.h), which copies in the padding whole, and then sets the stones.
+	 */
+	void encodeNNInput(float* x, float* turn_mask) const;
+
 	/* Returns the number of actions for this game. (dimension x dimension). */
 	int numActions() const;
 
 	/* Prints a human-readable representation of the board */
 	void printBoard() const;
 
-	/* Returns the board vector, represented as a CSV string. */
+	/* Returns the state vector (see makeStateVector), represented as a CSV string, as it is written to the training data. */
 	string asCSVString() const; 
 
 	/**
@@ -171,43 +294,62 @@ private:
 	int eastNeighbor(int pos) const;
 
 	/**
-	 * Returns a vector of the neighbors of the given position (all of them that aren't -1).
+	 * Populates NEIGHBOR_LIST with the neighbors of the given position (all of them that aren't -1).
+	 * NEIGHBOR_LIST must have room for 6 positions.  Returns the number of neighbors.
 	 */
-	vector<int> neighbors(int pos) const;
+	int neighbors(int pos, int* neighbor_list) const;
 
 
-	
+	/* Indices of the virtual edge nodes in the _connectivity forest (they come right after the cells). */
+	int northEdge() const;
+	int southEdge() const;
+	int westEdge() const;
+	int eastEdge() const;
+
 	/**
-	 * Returns true if there is a southward path connecting Player 1's pieces from the given start position
-	 * to some spot in the given end row.
-	 * The visited bitvector is to assist with the path traversal algorithm.
-	 * Errors if the given position or the given end row is out of range.
+	 * Adds the stone at position POS, which belongs to PLAYER (1 or -1), to the _connectivity forest.
+	 * The stone is merged with each neighboring stone of the same player, and with the virtual edge nodes of
+	 * that player's two board edges if it lies on them (north/south for Player 1, west/east for Player 2).
 	 */
-	bool southwardPathExists(int start_pos, int end_row, vector<bool>& visited) const;
+	void connectStone(int pos, int player);
 
 	/**
-	 * Returns true if there is an eastward path connecting Player 2's pieces from the given start position
-	 * to some spot in the given end col.
-	 * The visited bitvector is to assist with the path traversal algorithm.
-	 * Errors if the given position or the given end col is out of range.
+	 * Returns 1 if Player 1 wins this board, -1 if Player 2 wins, and 0 if nobody wins.
+	 * A player has won once their two virtual edge nodes are in the same set of the _connectivity forest.
 	 */
-	bool eastwardPathExists(int start_pos, int end_col, vector<bool>& visited) const;
+	int determineWinner();
 
 	/**
-	 * Returns true if there is a path of Player 1 pieces from the north row to the south row.
+	 * Returns true if the given stones connect the north and south edges of the board.
+	 * Does a flood fill over whole Bitboards, growing the set of stones reached from the north edge by all six
+	 * neighbor shifts at once until it touches the south edge or stops growing.
 	 */
-	bool northSouthPathExists() const;
+	bool northSouthPathExists(const Bitboard& stones) const;
+
+	/* Returns the positions in the given column of the board. */
+	Bitboard columnMask(int col) const;
 
 	/**
-	 * Returns true if there is a path of Player 2 pieces from the west col to the east col.
+	 * Adds (or removes, since it is an XOR) a stone of PLAYER at POS to the hash of each of the board's symmetric images.
+	 * Image S gets the key of the stone that POS and PLAYER map to under symmetry S.
 	 */
-	bool westEastPathExists() const;
+	void toggleStoneHashes(int pos, int player);
 
+	/* Returns the smallest of the image hashes in HASHES, with the turn key added where the image's player to move is Player 2. */
+	uint64_t smallestImageHash(const uint64_t* hashes, int turn, int* symmetry) const;
+
+	/* Returns the absolute value of the reward for a game won after NUM_PIECES_PLAYED pieces have been placed. */
+	double rewardMagnitude(int num_pieces_played) const;
+
+	/* Rebuilds the _connectivity forest from scratch out of the stones on the board, and redetermines the winner. */
+	void rebuildConnectivity();
 
 	/**
-	 * Returns 1 if Player 1 wins this board, -1 if Player 2 wins, and 0 if nobody wins.
+	 * Places a stone for the player whose turn it is at the given (empty) position,
+	 * passes the turn, and updates the winner and terminal flag.
+	 * Only the new stone is merged into the _connectivity forest, so this runs in near-constant time.
 	 */
-	int determineWinner() const;
+	void placeStone(int pos);
 
 
 	/*** Utility helper functions ***/
@@ -218,12 +360,16 @@ private:
 	void printRow(int row) const;
 
 	int _dimension;
-	vector<int> _board;
+	int _num_cells;
+	Bitboard _player1_stones;
+	Bitboard _player2_stones;
+	Bitboard _empty_cells; // exactly the legal actions, unless the state is terminal
 	int _turn;
 	bool _is_terminal;
 	double _winner;
-	string _reward_type;
-	set<int> _legal_actions;
+	HexRewardType _reward_type;
+	uint64_t _hashes[HEX_NUM_SYMMETRIES]; // Zobrist hash of the stones under each symmetry (_hashes[0] is the board's own), updated as stones are placed and removed
+	UnionFind _connectivity; // groups of connected same-player stones, plus the four virtual board edges.  Must be the last member (see sizeInBytes)
 	
 };
 
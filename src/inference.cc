@@ -1,6 +1,8 @@
 #include "hex_state.h"
 #include "inference.h"
 
+#include <string.h> // memcpy
+
 using namespace std;
 using namespace tensorflow;
 
@@ -27,7 +29,7 @@ DataType dataTypeFromString(const string& data_type) {
 
  * Let N, H, W, C be the dimensions of the tensor (as given in SHAPE).
  * This is how the tensor is laid out:
- * tensor[n, h, w, c] = vec[n][((h * H) + w) + ((h * w) * c)].
+ * tensor[n, h, w, c] = vec[n][((h * W) + w) + ((H * W) * c)].
  *  
  * This function returns the tensor.
  */
@@ -37,14 +39,16 @@ void make4DTensor(Tensor* tensor, const vector<vector<double>>& vec, const vecto
     int N = shape[0], H = shape[1], W = shape[2], C = shape[3];
     ASSERT(vec.size() >= N, "Vector must have at least size << N");
 
-    // populate the tensor
+    // populate the tensor.  each vector holds its channels one after the other, so channel c starts at c * H * W
+    auto data = tensor->tensor<float, 4>();
+    int channel_size = H * W;
     for (int n = 0; n < N; n++) {
         ASSERT(vec[n].size() >= H*W*C, "Vector must have at least size " << H*W*C);
+        const double* values = vec[n].data();
         for (int h = 0; h < H; h++) {
             for (int w = 0; w < W; w++) {
                 for (int c = 0; c < C; c++) {
-                    auto data = tensor->tensor<float, 4>();
-                    data(n, h, w, c) = vec[n][ ((h * H) + w) + (c * 81) ] ;
+                    data(n, h, w, c) = values[(h * W) + w + (c * channel_size)];
                 }
             }
         }
@@ -101,10 +105,10 @@ void make2DTensor(Tensor* tensor, const vector<vector<double>>& vec, const vecto
     ASSERT(vec.size() >= N, "Vector must have at least size << N");
 
     // populate the tensor
+    auto data = tensor->tensor<float, 2>();
     for (int n = 0; n < N; n++) {
         ASSERT(vec[n].size() >= D, "Vector must have at least size " << D);
         for (int d = 0; d < D; d++) {
-            auto data = tensor->tensor<float, 2>();
             data(n, d) = vec[n][d]; 
         }
     }
@@ -217,51 +221,15 @@ void createTensorsFromStates(int batch_size, const vector<EnvState*>& states, ve
     ASSERT(states.size() >= batch_size, "Must have at least " << batch_size << " states in the states vector");
 
     if (batch_size == 0) return;
-    EnvState* state = states[0];
-
-    int channel_dim = sqrt(states[0]->numActions()) + 4;
-    int channel_size = pow(channel_dim, 2);
-    int num_channels = 2;
-    int x_dim = channel_size * num_channels;
-    vector<int> x_shape = {batch_size, channel_dim, channel_dim, num_channels};
-
-    // initialize the x batch and turn mask batch
-    vector<vector<double>> x_batch(batch_size);
-    vector<vector<double>> turn_mask_batch(batch_size);
-
-    // populate the batches
-    for (int state_num = 0; state_num < batch_size; state_num++) {
-        
-        // if this state is terminal, just create a dummy x vector
-        if (states[state_num]->isTerminalState()) {
-            vector<double> dummy_x(x_dim, 0.0);
-            x_batch[state_num] = dummy_x;
-            turn_mask_batch[state_num] = {1.0, 0.0};
-            continue;
-        }
 
-        // if state is non terminal, create add it to a batch of x and turn_mask tensors
-        EnvState* state = states[state_num];
-        vector<double> state_vector;
-        state->makeStateVector(&state_vector);
-        x_batch[state_num] = state_vector;
-        
-        vector<double> turn_mask;
-        if (state->turn() == 1) {
-            turn_mask = {1.0, 0.0};
-        } else if (state->turn() == -1) {
-            turn_mask = {0.0, 1.0};
-        }
-        turn_mask_batch[state_num] = turn_mask;
-
-
-    }
+    int input_size = states[0]->nnInputSize();
+    int channel_dim = sqrt(input_size / 2);
+    ASSERT(2 * channel_dim * channel_dim == input_size, "The model needs 2 square channels per state, not " << input_size << " values");
 
+    // encode the states straight into the tensors' memory (a terminal state gets blank channels, and Player 1's turn mask)
     Tensor x(DT_FLOAT, TensorShape({batch_size, channel_dim, channel_dim, 2}));
-    makeTensorBatch(&x, x_batch, x_shape);
-
     Tensor turn_mask(DT_FLOAT, TensorShape({batch_size, 2}));
-    makeTensorBatch(&turn_mask, turn_mask_batch, {batch_size, 2});
+    encodeNNBatch(states, batch_size, x.flat<float>().data(), turn_mask.flat<float>().data());
 
     feed_dict->push_back(make_pair("x", x));
     feed_dict->push_back(make_pair("turn_mask", turn_mask));
@@ -274,6 +242,68 @@ void createTensorsFromStates(int batch_size, const vector<EnvState*>& states, ve
 
 
 
+SessionEvaluator::SessionEvaluator(Session* session) {
+    ASSERT(session != NULL, "Cannot have a null session");
+    this->_session = session;
+    this->_padded_dim = 0;
+}
+
+SessionEvaluator::~SessionEvaluator() {
+    for (auto& entry : this->_tensors) {
+        delete entry.second.first;
+        delete entry.second.second;
+    }
+}
+
+void SessionEvaluator::layout(EnvState* example, vector<int>* input_sizes, int* output_size) {
+    ASSERT(example->nnInputSize() > 0, "The model needs states with an NN input encoding");
+    this->_padded_dim = sqrt(example->nnInputSize() / 2);
+    ASSERT(2 * this->_padded_dim * this->_padded_dim == example->nnInputSize(), "The model needs 2 square planes per state");
+    *input_sizes = {example->nnInputSize(), 2};
+    *output_size = example->numActions();
+}
+
+BatchBuffer* SessionEvaluator::newBuffer(int capacity, const vector<int>& input_sizes, int output_size) {
+
+    ASSERT(input_sizes.size() == 2 && input_sizes[0] == 2 * this->_padded_dim * this->_padded_dim && input_sizes[1] == 2,
+        "A session evaluator's buffers must have the layout it gave");
+
+    // the workers encode straight into the tensors that are fed to the session
+    Tensor* x = new Tensor(DT_FLOAT, TensorShape({capacity, this->_padded_dim, this->_padded_dim, 2}));
+    Tensor* turn_mask = new Tensor(DT_FLOAT, TensorShape({capacity, 2}));
+    vector<float*> inputs = {x->flat<float>().data(), turn_mask->flat<float>().data()};
+    BatchBuffer* buffer = new BatchBuffer(capacity, inputs, input_sizes, output_size);
+    this->_tensors[buffer] = make_pair(x, turn_mask);
+    return buffer;
+}
+
+void SessionEvaluator::encode(EnvState* state, BatchBuffer* buffer, int row) {
+    state->encodeNNInput(buffer->input(0, row), buffer->input(1, row));
+}
+
+void SessionEvaluator::evaluate(BatchBuffer* buffer, int num_rows) {
+
+    ASSERT(this->_tensors.count(buffer) > 0, "Can only evaluate buffers made by this evaluator");
+    if (num_rows == 0) return;
+
+    // feed the first NUM_ROWS rows of the buffer's tensors (a slice shares the tensor's memory)
+    pair<Tensor*, Tensor*> tensors = this->_tensors[buffer];
+    vector<pair<string, Tensor>> feed_dict = {
+        make_pair("x", tensors.first->Slice(0, num_rows)),
+        make_pair("turn_mask", tensors.second->Slice(0, num_rows))
+    };
+    vector<Tensor> output_tensors;
+    Status status = predictBatch(this->_session, feed_dict, {"output"}, &output_tensors);
+    ASSERT(status.ok(), "Error running inference on a batch of " << num_rows << " states: " << status.ToString());
+
+    // hand the action distributions back in the buffer
+    ASSERT(output_tensors[0].dim_size(0) == num_rows && output_tensors[0].dim_size(1) == buffer->outputSize(),
+        "The model gave " << output_tensors[0].dim_size(1) << " action probabilities per state, instead of " << buffer->outputSize());
+    memcpy(buffer->output(0), output_tensors[0].flat<float>().data(), (size_t) num_rows * buffer->outputSize() * sizeof(float));
+}
+
+
+
 
 /*int foo(int argc, char* argv[]) {
 
@@ -5,6 +5,10 @@
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/protobuf/meta_graph.pb.h"
 
+#include "inference_service.h"
+
+#include <map>
+
 using namespace std;
 using namespace tensorflow;
 
@@ -56,13 +60,47 @@ Status predictBatch(Session* session, const vector<pair<string, Tensor>>& feed_d
 /**
  * Assumes batch tensors for each of the states in STATES.
  * For now, assumes they are all hex states.
- * Creates a batch of X (the channel representation) and a batch of turn_mask.
+ * Creates a batch of X (the channel representation) and a batch of turn_mask, encoding the states straight into them (see encodeNNBatch).
  * Maps "x" to the x tensor, and "turn_mask" to the turn_mask tensor in feed_dict.
  * Adds "output" to output_ops.
  */
 void createTensorsFromStates(int batch_size, const vector<EnvState*>& states, vector<pair<string, Tensor>>* feed_dict, vector<string>* output_ops);
 
 
+/**
+ * Evaluates batches of (hex) states for an InferenceService, with the model restored into SESSION (see restoreModelGraph).
+ * Each of its buffers wraps an "x" tensor of NHWC planes and a "turn_mask" tensor that the workers encode their states into
+ * (see EnvState::encodeNNInput), so a batch is fed to the session without copying it.  The "output" op gives the action
+ * distributions, which are copied into the buffer's outputs (TF allocates the output tensor itself).
+ */
+class SessionEvaluator : public BatchEvaluator {
+
+public:
+
+    SessionEvaluator(Session* session);
+
+    /* Deletes the tensors behind the evaluator's buffers. */
+    ~SessionEvaluator();
+
+    void layout(EnvState* example, vector<int>* input_sizes, int* output_size) override;
+
+    BatchBuffer* newBuffer(int capacity, const vector<int>& input_sizes, int output_size) override;
+
+    void encode(EnvState* state, BatchBuffer* buffer, int row) override;
+
+    void evaluate(BatchBuffer* buffer, int num_rows) override;
+
+private:
+
+    Session* _session;
+    /* The side of the padded board each state is encoded on. */
+    int _padded_dim;
+    /* The x and turn_mask tensors behind each buffer the evaluator has made. */
+    map<BatchBuffer*, pair<Tensor*, Tensor*>> _tensors;
+
+};
+
+
 
 /***** Helper Functions *****/
 
@@ -74,7 +112,7 @@ void createTensorsFromStates(int batch_size, const vector<EnvState*>& states, ve
 
  * Let N, H, W, C be the dimensions of the tensor (as given in SHAPE).
  * This is how the tensor is laid out:
- * tensor[n, h, w, c] = vec[n][((h * H) + w) + ((h * w) * c)].
+ * tensor[n, h, w, c] = vec[n][((h * W) + w) + ((H * W) * c)].
  *  
  * This function fills the given tensor.
  */
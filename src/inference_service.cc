@@ -0,0 +1,248 @@
+#include "inference_service.h"
+
+#include <algorithm> // find
+
+using namespace std;
+
+
+BatchBuffer* BatchEvaluator::newBuffer(int capacity, const vector<int>& input_sizes, int output_size) {
+	return new BatchBuffer(capacity, input_sizes, output_size);
+}
+
+
+
+InferenceRequest::InferenceRequest() {
+	this->buffer = NULL;
+	this->first_row = 0;
+	this->done = false;
+	this->batch = NULL;
+	this->batch_index = 0;
+}
+
+float* InferenceRequest::result(int i) {
+	ASSERT(this->buffer != NULL && this->done, "Cannot read the results of a request that is not done, or was released");
+	ASSERT(0 <= i && i < this->states.size(), "The request has no state " << i);
+	return this->buffer->output(this->first_row + i);
+}
+
+
+
+InferenceService::InferenceService(BatchEvaluator* evaluator, int batch_size, int max_wait_us, int num_workers) {
+	ASSERT(evaluator != NULL, "Cannot run an inference service with a null evaluator");
+	ASSERT(batch_size > 0, "Must have a positive batch size, not " << batch_size);
+	ASSERT(max_wait_us >= 0, "Cannot wait a negative time for a batch to fill");
+	ASSERT(num_workers >= 0, "Cannot have a negative number of workers");
+	this->_evaluator = evaluator;
+	this->_batch_size = batch_size;
+	this->_max_wait = chrono::microseconds(max_wait_us);
+	this->_output_size = 0;
+	this->_open = NULL;
+	this->_num_workers = num_workers;
+	this->_num_waiting = 0;
+	this->_stopping = false;
+	this->_num_batches = 0;
+	this->_num_rows = 0;
+	this->_thread = thread(&InferenceService::serve, this);
+}
+
+InferenceService::~InferenceService() {
+	{
+		lock_guard<mutex> lock(this->_lock);
+		this->_stopping = true;
+	}
+	this->_request_queued.notify_one();
+	this->_thread.join();
+
+	// the service thread ran every batch before it stopped, so the only batches left are waiting on releases
+	for (InferenceBatch* batch : this->_batches) {
+		for (InferenceRequest* request : batch->requests) {
+			if (request != NULL) {
+				request->batch = NULL;
+				request->buffer = NULL;
+			}
+		}
+		delete batch;
+	}
+	for (BatchBuffer* buffer : this->_buffers) {
+		delete buffer;
+	}
+}
+
+void InferenceService::submit(InferenceRequest* request) {
+	ASSERT(request != NULL && request->states.size() > 0, "Cannot submit a request without any states");
+	ASSERT(request->batch == NULL, "Cannot submit a request that has not been released");
+	int num_states = request->states.size();
+	request->done = false;
+	request->submit_time = chrono::steady_clock::now();
+	{
+		lock_guard<mutex> lock(this->_lock);
+		ASSERT(!this->_stopping, "Cannot submit a request to a service that is stopping");
+		if (this->_input_sizes.empty()) {
+			this->_evaluator->layout(request->states[0], &this->_input_sizes, &this->_output_size);
+		}
+
+		// a request is never split, so if it does not fit in the open batch, that batch is closed and runs as it is
+		if (this->_open != NULL && this->_open->num_rows + num_states > this->_batch_size) {
+			this->_full.push_back(this->_open);
+			this->_open = NULL;
+		}
+		if (this->_open == NULL) {
+			this->openBatch(num_states, request->submit_time);
+		}
+
+		// reserve the request's rows
+		InferenceBatch* batch = this->_open;
+		request->batch = batch;
+		request->batch_index = batch->requests.size();
+		request->buffer = batch->buffer;
+		request->first_row = batch->num_rows;
+		batch->requests.push_back(request);
+		batch->num_rows += num_states;
+		batch->num_encoding++;
+		batch->num_unreleased++;
+	}
+
+	// encode without the lock, so the other workers can encode their own requests into the same buffer at the same time
+	for (int i = 0; i < num_states; i++) {
+		this->_evaluator->encode(request->states[i], request->buffer, request->first_row + i);
+	}
+	{
+		lock_guard<mutex> lock(this->_lock);
+		request->batch->num_encoding--;
+	}
+	this->_request_queued.notify_one();
+}
+
+void InferenceService::openBatch(int num_rows, chrono::steady_clock::time_point submit_time) {
+	InferenceBatch* batch = new InferenceBatch();
+	batch->buffer = NULL;
+	for (int i = 0; i < this->_free_buffers.size(); i++) {
+		if (this->_free_buffers[i]->capacity() >= num_rows) {
+			batch->buffer = this->_free_buffers[i];
+			this->_free_buffers.erase(this->_free_buffers.begin() + i);
+			break;
+		}
+	}
+	if (batch->buffer == NULL) {
+		batch->buffer = this->_evaluator->newBuffer(max(this->_batch_size, num_rows), this->_input_sizes, this->_output_size);
+		this->_buffers.push_back(batch->buffer);
+	}
+	batch->num_rows = 0;
+	batch->num_encoding = 0;
+	batch->num_unreleased = 0;
+	batch->deadline = submit_time + this->_max_wait;
+	this->_open = batch;
+	this->_batches.push_back(batch);
+}
+
+void InferenceService::wait(InferenceRequest* request) {
+	unique_lock<mutex> lock(this->_lock);
+	if (request->done) {
+		return;
+	}
+	// the service may have been holding a batch back for this worker's next request
+	this->_num_waiting++;
+	this->_request_queued.notify_one();
+	while (!request->done) {
+		this->_batch_done.wait(lock);
+	}
+	this->_num_waiting--;
+}
+
+void InferenceService::workerFinished() {
+	{
+		lock_guard<mutex> lock(this->_lock);
+		ASSERT(this->_num_workers > 0, "More workers finished than the service was started with");
+		this->_num_workers--;
+	}
+	this->_request_queued.notify_one();
+}
+
+void InferenceService::release(InferenceRequest* request) {
+	lock_guard<mutex> lock(this->_lock);
+	InferenceBatch* batch = request->batch;
+	ASSERT(batch != NULL && request->done, "Can only release a request that is done, and only once");
+	batch->requests[request->batch_index] = NULL;
+	request->batch = NULL;
+	request->buffer = NULL;
+	batch->num_unreleased--;
+	if (batch->num_unreleased == 0) {
+		this->_free_buffers.push_back(batch->buffer);
+		this->_batches.erase(find(this->_batches.begin(), this->_batches.end(), batch));
+		delete batch;
+	}
+}
+
+bool InferenceService::batchReady() const {
+	if (this->_open->num_rows >= this->_batch_size || this->_stopping || chrono::steady_clock::now() >= this->_open->deadline) {
+		return true;
+	}
+	// no more requests can come in while every worker is waiting on one
+	return this->_num_workers > 0 && this->_num_waiting == this->_num_workers;
+}
+
+void InferenceService::evaluate(InferenceRequest* request) {
+	this->submit(request);
+	this->wait(request);
+}
+
+void InferenceService::serve() {
+
+	unique_lock<mutex> lock(this->_lock);
+	while (true) {
+
+		// wait for a full batch, or for the open batch's deadline.  once stopping, flush whatever is left right away
+		while (this->_full.empty() && !(this->_open != NULL && this->batchReady())) {
+			if (this->_open == NULL) {
+				if (this->_stopping) {
+					return;
+				}
+				this->_request_queued.wait(lock);
+			}
+			else {
+				this->_request_queued.wait_until(lock, this->_open->deadline);
+			}
+		}
+		InferenceBatch* batch;
+		if (!this->_full.empty()) {
+			batch = this->_full.front();
+			this->_full.pop_front();
+		}
+		else {
+			batch = this->_open;
+			this->_open = NULL;
+		}
+
+		// no more rows can be reserved in the batch, but its last requests may still be being encoded
+		while (batch->num_encoding > 0) {
+			this->_request_queued.wait(lock);
+		}
+
+		// evaluate without the lock, so workers can keep submitting requests to the next batch
+		lock.unlock();
+		this->_evaluator->evaluate(batch->buffer, batch->num_rows);
+		lock.lock();
+
+		for (InferenceRequest* request : batch->requests) {
+			request->done = true;
+		}
+		this->_num_batches++;
+		this->_num_rows += batch->num_rows;
+		this->_batch_done.notify_all();
+	}
+}
+
+long InferenceService::numBatches() const {
+	lock_guard<mutex> lock(this->_lock);
+	return this->_num_batches;
+}
+
+long InferenceService::numRows() const {
+	lock_guard<mutex> lock(this->_lock);
+	return this->_num_rows;
+}
+
+double InferenceService::fillRatio() const {
+	lock_guard<mutex> lock(this->_lock);
+	return (this->_num_batches > 0) ? (double) this->_num_rows / (this->_num_batches * this->_batch_size) : 0;
+}
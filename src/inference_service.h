@@ -0,0 +1,199 @@
+#ifndef INFERENCE_SERVICE_H
+#define INFERENCE_SERVICE_H
+
+#include "mcts.h"
+#include "batch_buffer.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * Something that runs an NN on a batch of states.  The inference service hands its batches to one of these, so the
+ * service itself does not depend on how (or where) the model is run.
+ *
+ * A batch lives in a BatchBuffer, laid out as the evaluator asks.  Worker threads encode their states straight into its rows,
+ * and the evaluator runs the NN on the buffer in place, and leaves each row's action probabilities in its outputs.
+ */
+class BatchEvaluator {
+
+public:
+
+	virtual ~BatchEvaluator() {}
+
+	/**
+	 * Sets INPUT_SIZES to the number of values in each input field of the NN for a state like EXAMPLE, and OUTPUT_SIZE
+	 * to the number of action probabilities it gives (every state the evaluator is handed has this same layout).
+	 */
+	virtual void layout(EnvState* example, vector<int>* input_sizes, int* output_size) = 0;
+
+	/**
+	 * Returns a new buffer for CAPACITY rows of the given layout, in memory the evaluator can run the NN on without copying it.
+	 * By default, the buffer has memory of its own.  Buffers must not outlive the evaluator.
+	 */
+	virtual BatchBuffer* newBuffer(int capacity, const vector<int>& input_sizes, int output_size);
+
+	/* Encodes STATE into row ROW of BUFFER.  Called by the worker threads, several of them at once (on different rows). */
+	virtual void encode(EnvState* state, BatchBuffer* buffer, int row) = 0;
+
+	/* Runs the NN on the first NUM_ROWS rows of BUFFER, and writes each row's action probabilities to its outputs. */
+	virtual void evaluate(BatchBuffer* buffer, int num_rows) = 0;
+
+};
+
+
+struct InferenceBatch;
+
+/**
+ * States that a worker thread submits to an InferenceService together, and the NN's action probabilities for each of them.
+ * The request must stay alive (and its states unchanged) until the worker has waited on it, and read and released its results
+ * (or until the service is deleted).
+ */
+struct InferenceRequest {
+
+	InferenceRequest();
+
+	/* Returns the action probabilities of STATES[I], once the request is done, which stay put until the request is released. */
+	float* result(int i);
+
+	vector<EnvState*> states;
+
+	/* Set by the service when the request is submitted: the buffer that STATES are encoded into, from row FIRST_ROW on. */
+	BatchBuffer* buffer;
+	int first_row;
+
+	/* Set by the service once the results are in.  Guarded by the service's lock. */
+	bool done;
+	/* When the request was submitted, which starts the clock on the batch it is put in. */
+	chrono::steady_clock::time_point submit_time;
+	/* The batch the request is in, and its index in the batch's requests, until it is released.  Guarded by the service's lock. */
+	InferenceBatch* batch;
+	int batch_index;
+
+};
+
+
+/* A batch of requests that the inference service is gathering, or running, in one of its buffers. */
+struct InferenceBatch {
+
+	BatchBuffer* buffer;
+	/* The batch's requests, in the order they were submitted.  Each is set to NULL once it is released. */
+	vector<InferenceRequest*> requests;
+	int num_rows;
+	/* The number of the requests whose states are still being encoded, and the number that have not been released. */
+	int num_encoding;
+	int num_unreleased;
+	/* When the batch is run even if it is not full: MAX_WAIT_US after its first request was submitted. */
+	chrono::steady_clock::time_point deadline;
+
+};
+
+
+/**
+ * A single thread that runs NN inference for every worker thread of a run, so the model is only loaded once.
+ *
+ * The service gathers whole requests into a batch, in one of a pool of buffers of BATCH_SIZE rows that it reuses for the whole
+ * run.  Submitting a request reserves the next rows of the batch being gathered, and the worker encodes its states straight
+ * into them.  The service thread hands the batch to its evaluator once it holds BATCH_SIZE states, or once its first request
+ * has waited MAX_WAIT_US microseconds, whichever comes first (and once every state in it is encoded).
+ * The evaluator leaves the results in the buffer, and the service wakes the batch's workers, which read them in place,
+ * and then release their rows.  A buffer goes back to the pool once all of its requests are released.
+ * If the service knows how many workers it has, it also runs the batch as soon as every one of them is blocked on a result,
+ * since no more requests can come in until it does.
+ * A request is never split between batches, so one with more than BATCH_SIZE states makes a batch (and a buffer) of its own.
+ */
+class InferenceService {
+
+public:
+
+	/**
+	 * Starts the service thread, which evaluates its batches with EVALUATOR (which must outlive the service).
+	 * NUM_WORKERS is the number of worker threads that will submit requests, each of which must call workerFinished once
+	 * it is done with the service (0 if the number is not known, in which case batches only run when full or on their deadline).
+	 */
+	InferenceService(BatchEvaluator* evaluator, int batch_size, int max_wait_us, int num_workers=0);
+
+	/**
+	 * Evaluates whatever has been submitted, then stops the service thread.  Requests that have not been released are done,
+	 * but their results go with the service's buffers, so the service releases them itself.  They may be submitted again (to another service).
+	 */
+	~InferenceService();
+
+	/* Adds REQUEST (which must have at least one state, and no rows) to the batch being gathered, and encodes its states into its rows. */
+	void submit(InferenceRequest* request);
+
+	/* Blocks until REQUEST is done. */
+	void wait(InferenceRequest* request);
+
+	/* Submits REQUEST and waits on it. */
+	void evaluate(InferenceRequest* request);
+
+	/* Hands REQUEST's rows back to the service, once the worker has read its results. */
+	void release(InferenceRequest* request);
+
+	/* Marks that one of the workers will not submit any more requests. */
+	void workerFinished();
+
+	/* Returns the number of batches evaluated so far. */
+	long numBatches() const;
+
+	/* Returns the number of states evaluated so far. */
+	long numRows() const;
+
+	/* Returns the average number of states per batch, as a fraction of BATCH_SIZE (0 if there were no batches). */
+	double fillRatio() const;
+
+private:
+
+	/* The service thread: waits for each batch to fill (or for its deadline), and evaluates it, until the service stops. */
+	void serve();
+
+	/* Returns true if the open batch should be run without waiting any longer.  Must hold the lock. */
+	bool batchReady() const;
+
+	/* Starts a new open batch, in a free buffer with room for at least NUM_ROWS rows (making one if none is free).  Must hold the lock. */
+	void openBatch(int num_rows, chrono::steady_clock::time_point submit_time);
+
+	BatchEvaluator* _evaluator;
+	int _batch_size;
+	chrono::microseconds _max_wait;
+
+	/* Guards everything below, and the bookkeeping of every request in flight. */
+	mutable mutex _lock;
+	/* Signalled when a request is submitted or encoded, a worker starts waiting or finishes, or the service is stopping. */
+	condition_variable _request_queued;
+	/* Signalled when a batch's requests are done. */
+	condition_variable _batch_done;
+
+	/* The layout of the evaluator's batches (known once the first request comes in). */
+	vector<int> _input_sizes;
+	int _output_size;
+	/* The batch that submitted requests are added to (NULL if none is being gathered), and older batches that were closed
+	 * because a request did not fit, which run first. */
+	InferenceBatch* _open;
+	deque<InferenceBatch*> _full;
+	/* Every batch whose buffer is in use: the open and full batches, and those with requests that have not been released. */
+	vector<InferenceBatch*> _batches;
+	/* Every buffer the service has made, and the ones not in use by a batch. */
+	vector<BatchBuffer*> _buffers;
+	vector<BatchBuffer*> _free_buffers;
+	/* The number of workers that may still submit requests (0 if not known), and the number of them blocked in wait. */
+	int _num_workers;
+	int _num_waiting;
+	bool _stopping;
+	long _num_batches;
+	long _num_rows;
+
+	thread _thread;
+
+};
+
+
+
+#endif
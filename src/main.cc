@@ -3,6 +3,9 @@
 #include "config.h"
 #include "mcts_thread_manager.h"
 #include "inference.h"
+#include "evaluator_socket.h"
+#include "profiler.h"
+#include "rng.h"
 
 #include <iostream>
 #include "stdlib.h"
@@ -15,155 +18,177 @@ using namespace std;
 
 
 // worker thread function to run vanilla MCTS (with no NN apprentice)
-void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, int start, int end, int max_depth, int log_every) {
+void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, TaskScheduler* scheduler, int max_depth, int log_every, uint64_t root_seed) {
 
 	ASSERT(nodes != NULL, "Cannot pass a null nodes array to threadFunc");
-	ASSERT(start >= 0 && end <= nodes->size() && start <= end, "Start and end index must be in range, and end index cannot be smaller than start index");
+	ASSERT(scheduler != NULL && scheduler->numTasks() <= nodes->size(), "The scheduler must hand out indices into the nodes array");
 	ASSERT(log_every > 0, "log_every must be positive");
 
-	for (int node_num = start; node_num < end; node_num++) {
-		if ((node_num - start) % log_every == 0) {
+	// the most arena memory any one of this thread's trees needed, which can be used to size DEFAULT_ARENA_CHUNK_SIZE
+	size_t max_arena_high_water = 0;
+
+	int num_nodes_processed = 0;
+	for (int node_num = scheduler->nextTask(thread_num); node_num != -1; node_num = scheduler->nextTask(thread_num)) {
+		if (num_nodes_processed % log_every == 0) {
 			logTime("Thread " + to_string(thread_num) + ": Processing state #" + to_string(node_num));
 		}
+
+		// which thread searches a root depends on the timing of the steals, so each root gets a generator of its own,
+		// and runs with the same seed still match
+		setThreadRng(Rng(root_seed + node_num));
 		MCTS_Node* node = nodes->at(node_num);
 		runAllSimulations(node, max_depth);
+		num_nodes_processed++;
+
+		if (node->getArena()->highWater() > max_arena_high_water) {
+			max_arena_high_water = node->getArena()->highWater();
+		}
 
 	}
 
-}
+	logTime("Thread " + to_string(thread_num) + ": processed " + to_string(num_nodes_processed) + " states, and the largest tree used "
+		+ to_string(max_arena_high_water / 1024) + " KB of node arena");
 
-void nMCTSThreadFunc(int thread_num, vector<MCTS_Node*>* nodes, int start, int end, MCTS_Thread_Manager* thread_manager, const ArgMap& arg_map) {
+}
 
+/* The slots of one of an N-MCTS worker's pipeline groups, and the NN request for the nodes their trees are waiting on. */
+struct SlotGroup {
+	int first_slot;
+	int end_slot;
+	InferenceRequest request;
+	/* The node that each state of the request belongs to. */
+	vector<MCTS_Node*> row_nodes;
+	/* Whether the request is with the inference service. */
+	bool submitted;
+	/* Whether all of the group's slots have run out of roots. */
+	bool finished;
+};
+
+// worker thread function to run N-MCTS, keeping a batch of minibatch_size trees (each with up to max_in_flight NN evaluations)
+// in flight, in pipeline_groups groups, and refilling the slots of finished ones.  its NN requests go to the run's single inference service
+void nMCTSThreadFunc(int thread_num, vector<MCTS_Node*>* nodes, TaskScheduler* scheduler, InferenceService* inference_service,
+	MCTS_Thread_Manager* thread_manager, const ArgMap& arg_map, uint64_t root_seed) {
 
 	// unpack args
 	int batch_size = arg_map.getInt("minibatch_size", DEFAULT_MINIBATCH_SIZE);
+	int max_in_flight = arg_map.getInt("max_in_flight", DEFAULT_MAX_IN_FLIGHT);
+	int num_groups = arg_map.getInt("pipeline_groups", DEFAULT_PIPELINE_GROUPS);
 	int max_depth = arg_map.getInt("max_depth", DEFAULT_MAX_DEPTH);
 	int log_every = arg_map.getInt("log_every", DEFAULT_LOG_EVERY);
-	string model_path = arg_map.getString("model_path");
 	
-	ASSERT(nodes != NULL, "Cannot pass a null nodes array to threadFunc");
-	ASSERT(start >= 0 && end <= nodes->size() && start <= end, "Start and end index must be in range, and end index cannot be smaller than start index");
+	ASSERT(nodes != NULL, "Cannot pass a null nodes array to nMCTSThreadFunc");
+	ASSERT(scheduler != NULL && scheduler->numTasks() <= nodes->size(), "The scheduler must hand out indices into the nodes array");
+	ASSERT(inference_service != NULL, "Cannot pass a null inference service to nMCTSThreadFunc");
 	ASSERT(log_every > 0, "log_every must be positive");
-	ASSERT(max_depth > 0 && batch_size > 0, "max depth and batch_size must be positive");
+	ASSERT(max_depth > 0 && batch_size > 0 && max_in_flight > 0, "max depth, batch_size and max_in_flight must be positive");
+	ASSERT(0 < num_groups && num_groups <= batch_size, "Must have between 1 and batch_size pipeline groups, not " << num_groups);
 
 	// register thread and log
 	thread_manager->registerThreadName(this_thread::get_id(), "Worker " + to_string(thread_num));
-	thread_manager->log("N-MCTS Thread " + to_string(thread_num) + " working on nodes " + to_string(start) + " to " + to_string(end)
-	+ " with max depth " + to_string(max_depth) + " and batch_size " + to_string(batch_size));
-
-
-	// determine number of batches, and size of action distributiosn
-	int num_states = end - start;
-	int num_batches = num_states / batch_size;
-	if (num_batches == 0) {
-		num_batches = 1;
+	thread_manager->log("N-MCTS Thread " + to_string(thread_num) + " working with max depth " + to_string(max_depth)
+		+ ", batch_size " + to_string(batch_size) + " in " + to_string(num_groups) + " pipeline groups, and up to " + to_string(max_in_flight)
+		+ " NN evaluations in flight per tree");
+
+
+	// each slot of the batch holds the index of the tree it is searching (-1 once no roots are left), the simulations of that
+	// tree that are waiting on the NN, and the random stream of the tree.  the trees of a slot take turns with the others,
+	// so each keeps a stream of its own, seeded from its index, and runs with the same seed match
+	vector<int> slot_nodes(batch_size, -1);
+	vector<vector<PendingEvaluation>> in_flight(batch_size);
+	vector<Rng> slot_rngs(batch_size);
+	for (int slot = 0; slot < batch_size; slot++) {
+		slot_nodes[slot] = scheduler->nextTask(thread_num);
+		if (slot_nodes[slot] != -1) {
+			slot_rngs[slot] = Rng(root_seed + slot_nodes[slot]);
+		}
 	}
-	int num_actions = nodes->at(start)->getState()->numActions();
-
-	// start TF session
-	const string meta_graph_path = model_path + ".meta";
-    const string model_checkpoint_path = model_path;
-
-	// initialize the TF session
-    Session* session = NewSession(SessionOptions());
-    ASSERT(session != NULL, "Session is NULL");
-    // Read in the protobuf graph we exported, and add it to the session
-    MetaGraphDef graph_def;
-    Status status = restoreModelGraph(session, &graph_def, meta_graph_path, model_checkpoint_path);
-    ASSERT(status.ok(), "Error restoring model graph");
-    thread_manager->log("Successfully loaded metagraph and all nodes from model checkpoint at " + model_checkpoint_path);
-
-
-    int num_states_finished = 0;
-
-	for (int batch_num = 0; batch_num < num_batches; batch_num++) {
-		int num_unfinished_trees = batch_size;
-
-		// initialize vector of ActionDistributions
-		vector<ActionDistribution*> action_dists(batch_size, NULL);
-		// initialize bitvector of whether trees are complete
-		vector<bool> finished_tree(batch_size, false);
-		// initialize vector of EnvStates, which will be used for inference
-		vector<EnvState*> states(batch_size);
-		for (int batch_index = 0; batch_index < batch_size; batch_index++) {
-			int state_num = start + (batch_num * batch_size) + batch_index;
-			states[batch_index] = nodes->at(state_num)->getState();
 
+	// the slots are split into pipeline groups, each with its own request for the nodes its trees are waiting on
+	vector<SlotGroup> groups(num_groups);
+	for (int group = 0; group < num_groups; group++) {
+		groups[group].first_slot = group * batch_size / num_groups;
+		groups[group].end_slot = (group + 1) * batch_size / num_groups;
+		groups[group].submitted = false;
+		groups[group].finished = false;
+	}
+	int max_rows = (batch_size + num_groups - 1) / num_groups * max_in_flight;
+
+	int num_states_finished = 0;
+	int num_groups_finished = 0;
+	long num_requests = 0;
+	long num_rows = 0;
+
+	// take the groups in turn: while one group's request is with the inference service, the worker advances the trees of the
+	// next one, so with two or more groups the search and the inference overlap
+	for (int group_num = 0; num_groups_finished < num_groups; group_num = (group_num + 1) % num_groups) {
+		SlotGroup& group = groups[group_num];
+		if (group.finished) {
+			continue;
 		}
 
+		// hand each node of the last request its prior, read straight out of the service's buffer, so its simulation resumes below
+		if (group.submitted) {
+			inference_service->wait(&group.request);
+			for (int row = 0; row < group.row_nodes.size(); row++) {
+				MCTS_Node* node = group.row_nodes[row];
+				float* probs = group.request.result(row);
+				node->setNNActionDistribution(new ActionDistribution(new vector<double>(probs, probs + node->getState()->numActions())));
+				node->markReceivedNNResults();
+			}
+			inference_service->release(&group.request);
+			group.submitted = false;
+		}
 
-
-		while (num_unfinished_trees > 0) {
-			
-		
-			// run each state until it needs inference
-			for (int batch_index = 0; batch_index < batch_size; batch_index++) {
-				int state_num = start + (batch_num * batch_size) + batch_index;
-				if (finished_tree[batch_index]) {
-					continue;
-				}
-
-
-				
-				// run MCTS on this tree until either all simulations are done, or it requires an NN prediction
-				MCTS_Node* node = nodes->at(state_num);
-				node = runMCTS(node, max_depth, action_dists[batch_index]);
-				nodes->at(state_num) = node;
-
-				// if the node is now finished
-				if (node->simulationsFinished()) {
-					finished_tree[batch_index] = true;
-					num_unfinished_trees -= 1;
-					num_states_finished += 1;
-					if (num_states_finished % log_every == 0) {
-						thread_manager->log("Finished " + to_string(num_states_finished) + " out of " + to_string(num_states) + " states");
+		// run each tree until its simulations are waiting on inference.  when a tree finishes, its slot takes the next root
+		// right away, so the request only ever carries trees that are waiting on the NN
+		group.request.states.clear();
+		group.row_nodes.clear();
+		for (int slot = group.first_slot; slot < group.end_slot; slot++) {
+			while (slot_nodes[slot] != -1) {
+				MCTS_Node* root = nodes->at(slot_nodes[slot]);
+
+				// run MCTS on this tree until either all simulations are done, or MAX_IN_FLIGHT of them require an NN prediction
+				setThreadRng(slot_rngs[slot]);
+				int num_waiting = runMCTSInFlight(root, max_depth, max_in_flight, &in_flight[slot]);
+				slot_rngs[slot] = threadRng();
+
+				// if the tree still needs predictions, add the states its simulations are waiting on to the request
+				if (num_waiting > 0) {
+					for (PendingEvaluation& pending : in_flight[slot]) {
+						group.row_nodes.push_back(pending.node);
+						group.request.states.push_back(pending.node->getState());
 					}
+					break;
 				}
 
-				// if node still active, submit state vector the NN batch
-					//thread_manager->log("Submitting state " + to_string(state_num) + " to state batch");
-				states[batch_index] = node->getState();
-			
-			}
-
-			// create a TF feed dict from this batch, and run inference
-			vector<pair<string, Tensor>> feed_dict;
-			vector<string> output_ops;
-			createTensorsFromStates(batch_size, states, &feed_dict, &output_ops);
-			vector<Tensor> output_tensors;
-			
-			Status status = predictBatch(session, feed_dict, output_ops, &output_tensors);
-
-
-
-			// unpack the actions for each of the states, and create ActionDistribution objects
-			for (int batch_index = 0; batch_index < batch_size; batch_index++) {
-				
-				// if tree is already finished, don't bother
-				if (finished_tree[batch_index]) {
-					continue;
+				num_states_finished += 1;
+				if (num_states_finished % log_every == 0) {
+					thread_manager->log("Finished " + to_string(num_states_finished) + " states");
 				}
-
-				int state_num = start + (batch_num * batch_size) + batch_index;
-				
-				// unpack the action distribution predicted by NN inference
-				Tensor action_dist_tensor = output_tensors[0];
-				auto action_dist = action_dist_tensor.matrix<float>();
-				vector<double>* ad_vec = new vector<double>(num_actions);
-				for (int action_num = 0; action_num < num_actions; action_num++) {
-					ad_vec->at(action_num) = action_dist(batch_index, action_num);
+				slot_nodes[slot] = scheduler->nextTask(thread_num);
+				if (slot_nodes[slot] != -1) {
+					slot_rngs[slot] = Rng(root_seed + slot_nodes[slot]);
 				}
-
-				// create an ActionDistribution object, and place it in the action_dists vector.
-				ActionDistribution* new_ad = new ActionDistribution(ad_vec);
-				ASSERT(ad_vec != NULL, "Just created an action distribution with a null advec");
-				action_dists[batch_index] = new_ad;
-				//thread_manager->log("Created action distribution for state " + to_string(state_num));
-
 			}
+		}
 
+		if (group.row_nodes.empty()) {
+			group.finished = true;
+			num_groups_finished++;
+			continue;
 		}
+		num_requests++;
+		num_rows += group.row_nodes.size();
+
+		// run inference along with the other workers' requests, and pick the results up on this group's next turn
+		inference_service->submit(&group.request);
+		group.submitted = true;
 	}
+	inference_service->workerFinished();
+
+	double fill_ratio = (num_requests > 0) ? (double) num_rows / (num_requests * max_rows) : 0;
+	thread_manager->log("N-MCTS Thread " + to_string(thread_num) + " finished " + to_string(num_states_finished) + " states in "
+		+ to_string(num_requests) + " NN requests, with an average fill ratio of " + to_string(fill_ratio));
 
 }
 
@@ -184,6 +209,11 @@ int main(int argc, char *argv[]) {
 	// parse all command line arguments into an ArgMap instance
 	ArgMap* arg_map = new ArgMap();
 	parseArgs(argc, argv, arg_map);
+	profiler_on = arg_map->getBool("profile", DEFAULT_PROFILE);
+	int seed = arg_map->getInt("seed", DEFAULT_SEED);
+	if (seed != -1) {
+		seedRng(seed);
+	}
 
 	// unpack a few key arguments
 	string game = arg_map->getString("game", DEFAULT_GAME);
@@ -207,14 +237,13 @@ int main(int argc, char *argv[]) {
 
 		logTime("Beginning MCTS on " + to_string(num_states) + " states");
 
-		// divide the nodes array into 4 segments, and pass each segment to an individual thread
+		// deal the states out to the worker threads, which steal from each other once they run out
 		int num_threads = arg_map->getInt("num_threads", DEFAULT_NUM_THREADS);
-		int states_per_thread = num_states / num_threads;
+		TaskScheduler scheduler(num_threads, nodes->size());
+		uint64_t root_seed = threadRng().next();
 		thread worker_threads[num_threads];
 		for (int thread_num = 0; thread_num < num_threads; thread_num++) {
-			int start = thread_num * states_per_thread;
-			int end = (thread_num + 1) * states_per_thread;
-			worker_threads[thread_num] = thread(threadFunc, thread_num, nodes, start, end, max_depth, log_every);
+			worker_threads[thread_num] = thread(threadFunc, thread_num, nodes, &scheduler, max_depth, log_every, root_seed);
 		}
 
 		// wait for all worker threads to join
@@ -222,7 +251,7 @@ int main(int argc, char *argv[]) {
 			worker_threads[thread_num].join();
 		}
 
-		logTime("Done with MCTS on " + to_string(num_states) + " states");
+		logTime("Done with MCTS on " + to_string(nodes->size()) + " states (" + to_string(scheduler.numStolen()) + " of them stolen between threads)");
 
 	}
 
@@ -231,20 +260,50 @@ int main(int argc, char *argv[]) {
 		int max_depth = arg_map->getInt("max_depth", DEFAULT_MAX_DEPTH);
 		int log_every = arg_map->getInt("log_every", DEFAULT_LOG_EVERY);
 		int minibatch_size = arg_map->getInt("minibatch_size", DEFAULT_MINIBATCH_SIZE);
+		int max_in_flight = arg_map->getInt("max_in_flight", DEFAULT_MAX_IN_FLIGHT);
+		int pipeline_groups = arg_map->getInt("pipeline_groups", DEFAULT_PIPELINE_GROUPS);
+		int num_threads = arg_map->getInt("num_threads", DEFAULT_NUM_THREADS);
+		string model_path = arg_map->getString("model_path");
 
 		logTime("Beginning N-MCTS on " + to_string(num_states) + " states");
 
 		MCTS_Thread_Manager thread_manager(nodes);
 
-		// divide the nodes array into 4 segments, and pass each segment to an individual thread
-		int num_threads = arg_map->getInt("num_threads", DEFAULT_NUM_THREADS);
-		int states_per_thread = num_states / num_threads;
+		// the inference service runs every worker's batches either on an evaluator process that already has the model loaded,
+		// or on a single session that loads the model once, here
+		Session* session = NULL;
+		EvaluatorClient* evaluator_client = NULL;
+		BatchEvaluator* evaluator;
+		if (arg_map->contains("evaluator_socket")) {
+			string evaluator_socket = arg_map->getString("evaluator_socket");
+			evaluator_client = new EvaluatorClient(evaluator_socket);
+			evaluator = new SocketEvaluator(evaluator_client);
+			logTime("Connected to the evaluator at " + evaluator_socket);
+		}
+		else {
+			const string meta_graph_path = model_path + ".meta";
+			const string model_checkpoint_path = model_path;
+			session = NewSession(SessionOptions());
+			ASSERT(session != NULL, "Session is NULL");
+			MetaGraphDef graph_def;
+			Status status = restoreModelGraph(session, &graph_def, meta_graph_path, model_checkpoint_path);
+			ASSERT(status.ok(), "Error restoring model graph");
+			logTime("Successfully loaded metagraph and all nodes from model checkpoint at " + model_checkpoint_path);
+			evaluator = new SessionEvaluator(session);
+		}
+
+		// by default, a batch waits for a full request from every worker (or for its deadline).  a worker only has one of its
+		// pipeline groups waiting at a time, so its requests are that much smaller
+		int inference_batch_size = arg_map->getInt("inference_batch_size", num_threads * minibatch_size * max_in_flight / pipeline_groups);
+		int inference_wait_us = arg_map->getInt("inference_wait_us", DEFAULT_INFERENCE_WAIT_US);
+		InferenceService* inference_service = new InferenceService(evaluator, inference_batch_size, inference_wait_us, num_threads);
+
+		// deal the states out to the worker threads, which steal from each other once they run out
+		TaskScheduler scheduler(num_threads, nodes->size());
+		uint64_t root_seed = threadRng().next();
 		thread worker_threads[num_threads];
 		for (int thread_num = 0; thread_num < num_threads; thread_num++) {
-			int start = thread_num * states_per_thread;
-			int end = (thread_num + 1) * states_per_thread;
-			worker_threads[thread_num] = thread(nMCTSThreadFunc, thread_num, nodes, start, end, &thread_manager, *arg_map);
-			//worker_threads[thread_num] = thread(nMCTSThreadFunc, thread_num, nodes, start, end, &thread_manager, *arg_map);
+			worker_threads[thread_num] = thread(nMCTSThreadFunc, thread_num, nodes, &scheduler, inference_service, &thread_manager, *arg_map, root_seed);
 		}
 
 		// wait for all worker threads to join
@@ -252,13 +311,24 @@ int main(int argc, char *argv[]) {
 			worker_threads[thread_num].join();
 		}
 
-		logTime("Done with MCTS on " + to_string(num_states) + " states");
+		logTime("Done with MCTS on " + to_string(nodes->size()) + " states, in " + to_string(inference_service->numBatches()) + " NN batches"
+			+ " with an average fill ratio of " + to_string(inference_service->fillRatio()));
+		delete inference_service;
+		delete evaluator;
+		if (session != NULL) {
+			session->Close();
+			delete session;
+		}
+		if (evaluator_client != NULL) {
+			delete evaluator_client;
+		}
 
 		MCTS_Node* node = nodes->at(0);
 		cout << "node: " << endl;
 		node->getState()->printBoard();
-		vector<int>* ac = node->getActionCounts();
-		printVector(*ac, "action counts");
+		vector<int> ac(node->getNumActions(), 0);
+		node->getActionCounts(&ac);
+		printVector(ac, "action counts");
 	}
 
 	// write final states and action distributions to file
@@ -269,6 +339,9 @@ int main(int argc, char *argv[]) {
 		int num_nodes_written = writeBatchToFile(nodes, output_data_path, states_per_file);
 	}
 
+	string profiler_log_file = arg_map->getString("profiler_log_file", DEFAULT_PROFILER_LOG_PATH);
+	profiler.log(profiler_log_file);
+
 	cout << endl << endl;
 
 	return 0;
@@ -3,6 +3,8 @@
 
 //#include "mcts_thread_manager.h"
 #include "mcts.h"
+#include "rng.h"
+#include "task_scheduler.h"
 #include <vector>
 
 
@@ -10,12 +12,14 @@
 
 /**
  * Worker thread function (for thread THREAD_NUM) that runs vanilla MCTS (without an NN apprentice).
- * This function runs MCTS from the root node states given in the NODES vector.
- * It is responsible for nodes starting at index START, up till but not including index END.
+ * This function runs MCTS from the root node states given in the NODES vector, taking the index of each next one from SCHEDULER
+ * (as its worker THREAD_NUM) until none are left, so threads whose states finish quickly take over the work of the others.
  * For every one of these nodes, runs simulations to a max_depth of MAX_DEPTH, and logs after the completion of
  * every batch of LOG_EVERY nodes.
+ * The search of node K draws its random numbers from a generator seeded with ROOT_SEED + K, whichever thread runs it.
  */
-void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, int start, int end, int max_depth=DEFAULT_MAX_DEPTH, int log_every=DEFAULT_LOG_EVERY);
+void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, TaskScheduler* scheduler, int max_depth=DEFAULT_MAX_DEPTH, int log_every=DEFAULT_LOG_EVERY,
+	uint64_t root_seed=threadRng().next());
 
 
 /** 
@@ -32,14 +36,19 @@ void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, int start, int end, i
  	--num_simulations <number of simulations to run for each state> [optional - defaults to 1000] \
  	--max_depth <max depth of MCTS trees> [optional - defaults to 4] \
  	\
- 	--minibatch_size <size of minibatches used for multi-threading apprentice querying> [optional - defaults to 256] \
+ 	--minibatch_size <number of trees each worker thread keeps in flight> [optional - defaults to 256] \
+ 	--max_in_flight <number of NN evaluations each tree may wait on at once; a worker's NN requests hold up to minibatch_size times this many states> [optional - defaults to 1] \
+ 	--pipeline_groups <number of groups each worker splits its trees into; it searches the next group while one group's request is evaluated> [optional - defaults to 1] \
+ 	--inference_batch_size <number of states the inference thread gathers from all the workers' requests before it runs a batch> [optional - defaults to num_threads * minibatch_size * max_in_flight / pipeline_groups] \
+ 	--inference_wait_us <longest time in microseconds a request waits for its batch to fill> [optional - defaults to 2000] \
  	--num_threads <number of worker threads in multi-threaded MCTS> [optional - defaults to 4] \
  	--log_every <logs every time this many nodes finish> [optional - defaults to 512] \
+ 	--seed <seed of the random number generators; runs with the same seed and threads are identical> [optional - if omitted, every run differs] \
     \
     --use_nn <True if you want to query a NN apprentice> [optional - if omitted or given a value other than "True", no NN is used] \
     --model_spec <the path at which the model spec file is stored> [required if use_nn is True] \
     --model_path <the path at which the saved model is stored> [required if use_nn is True] \
-    --nn_script <the name of the script used to query the NN [required if use_nn is True] \
+    --evaluator_socket <the Unix socket of an evaluator process (src/nn_server.py) to run the NN on, instead of loading the model here> [optional] \
     \
     --output_data_path <the path to which the states and resulting action distributions will be saved [optional - if not provided, not saved] \
     --states_per_file <the number of states to which to save to each file> [optional - defaults to 2^20] \
@@ -91,7 +100,6 @@ void threadFunc(int thread_num, vector<MCTS_Node*>* nodes, int start, int end, i
     --use_nn True \
     --model_spec models/hex/5/best_model/spec.json \
     --model_path models/hex/5/best_model/ \
-    --nn_script src/nn_query.py \
     \
     --output_data_path data/mcts/hex/5/best_model/ \
     --states_per_file 1024 \
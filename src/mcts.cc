@@ -1,4 +1,6 @@
 #include "mcts.h"
+#include "profiler.h"
+#include "rng.h"
 
 #include <iostream>
 
@@ -8,6 +10,8 @@
 #include <condition_variable>
 #include <mutex>
 #include <map>
+#include <memory> // unique_ptr
+#include <new> // placement new
 #include <sys/types.h>
 #include <signal.h>
 #include <fstream>
@@ -54,6 +58,10 @@ double StateVector::at(int k) const {
 	return this->_sv[k];
 }
 
+int StateVector::size() const {
+	return this->_sv.size();
+}
+
 StateVector::~StateVector() {
 }
 
@@ -112,31 +120,97 @@ double ActionDistribution::at(int k) const {
 
 
 MCTS_Node::MCTS_Node(EnvState* state, bool is_root, int num_simulations, bool sample_actions, bool requires_nn, bool use_rave,
-	double c_b, double c_rave, double w_a) {
+	double c_b, double c_rave, double w_a, bool fill_rollouts, bool use_transpositions, double virtual_loss, int rollouts_per_leaf) {
+
+	ASSERT(is_root, "Only root nodes can be constructed directly, the rest of the tree is made by makeChild");
 	
 	this->is_root = is_root;
-	this->state = state;
 
-	this->total_num_simulations = num_simulations; // irrelevant if not a root
-	this->num_simulations_finished = 0; // irrelevant if not a root
+	this->total_num_simulations = num_simulations;
+	this->num_simulations_finished = 0;
+	this->num_simulations_started = 0;
 	
-	this->depth = 0; // if this is a child node created by makeChild, depth will be overriden by a call to setDepth from makeChild
-	this->parent = NULL; // if this is a child node created by makeChild, parent will be set by a call to setParent from makeChild
+	this->depth = 0;
+	this->parent = NULL;
+	this->root = this;
+	this->child_index = -1;
 
-	// store a pointer to the root of the tree 
-	// if this is a child node created by makeChild, root will be set by a call to setRoot from makeChild
-	if (is_root) {
-		this->root = this;
-	} else {
-		this->root = NULL;
-	}
+	// the rest of the tree is allocated from this arena
+	this->arena = new NodeArena();
+	// the transposition table is made along with the first child (see makeChild)
+	this->transpositions = NULL;
+	this->path = new vector<PathStep>();
+	this->expansion_lock = new mutex();
+
+	// the flags and hyperparameters are shared by the whole tree
+	ASSERT(c_rave > 0, "Must have a positive c_rave");
+	ASSERT(rollouts_per_leaf > 0, "Must play a positive number of rollouts per leaf, not " << rollouts_per_leaf);
+	this->config = new SearchConfig();
+	// whether to sample actions proportional to scores (if false, uses argmax)
+	this->config->sample_actions = sample_actions;
+	// whether this tree uses an NN apprentice during MCTS
+	this->config->requires_nn = requires_nn;
+	// whether to use RAVE when calculating action scores
+	this->config->use_rave = use_rave;
+	// whether to roll out by filling the board in one go (only if the state supports it)
+	this->config->fill_rollouts = fill_rollouts && state->supportsFillRollout();
+	// whether to share nodes between move orders that reach the same position
+	this->config->use_transpositions = use_transpositions;
+	// how many rollouts to play from each leaf
+	this->config->rollouts_per_leaf = rollouts_per_leaf;
+	// hyperparameters
+	this->config->c_b = c_b;
+	this->config->c_rave = c_rave;
+	this->config->w_a = w_a;
+	this->config->virtual_loss = virtual_loss;
+	// only set while several threads search the tree (see runAllSimulations)
+	this->config->concurrent = false;
+
+	this->initialize(state);
+}
+
+MCTS_Node::MCTS_Node(EnvState* state, MCTS_Node* parent, int k) {
 
-	// if this node is the K-th child of its parent, then its child_index is K.
-	// if this is a child node created by makeChild, its child_index will be set by a call to setChildIndex from makeChild
+	this->is_root = false;
+
+	this->total_num_simulations = 0; // irrelevant, since not a root
+	this->num_simulations_finished = 0; // irrelevant, since not a root
+	this->num_simulations_started = 0; // irrelevant, since not a root
+
+	// children share their parent's tree, arena, transposition table and config
+	this->arena = NULL;
+	this->transpositions = NULL;
+	this->path = NULL;
+	this->expansion_lock = NULL;
+	this->config = parent->config;
+	this->setParent(parent);
+	this->setRoot(parent->root);
+	this->setDepth(parent->depth + 1);
 	this->child_index = -1;
 
+	this->initialize(state);
+	this->setChildIndex(k);
+}
+
+void MCTS_Node::initialize(EnvState* state) {
+
+	this->state = state;
 	this->num_actions = state->numActions();
-	this->children = new vector<MCTS_Node*>(this->num_actions, NULL); // initialize all children to NULL
+
+	// there is one edge per legal action, in increasing order of action
+	thread_local vector<int> legal_actions;
+	legal_actions.resize(this->num_actions);
+	this->num_edges = state->legalActions(legal_actions.data());
+	this->edge_actions = this->allocateArray<uint16_t>(this->num_edges);
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		this->edge_actions[edge] = legal_actions[edge];
+	}
+	this->children = this->allocateArray<MCTS_Node*>(this->num_edges); // initialize all children to NULL
+	this->symmetry = 0;
+	this->edge_symmetries = NULL;
+	if (this->config->use_transpositions) {
+		this->edge_symmetries = this->allocateArray<uint8_t>(this->num_edges);
+	}
 
 	// these flags are used to determine whether a node has submitted its state vector to an NN apprentice yet
 	// (and whether it has yet processed the results)
@@ -144,80 +218,59 @@ MCTS_Node::MCTS_Node(EnvState* state, bool is_root, int num_simulations, bool sa
 	this->received_nn_results = false;
 
 	// these stats are used to calculate the best action to take during MCTS.
+	// the RAVE stats are only kept if the tree uses RAVE
 	this->num_node_visits = 0; this->num_node_visits_rave = 0;
-	this->num_edge_traversals = new vector<int>(this->num_actions, 0);
-	this->num_edge_traversals_rave = new vector<int>(this->num_actions, 0);
-	this->edge_rewards = new vector<double>(this->num_actions, 0.0);
-	this->edge_rewards_rave = new vector<double>(this->num_actions, 0.0);
+	this->num_edge_traversals = this->allocateArray<uint32_t>(this->num_edges);
+	this->edge_rewards = this->allocateArray<float>(this->num_edges);
+	this->num_edge_traversals_rave = NULL;
+	this->edge_rewards_rave = NULL;
+	if (this->config->use_rave) {
+		this->num_edge_traversals_rave = this->allocateArray<uint32_t>(this->num_edges);
+		this->edge_rewards_rave = this->allocateArray<float>(this->num_edges);
+	}
 
 	// this is the state vector that is sent to the neural net.
-	vector<double>* sv = new vector<double>();
-	state->makeStateVector(sv);
-	this->state_vector = new StateVector(*sv);
-	// initialize the AD to NULL
-	this->nn_result = NULL;
-
-	// whether to sample actions proportional to scores (if false, uses argmax)
-	this->sample_actions = sample_actions;
-	// whether this node uses an NN apprentice during MCTS
-	this->requires_nn = requires_nn;
-	// whether to use RAVE when calculating action scores
-	this->use_rave = use_rave;
-
-	// hyperparameters
-	this->c_b = c_b;
-	ASSERT(c_rave > 0, "Must have a positive c_rave");
-	this->c_rave = c_rave;
-	this->w_a = w_a;
+	// it is only built (by getStateVector) once the node is actually queued for inference
+	this->state_vector = NULL;
+	// the NN prior is set once the NN results come back
+	this->nn_prior = NULL;
+}
 
+template <typename T>
+T* MCTS_Node::allocateArray(int n) {
+	if (this->is_root) {
+		return new T[n]();
+	}
+	return this->root->arena->allocateArray<T>(n);
 }
 
 
 MCTS_Node::~MCTS_Node() {
-	
-	
-	// do not delete this->state (or this->state_vector) because we don't want the state vector to get deleted
-	// likewise, do not delete this->nn_result
-	// deleting these will cause the ThreadManager's queues to be messed up.
 
-	// delete state
-	delete this->state;
+	// everything below the root lives in the root's arena, and is never deleted node by node
+	ASSERT(this->is_root, "Only root nodes can be deleted");
 
-	// try deleting state vector and action distribution
+	delete this->state;
 	if (this->state_vector != NULL) {
 		delete this->state_vector;
-	} 
-	if (this->nn_result != NULL) {
-		delete this->nn_result;
 	}
 
+	delete[] this->edge_actions;
+	delete[] this->edge_symmetries;
+	delete[] this->children;
+	delete[] this->num_edge_traversals;
+	delete[] this->edge_rewards;
+	delete[] this->num_edge_traversals_rave;
+	delete[] this->edge_rewards_rave;
+	delete[] this->nn_prior;
 
-	
-	// delete all N and R vectors
-	if (this->num_edge_traversals != NULL) {
-		delete this->num_edge_traversals; // n(s,a)
-	}
-	
-	if (this->edge_rewards != NULL) {
-		delete this->edge_rewards; // r(s, a)
-	}
-
-	if (this->num_edge_traversals_rave != NULL) {
-		delete this->num_edge_traversals_rave; // n(s,a)-rave
-	}
-
-	if (this->edge_rewards_rave != NULL) {
-		delete this->edge_rewards_rave; // r(s,a)-rave
-	}
+	delete this->config;
+	delete this->path;
+	delete this->expansion_lock;
 
-	// delete each child recursively
-	for (MCTS_Node* child : *(this->children)) {
-		if (child != NULL) {
-			delete child;
-		}
-	}
-	// delete the children vector itself
-	delete this->children;
+	// frees the rest of the tree
+	delete this->transpositions;
+	delete this->arena;
 
 }
 
@@ -225,14 +278,35 @@ MCTS_Node::~MCTS_Node() {
 void MCTS_Node::deleteTree() {
 	ASSERT(this->isRoot(), "Cannot delete a tree starting from a non-root node");
 
-	for (MCTS_Node* child : *(this->children)) {
-		if (child != NULL) {
-			delete child;
-		}
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		this->children[edge] = NULL;
 	}
+	this->path->clear();
+	delete this->transpositions;
+	this->transpositions = NULL;
+	this->arena->release();
 	
 }
 
+MCTS_Node* MCTS_Node::copyRoot() const {
+	ASSERT(this->isRoot(), "Only root nodes can be copied");
+	return new MCTS_Node(this->state->clone(), true /* is_root */, this->total_num_simulations, this->config->sample_actions,
+		this->config->requires_nn, this->config->use_rave, this->config->c_b, this->config->c_rave, this->config->w_a,
+		this->config->fill_rollouts, this->config->use_transpositions, this->config->virtual_loss, this->config->rollouts_per_leaf);
+}
+
+NodeArena* MCTS_Node::getArena() const {
+	return this->root->arena;
+}
+
+TranspositionTable* MCTS_Node::getTranspositions() const {
+	return this->root->transpositions;
+}
+
+vector<PathStep>* MCTS_Node::getPath() const {
+	return this->root->path;
+}
+
 
 
 
@@ -256,18 +330,43 @@ bool MCTS_Node::simulationsFinished() const {
 }
 
 void MCTS_Node::markSimulationFinished() {
-	this->num_simulations_finished += 1;
+	ASSERT(this->isRoot(), "Only root nodes can mark simulations finished");
+	this->num_simulations_finished.fetch_add(1);
+}
+
+int MCTS_Node::numSimulations() const {
+	return this->total_num_simulations;
+}
+
+bool MCTS_Node::claimSimulation() {
+	ASSERT(this->isRoot(), "Only root nodes can claim simulations");
+	return this->num_simulations_started.fetch_add(1) < this->total_num_simulations;
+}
+
+void MCTS_Node::setConcurrent(bool concurrent) {
+	ASSERT(this->isRoot(), "Only root nodes can be searched by several threads");
+	this->config->concurrent = concurrent;
+	// the simulations that have already finished don't need to be claimed again
+	this->num_simulations_started = this->num_simulations_finished.load();
 }
 
 
 
 
 bool MCTS_Node::usesRave() const {
-	return this->use_rave;
+	return this->config->use_rave;
+}
+
+bool MCTS_Node::usesFillRollouts() const {
+	return this->config->fill_rollouts;
 }
 
 bool MCTS_Node::requiresNN() const {
-	return this->requires_nn;
+	return this->config->requires_nn;
+}
+
+const SearchConfig* MCTS_Node::getConfig() const {
+	return this->config;
 }
 
 bool MCTS_Node::neverSubmittedToNN() const{
@@ -294,6 +393,33 @@ int MCTS_Node::getNumActions() const {
 	return this->num_actions;
 }
 
+int MCTS_Node::getNumEdges() const {
+	return this->num_edges;
+}
+
+int MCTS_Node::getEdgeAction(int edge) const {
+	ASSERT(0 <= edge && edge < this->num_edges, "Cannot get the action of edge " << edge);
+	return this->edge_actions[edge];
+}
+
+int MCTS_Node::edgeIndex(int action) const {
+	// edges are sorted by action, so binary search for it
+	int low = 0;
+	int high = this->num_edges - 1;
+	while (low <= high) {
+		int mid = (low + high) >> 1;
+		int mid_action = this->edge_actions[mid];
+		if (mid_action == action) {
+			return mid;
+		} else if (mid_action < action) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return -1;
+}
+
 int MCTS_Node::getDepth() const {
 	return this->depth;
 }
@@ -316,13 +442,18 @@ MCTS_Node* MCTS_Node::setParent(MCTS_Node* parent) {
 
 MCTS_Node* MCTS_Node::getChild(int k) const {
 	ASSERT(0 <= k && k < this->num_actions, "Cannot get the " << k << "th child");
-	return this->children->at(k); // may be null
+	int edge = this->edgeIndex(k);
+	if (edge == -1) {
+		return NULL; // illegal actions have no child
+	}
+	return this->children[edge]; // may be null
 }
 
 MCTS_Node* MCTS_Node::setChild(MCTS_Node* child, int k) {
 	ASSERT(child != NULL, "Cannot set the " << k << "th child to be null");
-	ASSERT(0 <= k && k < this->num_actions, "Cannot set the " << k << "th child");
-	this->children->at(k) = child;
+	int edge = this->edgeIndex(k);
+	ASSERT(edge != -1, "Cannot set the " << k << "th child, since action " << k << " is not legal");
+	this->children[edge] = child;
 	return this;
 }
 
@@ -342,6 +473,16 @@ MCTS_Node* MCTS_Node::getRoot() const {
 	return this->root; // just this if this is a root
 }
 
+int MCTS_Node::getSymmetry() const {
+	return this->symmetry;
+}
+
+int MCTS_Node::getEdgeSymmetry(int k) const {
+	int edge = this->edgeIndex(k);
+	ASSERT(edge != -1, "Cannot get the symmetry of action " << k << ", since it is not legal");
+	return (this->edge_symmetries == NULL) ? 0 : this->edge_symmetries[edge];
+}
+
 MCTS_Node* MCTS_Node::setRoot(MCTS_Node* root) {
 	ASSERT(root != NULL, "Cannot set a null root");
 	this->root = root;
@@ -355,22 +496,60 @@ MCTS_Node* MCTS_Node::makeChild(int k) {
 		return this;
 	}
 	// if this node has already made its k-th child, don't make a new one.
-	if (this->getChild(k) != NULL) {
-		return this->getChild(k);
+	int edge = this->edgeIndex(k);
+	ASSERT(edge != -1, "Cannot make the " << k << "th child, since action " << k << " is not legal");
+	MCTS_Node* existing_child = __atomic_load_n(&this->children[edge], __ATOMIC_ACQUIRE);
+	if (existing_child != NULL) {
+		return existing_child;
 	}
 
-	// create the child node
-	MCTS_Node* child_node =
-		new MCTS_Node(this->state->nextState(k), false /* is_root */, this->total_num_simulations, this->sample_actions, this->requires_nn, this->use_rave);
-	
-	// set its parent, child index, depth and root
-	child_node->setParent(this);
-	child_node->setChildIndex(k);
-	child_node->setDepth(this->depth + 1);
-	child_node->setRoot(this->root);
+	// if several threads search the tree, they may all reach the missing child at once, so only one of them makes it
+	unique_lock<mutex> lock(*this->root->expansion_lock, defer_lock);
+	if (this->config->concurrent) {
+		lock.lock();
+		if (this->children[edge] != NULL) {
+			return this->children[edge];
+		}
+	}
+
+	// if another move order already reached the resulting position (or a symmetric one), share its node
+	TranspositionTable* transpositions = NULL;
+	uint64_t child_hash = 0;
+	int child_symmetry = 0;
+	if (this->config->use_transpositions) {
+		if (this->root->transpositions == NULL) {
+			this->root->transpositions = new TranspositionTable(this->root->total_num_simulations * DEFAULT_TRANSPOSITIONS_PER_SIMULATION);
+		}
+		transpositions = this->root->transpositions;
+		child_hash = this->state->canonicalHashAfterAction(k, &child_symmetry);
+		this->edge_symmetries[edge] = child_symmetry;
+		MCTS_Node* transposed_node = transpositions->lookup(child_hash);
+		if (transposed_node != NULL) {
+			ASSERT(transposed_node->depth == this->depth + 1, "A transposition at depth " << transposed_node->depth << " was reached at depth " << this->depth + 1);
+			// the node's stats are from Player 1's point of view, so they can't be shared with a colour-swapped position
+			ASSERT(this->state->symmetrySwapsPlayers(child_symmetry) == this->state->symmetrySwapsPlayers(transposed_node->symmetry),
+				"A transposition cannot swap the players");
+			__atomic_store_n(&this->children[edge], transposed_node, __ATOMIC_RELEASE);
+			return transposed_node;
+		}
+	}
+
+	// copy the state into the arena, and take the action on the copy
+	NodeArena* arena = this->getArena();
+	EnvState* child_state = this->state->cloneInto(arena->allocate(this->state->sizeInBytes()));
+	child_state->applyAction(k);
+
+	// create the child node in the arena (this sets its parent, child index, depth and root)
+	MCTS_Node* child_node = new (arena->allocate(sizeof(MCTS_Node), alignof(MCTS_Node))) MCTS_Node(child_state, this, k);
+	child_node->symmetry = child_symmetry;
 
-	// set the new node as the K-th child of this node
-	this->setChild(child_node, k);
+	// set the new node as the K-th child of this node (publishing it, fully made, to any other threads)
+	__atomic_store_n(&this->children[edge], child_node, __ATOMIC_RELEASE);
+
+	// if the table is full, the node is simply not shared
+	if (transpositions != NULL) {
+		transpositions->insert(child_hash, child_node);
+	}
 
 	return child_node;
 }
@@ -383,29 +562,54 @@ EnvState* MCTS_Node::getState() const {
 	return this->state;
 }
 
-StateVector* MCTS_Node::getStateVector() const {
+StateVector* MCTS_Node::getStateVector() {
+	if (this->state_vector == NULL) {
+		vector<double> sv;
+		this->state->makeStateVector(&sv);
+		this->state_vector = new StateVector(sv);
+	}
 	return this->state_vector;
 }
 
 void MCTS_Node::setNNActionDistribution(ActionDistribution* ad) {
 	ASSERT(ad != NULL, "Cannot set a null action distribution");
-	this->nn_result = ad;
+
+	// copy the prior of each legal action into the tree, so the node holds no heap memory of its own
+	if (this->nn_prior == NULL) {
+		this->nn_prior = this->allocateArray<float>(this->num_edges);
+	}
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		this->nn_prior[edge] = ad->at(this->edge_actions[edge]);
+	}
+	delete ad;
+
+	// the NN has answered, so this node's state vector will not be read again
+	if (this->state_vector != NULL) {
+		delete this->state_vector;
+		this->state_vector = NULL;
+	}
 }
 
-vector<int>* MCTS_Node::getActionCounts() const {
-	return this->num_edge_traversals;
+void MCTS_Node::getActionCounts(vector<int>* action_counts) const {
+	ASSERT(action_counts != NULL, "Cannot populate a null action_counts vector");
+	ASSERT(action_counts->size() >= this->num_actions, "There must be at least " << this->num_actions << " elements in action_counts");
+	fill(action_counts->begin(), action_counts->begin() + this->num_actions, 0);
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		action_counts->at(this->edge_actions[edge]) = this->num_edge_traversals[edge];
+	}
 }
 	
 void MCTS_Node::getActionDistribution(vector<double>* action_dist) const {
 	ASSERT(action_dist != NULL, "Cannot populate a null action_dist vector");
 	ASSERT(action_dist->size() >= this->num_actions, "There must be at least " << this->num_actions << " elements in action_dist");
-	
+
 	if (this->num_node_visits == 0) {
 		return;
 	}
 
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		action_dist->at(action_num) = ((double) this->num_edge_traversals->at(action_num)) / ((double) this->num_node_visits);
+	fill(action_dist->begin(), action_dist->begin() + this->num_actions, 0.0);
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		action_dist->at(this->edge_actions[edge]) = ((double) this->num_edge_traversals[edge]) / ((double) this->num_node_visits);
 	}
 }
 
@@ -420,14 +624,14 @@ int MCTS_Node::N() const {
 }
 
 
-int MCTS_Node::N(int a) const {
-	ASSERT(0 <= a && a < this->num_actions, "Cannot get num_edge_traversals for the " << a << "th child");
-	return this->num_edge_traversals->at(a);
+int MCTS_Node::N(int e) const {
+	ASSERT(0 <= e && e < this->num_edges, "Cannot get num_edge_traversals for edge " << e);
+	return this->num_edge_traversals[e];
 }
 
-double MCTS_Node::R(int a) const {
-	ASSERT(0 <= a && a < this->num_actions, "Cannot get edge_rewards for the " << a << "th child");
-	return this->edge_rewards->at(a);
+double MCTS_Node::R(int e) const {
+	ASSERT(0 <= e && e < this->num_edges, "Cannot get edge_rewards for edge " << e);
+	return this->edge_rewards[e];
 }
 
 int MCTS_Node::NRave() const {
@@ -435,30 +639,30 @@ int MCTS_Node::NRave() const {
 }
 
 
-int MCTS_Node::NRave(int a) const {
-	ASSERT(0 <= a && a < this->num_actions, "Cannot get num_edge_traversals for the " << a << "th child");
-	return this->num_edge_traversals_rave->at(a);
+int MCTS_Node::NRave(int e) const {
+	ASSERT(0 <= e && e < this->num_edges, "Cannot get num_edge_traversals_rave for edge " << e);
+	return this->num_edge_traversals_rave[e];
 }
 
-double MCTS_Node::RRave(int a) const {
-	ASSERT(0 <= a && a < this->num_actions, "Cannot get edge_rewards for the " << a << "th child");
-	return this->edge_rewards_rave->at(a);
+double MCTS_Node::RRave(int e) const {
+	ASSERT(0 <= e && e < this->num_edges, "Cannot get edge_rewards_rave for edge " << e);
+	return this->edge_rewards_rave[e];
 }
 
 
-vector<int>* MCTS_Node::edgeTraversals() const {
+const uint32_t* MCTS_Node::edgeTraversals() const {
 	return this->num_edge_traversals;
 }
 
-vector<double>* MCTS_Node::edgeRewards() const {
+const float* MCTS_Node::edgeRewards() const {
 	return this->edge_rewards;
 }
 
-vector<int>* MCTS_Node::edgeTraversalsRave() const {
+const uint32_t* MCTS_Node::edgeTraversalsRave() const {
 	return this->num_edge_traversals_rave;
 }
 
-vector<double>* MCTS_Node::edgeRewardsRave() const {
+const float* MCTS_Node::edgeRewardsRave() const {
 	return this->edge_rewards_rave;
 }
 
@@ -467,36 +671,48 @@ vector<double>* MCTS_Node::edgeRewardsRave() const {
 void MCTS_Node::getMeanRewards(vector<double>* mean_reward_vec) const {
 	ASSERT(mean_reward_vec != NULL, "Cannot have a null mean reward vec");
 	ASSERT(mean_reward_vec->size() >= this->num_actions, "mean_reward_vec must have size at least " << this->num_actions);
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
 
-		double total_reward = this->edge_rewards->at(action_num);
-		int num_taken = this->num_edge_traversals->at(action_num);
+	// illegal actions (which have no edge) have a mean reward of 0
+	fill(mean_reward_vec->begin(), mean_reward_vec->begin() + this->num_actions, 0.0);
+	for (int edge = 0; edge < this->num_edges; edge++) {
 
-		if (num_taken == 0) {
-			mean_reward_vec->at(action_num) = 0.0;
-		} else {
-			mean_reward_vec->at(action_num) = total_reward / num_taken;
+		double total_reward = this->edge_rewards[edge];
+		int num_taken = this->num_edge_traversals[edge];
+
+		if (num_taken != 0) {
+			mean_reward_vec->at(this->edge_actions[edge]) = total_reward / num_taken;
 		}
 		
 	}
 }
 
+void MCTS_Node::addActionStats(vector<int>* action_counts, vector<double>* total_rewards) const {
+	ASSERT(action_counts != NULL && total_rewards != NULL, "Cannot add action stats to null vectors");
+	ASSERT(action_counts->size() >= this->num_actions && total_rewards->size() >= this->num_actions,
+		"action_counts and total_rewards must have size at least " << this->num_actions);
+
+	for (int edge = 0; edge < this->num_edges; edge++) {
+		action_counts->at(this->edge_actions[edge]) += this->num_edge_traversals[edge];
+		total_rewards->at(this->edge_actions[edge]) += this->edge_rewards[edge];
+	}
+}
+
 
 
 void MCTS_Node::printMeanReward() const {
 	int num_actions = this->getState()->numActions();
 	vector<double> mean_rewards(num_actions, 0.0);
-	for (int action_num = 0; action_num < num_actions; action_num++) {
+	for (int edge = 0; edge < this->num_edges; edge++) {
 		int n; double r;
-		if (this->use_rave) {
-			n = this->num_edge_traversals_rave->at(action_num);
-			r = this->edge_rewards_rave->at(action_num);
+		if (this->config->use_rave) {
+			n = this->num_edge_traversals_rave[edge];
+			r = this->edge_rewards_rave[edge];
 		} else {
-			n = this->num_edge_traversals->at(action_num);
-			r = this->edge_rewards->at(action_num);
+			n = this->num_edge_traversals[edge];
+			r = this->edge_rewards[edge];
 		}
 		if (r != 0) {
-			mean_rewards[action_num] = r / (double (n));
+			mean_rewards[this->edge_actions[edge]] = r / (double (n));
 		}
 	}
 
@@ -513,15 +729,15 @@ void MCTS_Node::printExplorationTerm() const {
 
 	}
 	double numer = N();
-	for (int action_num = 0; action_num < num_actions; action_num++) {
+	for (int edge = 0; edge < this->num_edges; edge++) {
 		int n;
-		if (this->use_rave) {
-			n = this->num_edge_traversals_rave->at(action_num);
+		if (this->config->use_rave) {
+			n = this->num_edge_traversals_rave[edge];
 		} else {
-			n = this->num_edge_traversals->at(action_num);
+			n = this->num_edge_traversals[edge];
 		}
 		if (n != 0) {
-			exp_terms[action_num] = this->c_b * sqrt(log(numer / ((double) n)));
+			exp_terms[this->edge_actions[edge]] = this->config->c_b * sqrt(log(numer / ((double) n)));
 		}
 	}
 
@@ -532,181 +748,150 @@ void MCTS_Node::printExplorationTerm() const {
 
 
 
-void MCTS_Node::computeUCT(vector<double>* action_scores) const {
+/* Adds VALUE to a visit count, atomically if CONCURRENT (several threads search the tree). */
+static inline void addToStat(uint32_t* stat, uint32_t value, bool concurrent) {
+	if (concurrent) {
+		__atomic_fetch_add(stat, value, __ATOMIC_RELAXED);
+	} else {
+		*stat += value;
+	}
+}
 
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores must be at least " << this->num_actions);
-	
-	// if never been to this node, return all 0s (uniform)
-	if (N() == 0) {
+/* Adds VALUE to a reward, atomically if CONCURRENT (several threads search the tree). */
+static inline void addToStat(float* stat, double value, bool concurrent) {
+	if (!concurrent) {
+		*stat += value;
 		return;
 	}
+	// there is no atomic float add, so retry the add until no other thread has changed the reward in between
+	float old_value;
+	float new_value;
+	__atomic_load(stat, &old_value, __ATOMIC_RELAXED);
+	do {
+		new_value = old_value + value;
+	} while (!__atomic_compare_exchange(stat, &old_value, &new_value, true /* weak */, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
 
-	double avg_reward_term;
-	double avg_log_visits_term;
-	double score;
 
-	// for each action, compute the score
-	for (int a = 0; a < this->num_actions; a++) {
+EdgeStats MCTS_Node::edgeStats() const {
+	EdgeStats stats;
+	stats.num_edges = this->num_edges;
+	stats.node_visits = this->num_node_visits;
+	stats.visits = this->num_edge_traversals;
+	stats.rewards = this->edge_rewards;
+	return stats;
+}
 
-		if (N(a) == 0) {
-			avg_reward_term = 0;
-		} else {
-			int turn = this->state->turn();
-			avg_reward_term = (R(a) * turn) / N(a);
-			// make sure we "minimize reward" (maximize negative reward if it is player 2 (player -1)'s turn)
-		} 
+EdgeStats MCTS_Node::edgeStatsRave() const {
+	EdgeStats stats;
+	stats.num_edges = this->num_edges;
+	stats.node_visits = this->num_node_visits_rave;
+	stats.visits = this->num_edge_traversals_rave;
+	stats.rewards = this->edge_rewards_rave;
+	return stats;
+}
 
-		avg_log_visits_term = log(N()) / (N(a) + 1);
-		score = avg_reward_term + (this->c_b * sqrt(avg_log_visits_term));
-		action_scores->at(a) = score;
 
-	}
+void MCTS_Node::computeUCT(float* edge_scores) const {
+
+	ASSERT(edge_scores != NULL, "Cannot pass a null edge_scores array to computeUCT");
+
+	// if never been to this node, the scores are all 0s (uniform)
+	// the turn makes sure we "minimize reward" (maximize negative reward if it is player 2 (player -1)'s turn)
+	scoreUCT(this->edgeStats(), this->state->turn(), this->config->c_b, edge_scores);
 
 }
 
-void MCTS_Node::computeUCT_NN(vector<double>* action_scores) const {
+void MCTS_Node::computeUCT_NN(float* edge_scores) const {
 
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores must be at least " << this->num_actions);
+	ASSERT(edge_scores != NULL, "Cannot pass a null edge_scores array to computeUCT_NN");
 	ASSERT(this->received_nn_results, "Must have received NN results before computing UCT-NN");
 
-	// if never been to this node, return all 0s (uniform)
+	// compute UCT scores (all 0s if never been to this node)
+	this->computeUCT(edge_scores);
 	if (N() == 0) {
 		return;
 	}
 
-	// compute UCT scores
-	vector<double>* uct_scores = new vector<double>(this->num_actions, 0.0);
-	this->computeUCT(uct_scores);
-
-	// compute the NN term and add it to the UCT term
-	double nn_term_numerator, nn_term_denominator, nn_term;
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		nn_term_numerator = this->nn_result->at(action_num);
-		nn_term_denominator = ((double) this->N(action_num) + 1);
-		ASSERT(nn_term_denominator > 0, "nn_term denominator must be positive");
-		nn_term = this->w_a * (nn_term_numerator / nn_term_denominator);
-		action_scores->at(action_num) = uct_scores->at(action_num) + nn_term;
-	}
+	// add the NN term to the UCT term
+	addPriorScores(this->num_edges, this->config->w_a, this->nn_prior, this->num_edge_traversals, edge_scores);
 }
 
-void MCTS_Node::computeUCT_Rave(vector<double>* action_scores) const {
-
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores must be at least " << this->num_actions);
-	
-	// if never been to this node, return all 0s (uniform)
-	if (NRave() == 0) {
-		return;
-	}
-
-	double avg_reward_term;
-	double avg_log_visits_term;
-	double score;
-
-	// for each action, compute the score
-	for (int a = 0; a < this->num_actions; a++) {
+void MCTS_Node::computeUCT_Rave(float* edge_scores) const {
 
-		if (NRave(a) == 0) {
-			avg_reward_term = 0;
-		} else {
-			int turn = this->state->turn();
-			avg_reward_term = (RRave(a) * turn)/NRave(a); // make sure we "minimize reward" (maximize negative reward if it is player 2 (player -1)'s turn)
-		} 
-
-		avg_log_visits_term = log(NRave()) / (NRave(a) + 1);
-		score = avg_reward_term + (this->c_b * sqrt(avg_log_visits_term));
-		action_scores->at(a) = score;
+	ASSERT(edge_scores != NULL, "Cannot pass a null edge_scores array to computeUCT_Rave");
+	ASSERT(this->config->use_rave, "Cannot compute UCT-RAVE scores for a tree that does not use RAVE");
 
-	}
+	// if never been to this node, the scores are all 0s (uniform)
+	scoreUCT(this->edgeStatsRave(), this->state->turn(), this->config->c_b, edge_scores);
 
 }
 
-void MCTS_Node::computeUCT_U_Rave(vector<double>* action_scores) const {
+void MCTS_Node::computeUCT_U_Rave(float* edge_scores, float* rave_scores) const {
 
+	ASSERT(edge_scores != NULL && rave_scores != NULL, "Cannot pass a null scores array to computeUCT_U_Rave");
 
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores must be at least " << this->num_actions);
-
-	// if never been to this node, return all 0s (uniform)
+	// compute UCT scores (all 0s if never been to this node)
+	this->computeUCT(edge_scores);
 	if (N() == 0) {
 		return;
 	}
 
-	// compute UCT and UCT_Rave scores
-	vector<double>* uct_scores = new vector<double>(this->num_actions, 0.0);
-	vector<double>* uct_rave_scores = new vector<double>(this->num_actions, 0.0);
-	this->computeUCT(uct_scores);
-	this->computeUCT_Rave(uct_scores);
+	// compute UCT_Rave scores
+	this->computeUCT_Rave(rave_scores);
 
 	// compute beta, which controls the weight given to the RAVE estimate
-	double beta_numerator = (double) this->c_rave;
-	double beta_denominator = ((double) 3*this->N() + this->c_rave);
+	double beta_numerator = (double) this->config->c_rave;
+	double beta_denominator = ((double) 3*this->N() + this->config->c_rave);
 	ASSERT(beta_denominator > 0, "Beta denominator must be positive");
 	double beta = sqrt(beta_numerator / beta_denominator);
 
 	// compute the weighted average of UCT and UCT_Rave.
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		action_scores->at(action_num) = (beta * uct_rave_scores->at(action_num)) + ((1 - beta) * uct_scores->at(action_num));
-	}
-
-	// delete vectors to free up space
-	delete uct_scores;
-	delete uct_rave_scores;
+	blendScores(this->num_edges, beta, rave_scores, edge_scores);
 
 }
 
-void MCTS_Node::computeUCT_NN_Rave(vector<double>* action_scores) const {
+void MCTS_Node::computeUCT_NN_Rave(float* edge_scores, float* rave_scores) const {
 
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores must be at least " << this->num_actions);
+	ASSERT(edge_scores != NULL && rave_scores != NULL, "Cannot pass a null scores array to computeUCT_NN_Rave");
 	ASSERT(this->received_nn_results, "Must have received NN results before computing UCT-NN");
 
-	// if never been to this node, return all 0s (uniform)
+	// compute UCT_U_Rave scores (all 0s if never been to this node)
+	this->computeUCT_U_Rave(edge_scores, rave_scores);
 	if (N() == 0) {
 		return;
 	}
 
-	// compute UCT scores
-	vector<double>* uct_scores = new vector<double>(this->num_actions, 0.0);
-	this->computeUCT_U_Rave(uct_scores);
-
-	// compute the NN term and add it to the UCT term
-	double nn_term_numerator, nn_term_denominator, nn_term;
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		nn_term_numerator = this->nn_result->at(action_num);
-		nn_term_denominator = ((double) this->N(action_num) + 1);
-		ASSERT(nn_term_denominator > 0, "nn_term denominator must be positive");
-		nn_term = this->w_a * (nn_term_numerator / nn_term_denominator);
-		action_scores->at(action_num) = uct_scores->at(action_num) + nn_term;
-	}
+	// add the NN term to the UCT term
+	addPriorScores(this->num_edges, this->config->w_a, this->nn_prior, this->num_edge_traversals, edge_scores);
 
 }
 
 
-void MCTS_Node::computeActionScores(vector<double>* action_scores) const {
+void MCTS_Node::computeActionScores(float* edge_scores, float* rave_scores) const {
 
-	ASSERT(action_scores != NULL, "Cannot pass a null action_scores vector to computeActionScores");
-	ASSERT(action_scores->size() >= this->num_actions, "The size of action_scores (" << action_scores->size() << ") must be at least " << this->num_actions);
+	ASSERT(edge_scores != NULL && rave_scores != NULL, "Cannot pass a null scores array to computeActionScores");
+
+	bool requires_nn = this->config->requires_nn;
+	bool use_rave = this->config->use_rave;
 
 	// vanilla UCT
-	if (!this->requires_nn && !this->use_rave) {
-		this->computeUCT(action_scores);
+	if (!requires_nn && !use_rave) {
+		this->computeUCT(edge_scores);
 	}
 
 	// UCT-NN
-	else if (this->requires_nn && !this->use_rave) {
-		this->computeUCT_NN(action_scores);
+	else if (requires_nn && !use_rave) {
+		this->computeUCT_NN(edge_scores);
 	}
 
 	// UCT-U-RAVE
-	else if (!this->requires_nn && this->use_rave) {
-		this->computeUCT_U_Rave(action_scores);
+	else if (!requires_nn && use_rave) {
+		this->computeUCT_U_Rave(edge_scores, rave_scores);
 	}
 
-	else if (this->requires_nn && this->use_rave) {
-		this->computeUCT_NN_Rave(action_scores);
+	else if (requires_nn && use_rave) {
+		this->computeUCT_NN_Rave(edge_scores, rave_scores);
 	}
 
 	else {
@@ -718,112 +903,145 @@ void MCTS_Node::computeActionScores(vector<double>* action_scores) const {
 
 
 
+/**
+ * Per-thread scratch buffers for scoring edges, so that selection does not allocate.
+ * They grow to the largest number of edges seen on this thread, and are reused by every selection after that.
+ */
+struct ScoreScratch {
+	vector<float> edge_scores;
+	vector<float> rave_scores;
+	vector<float> weights;
+};
 
-
-
-
-int MCTS_Node::sampleLegalAction(const vector<double>& action_scores) {
-
-	ASSERT(action_scores.size() >= this->num_actions, "Action dist must contain a score for each of the " << this->num_actions << " actions in sampleLegalAction");
-
-	// compute mask
-	vector<bool> mask(this->num_actions, false);
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		mask[action_num] = this->state->isLegalAction(action_num);
+static ScoreScratch& scoreScratch(int num_edges) {
+	thread_local ScoreScratch scratch;
+	if (scratch.edge_scores.size() < num_edges) {
+		scratch.edge_scores.resize(num_edges);
+		scratch.rave_scores.resize(num_edges);
+		scratch.weights.resize(num_edges);
 	}
+	return scratch;
+}
 
-	// compute the softmax of each score
-	vector<double>* softmaxes = new vector<double>(this->num_actions, 0.0);
-	computeSoftmaxWithMask(action_scores, mask, softmaxes);
-
-	// return an action, sampled proportional to the softmax of its score
-	int sampled_action = sampleProportionalToWeights(*softmaxes);
-	delete softmaxes;
-	return sampled_action;
+int MCTS_Node::sampleEdge(const float* edge_scores, float* weights) {
 
+	// return an edge, sampled proportional to the softmax of its score
+	return sampleSoftmaxScore(this->num_edges, edge_scores, threadRng().uniformDouble(), weights);
     
 }
 
 
-int MCTS_Node::bestLegalAction(const vector<double>& action_scores) {
-
-	ASSERT(action_scores.size() >= this->num_actions, "Action dist must contain a score for each of the " << this->num_actions << " actions in bestLegalAction");
+int MCTS_Node::bestEdge(const float* edge_scores) {
 
-	// compute mask
-	vector<bool> mask(this->num_actions, false);
-	for (int action_num = 0; action_num < this->num_actions; action_num++) {
-		mask[action_num] = this->state->isLegalAction(action_num);
-	}
-
-	int best_action = argmaxWithMask(action_scores, mask);
-	return best_action;
+	return argmaxScore(this->num_edges, edge_scores);
 
 }
 
 
 
-MCTS_Node* MCTS_Node::chooseBestAction() {
-	profiler.start("chooseBestAction");
+MCTS_Node* MCTS_Node::chooseBestAction(vector<PathStep>* path) {
+	PROFILE_SCOPE(CHOOSE_BEST_ACTION);
 
 	// there are no actions to take in terminal states
 	if (this->isTerminal()) {
-		profiler.stop("chooseBestAction");
 		return this;
 	}
-	// compute scores for each action (UCT, UCT-NN, UCT-RAVE, UCT-NN-RAVE, etc)
-	vector<double>* action_scores = new vector<double>(this->num_actions, 0.0);
-	this->computeActionScores(action_scores);
-
-	// either sample an action with softmax probabilities, or take the argmax of the action scores
-	int chosen_action;
-	if (this->sample_actions) {
-		chosen_action = sampleLegalAction(*action_scores);
+	// compute scores for each edge (UCT, UCT-NN, UCT-RAVE, UCT-NN-RAVE, etc)
+	ScoreScratch& scratch = scoreScratch(this->num_edges);
+	this->computeActionScores(scratch.edge_scores.data(), scratch.rave_scores.data());
+
+	// either sample an edge with softmax probabilities, or take the argmax of the edge scores
+	int chosen_edge;
+	if (this->config->sample_actions) {
+		chosen_edge = sampleEdge(scratch.edge_scores.data(), scratch.weights.data());
 	} else {
-		chosen_action = bestLegalAction(*action_scores);
+		chosen_edge = bestEdge(scratch.edge_scores.data());
 	}
 	
-	// create (or grab if already created) the child node obtained by taking the chosen_action
+	// if other threads are searching the tree, count this visit now, as a loss for the player to move,
+	// so that they are steered away from this edge until the result comes back
+	if (this->config->concurrent) {
+		addToStat(&this->num_node_visits, 1, true);
+		addToStat(&this->num_edge_traversals[chosen_edge], 1, true);
+		addToStat(&this->edge_rewards[chosen_edge], -this->state->turn() * this->config->virtual_loss, true);
+	}
+
+	// record the step, so the stats are propagated back along the path this simulation took
+	if (path == NULL) {
+		path = this->getPath();
+	}
+	if (this->isRoot()) {
+		path->clear();
+	}
+	int chosen_action = this->edge_actions[chosen_edge];
+	path->push_back({this, chosen_action});
+
+	// create (or grab if already created) the child node obtained by taking the chosen action
 	MCTS_Node* child_node = this->makeChild(chosen_action);
-	profiler.stop("chooseBestAction");
 	return child_node;
 }
 
 
 
-inline void MCTS_Node::updateStats(int chosen_action, double reward, bool update_rave_stats) {
-	if (update_rave_stats) {
-		profiler.start("updateStats from rave");
-	} else {
-		profiler.start("updateStats");
-	}
+inline void MCTS_Node::updateStats(int chosen_action, double reward, bool update_rave_stats, int num_visits) {
 	ASSERT(0 <= chosen_action && chosen_action < this->num_actions, "Cannot update stats for action " << chosen_action);
+	int edge = this->edgeIndex(chosen_action);
 	
+	bool concurrent = this->config->concurrent;
 	if (!update_rave_stats) {
-		this->num_node_visits += 1;
-		this->num_edge_traversals->at(chosen_action) += 1;
-		this->edge_rewards->at(chosen_action) += reward;
-	} else {
-		this->num_node_visits_rave += 1;
-		this->num_edge_traversals_rave->at(chosen_action) += 1;
-		this->edge_rewards_rave->at(chosen_action) += reward;
+		// RAVE updates are profiled as a whole, by updateStatsRave
+		PROFILE_SCOPE(UPDATE_STATS);
+		ASSERT(edge != -1, "Cannot update stats for action " << chosen_action << ", since it is not legal");
+		addToStat(&this->num_node_visits, num_visits, concurrent);
+		addToStat(&this->num_edge_traversals[edge], num_visits, concurrent);
+		addToStat(&this->edge_rewards[edge], reward, concurrent);
+	} else if (edge != -1) {
+		// all-moves-as-first only credits actions that are also legal from this node
+		addToStat(&this->num_node_visits_rave, num_visits, concurrent);
+		addToStat(&this->num_edge_traversals_rave[edge], num_visits, concurrent);
+		addToStat(&this->edge_rewards_rave[edge], reward, concurrent);
 	}
-	if (update_rave_stats) {
-		profiler.stop("updateStats from rave");
-	} else {
-		profiler.stop("updateStats");
+
+}
+
+inline void MCTS_Node::updateStatsAfterVirtualLoss(int chosen_action, double reward, int num_visits) {
+	PROFILE_SCOPE(UPDATE_STATS);
+	int edge = this->edgeIndex(chosen_action);
+	ASSERT(edge != -1, "Cannot update stats for action " << chosen_action << ", since it is not legal");
+	// chooseBestAction counted one visit, and a loss for the player to move
+	if (num_visits > 1) {
+		addToStat(&this->num_node_visits, num_visits - 1, true);
+		addToStat(&this->num_edge_traversals[edge], num_visits - 1, true);
 	}
+	addToStat(&this->edge_rewards[edge], reward + (this->state->turn() * this->config->virtual_loss), true);
+}
 
+void MCTS_Node::revertVirtualLoss(int chosen_action) {
+	ASSERT(this->config->concurrent, "Only concurrent trees count virtual losses");
+	int edge = this->edgeIndex(chosen_action);
+	ASSERT(edge != -1, "Cannot revert the virtual loss of action " << chosen_action << ", since it is not legal");
+	// the counts are unsigned, so adding the largest one takes one away (mod 2^32)
+	addToStat(&this->num_node_visits, UINT32_MAX, true);
+	addToStat(&this->num_edge_traversals[edge], UINT32_MAX, true);
+	addToStat(&this->edge_rewards[edge], this->state->turn() * this->config->virtual_loss, true);
 }
 
 
-void MCTS_Node::updateStatsRave(const vector<int>& chosen_actions, double reward) {
-	profiler.start("updateStatsRave");
+void MCTS_Node::updateStatsRave(const vector<int>& chosen_actions, double reward, int num_visits) {
+	PROFILE_SCOPE(UPDATE_STATS_RAVE);
 	ASSERT(chosen_actions.size() < this->num_actions, "The chosen_actions vector should not have more than " << this->num_actions << " elements");
 	for (int chosen_action : chosen_actions) {
 
-		this->updateStats(chosen_action, reward, true /* update_rave_stats */);
+		this->updateStats(chosen_action, reward, true /* update_rave_stats */, num_visits);
+	}
+}
+
+void MCTS_Node::updateStatsRave(const vector<int>& actions, const vector<uint32_t>& counts, const vector<double>& rewards) {
+	PROFILE_SCOPE(UPDATE_STATS_RAVE);
+	ASSERT(counts.size() == actions.size() && rewards.size() == actions.size(), "Each RAVE action must have a count and a reward");
+	for (int i = 0; i < actions.size(); i++) {
+		this->updateStats(actions[i], rewards[i], true /* update_rave_stats */, counts[i]);
 	}
-	profiler.stop("updateStatsRave");
 }
 
 
@@ -837,9 +1055,120 @@ void MCTS_Node::updateStatsRave(const vector<int>& chosen_actions, double reward
 
 
 
-MCTS_Node* propagateStats(MCTS_Node* node) {
+/**
+ * Maps each of the ACTIONS (on a board in STATE's frame, whose canonical position FROM_SYMMETRY maps it to) into the frame of
+ * a board whose canonical position TO_SYMMETRY maps it to.  Does nothing if the two symmetries are the same.
+ */
+static void mapActions(const EnvState* state, int from_symmetry, int to_symmetry, vector<int>* actions) {
+	if (from_symmetry == to_symmetry) {
+		return;
+	}
+	// every symmetry is its own inverse, so map to the canonical frame, then back out of it
+	for (int i = 0; i < actions->size(); i++) {
+		(*actions)[i] = state->symmetricAction(state->symmetricAction((*actions)[i], from_symmetry), to_symmetry);
+	}
+}
+
+/**
+ * Updates the stats of NODE, then walks back up the simulation's PATH (the tree's path if NULL) to the root, updating the stats of every node on it.
+ * NODE took CHOSEN_ACTION (NODE is skipped if it is terminal), and the simulation ended with the (normalized) REWARD.
+ * PLAYER1_ACTIONS and PLAYER2_ACTIONS hold the actions each player took below NODE, for the RAVE updates.
+ *
+ * If BATCH is not NULL, several rollouts were played from NODE instead: NODE is updated once per rollout, with the rollout's
+ * own first action and reward (CHOSEN_ACTION and REWARD are ignored), and each node above it is updated once for the whole
+ * batch, with the total reward.  The RAVE actions of the rollouts are taken from the batch, rather than from the player lists.
+ * Returns the root node.
+ */
+static MCTS_Node* propagateStatsFrom(MCTS_Node* node, int chosen_action, double reward,
+	vector<int>* player1_actions, vector<int>* player2_actions, vector<PathStep>* path, RolloutBatch* batch=NULL) {
+
+	if (path == NULL) {
+		path = node->getPath();
+	}
+	MCTS_Node* curr_node = node;
+	// whether CURR_NODE's action was taken by chooseBestAction (rather than by a rollout), and so holds a virtual loss
+	bool on_path = false;
+	// the number of simulations that each node on the path counts
+	int num_visits = 1;
+	if (batch != NULL) {
+		num_visits = batch->size();
+		reward = batch->total_reward;
+	}
+
+	while (true) {
+
+		// there are no stats for the terminal state
+		if (!curr_node->isTerminal()) {
+
+			// whether or not this tree uses RAVE, update the normal stats N(s), N(s, a) and R(s,a) for this node
+			if (batch != NULL && !on_path) {
+				// each rollout took its own first action from the leaf
+				for (int rollout_num = 0; rollout_num < num_visits; rollout_num++) {
+					curr_node->updateStats(batch->first_actions[rollout_num], batch->rewards[rollout_num]);
+				}
+			} else if (on_path && curr_node->getConfig()->concurrent) {
+				curr_node->updateStatsAfterVirtualLoss(chosen_action, reward, num_visits);
+			} else {
+				curr_node->updateStats(chosen_action, reward, false, num_visits);
+			}
+
+			// if this tree uses RAVE, update additional stats using the all-moves-as-first method
+			if (curr_node->usesRave()) {
+				// determine which player's turn it is on this move
+				// add this action to the list of actions that this player has taken in this simulation
+				// update this node's stats using the all-moves-as-first method
+				// (the leaf's actions in a batch of rollouts are the rollouts' first actions, which the batch already holds)
+				int turn = curr_node->getState()->turn();
+				ASSERT(turn == 1 || turn == -1, "Turn must have been 1 or -1");
+				vector<int>* player_actions = (turn == 1) ? player1_actions : player2_actions;
+				if (batch == NULL || on_path) {
+					player_actions->push_back(chosen_action);
+				}
+				curr_node->updateStatsRave(*player_actions, reward, num_visits);
+				if (batch != NULL) {
+					int player = (turn == 1) ? 0 : 1;
+					curr_node->updateStatsRave(batch->rave_actions[player], batch->rave_counts[player], batch->rave_rewards[player]);
+				}
+
+			}
+		}
+
+		// if we've reached the top of the tree (a root node), mark this simulation as finished
+		if (curr_node->isRoot()) {
+			ASSERT(path->empty(), "The simulation path should end at the root");
+			curr_node->markSimulationFinished();
+			return curr_node;
+		}
+
+		// step back up the path this simulation took (a node may have several parents, so this is not getParent)
+		ASSERT(!path->empty(), "The simulation path ended before reaching the root");
+		PathStep step = path->back();
+		path->pop_back();
+
+		// if the node is shared with a position symmetric to the one this step reached, the RAVE actions below it are in the
+		// node's frame, so map them into the frame of the step's node
+		if (curr_node->usesRave() && curr_node->getConfig()->use_transpositions) {
+			int from_symmetry = curr_node->getSymmetry();
+			int to_symmetry = step.node->getEdgeSymmetry(step.action);
+			mapActions(curr_node->getState(), from_symmetry, to_symmetry, player1_actions);
+			mapActions(curr_node->getState(), from_symmetry, to_symmetry, player2_actions);
+			if (batch != NULL) {
+				mapActions(curr_node->getState(), from_symmetry, to_symmetry, &batch->rave_actions[0]);
+				mapActions(curr_node->getState(), from_symmetry, to_symmetry, &batch->rave_actions[1]);
+			}
+		}
+
+		chosen_action = step.action;
+		curr_node = step.node;
+		on_path = true;
+
+	}
+
+}
+
+MCTS_Node* propagateStats(MCTS_Node* node, vector<PathStep>* path) {
 
-	profiler.start("propagateStats");
+	PROFILE_SCOPE(PROPAGATE_STATS);
 
 	ASSERT(node != NULL, "Cannot propagate stats starting at a null node");
 	// the given node is terminal, start here and propagate up
@@ -852,81 +1181,144 @@ MCTS_Node* propagateStats(MCTS_Node* node) {
 	vector<int> player1_actions;
 	vector<int> player2_actions;
 	
-	MCTS_Node* curr_node = node;
-	int chosen_action = curr_node->getChildIndex();
+	// the terminal node itself takes no action, and has no stats to update
+	MCTS_Node* root = propagateStatsFrom(node, -1, reward, &player1_actions, &player2_actions, path);
 
-	while (curr_node != NULL) {
+	return root;
+}
 
-		// there are no stats for the terminal state
-		if (curr_node->isTerminal()) {
-			curr_node = curr_node->getParent();
-			continue;
-		}
+MCTS_Node* propagateStats(MCTS_Node* node, double reward, const vector<int>& rollout_actions, vector<PathStep>* path) {
 
-		// whether or not this tree uses RAVE, update the normal stats N(s), N(s, a) and R(s,a) for this node
-		curr_node->updateStats(chosen_action, reward);
-		
-		// if this tree uses RAVE, update additional stats using the all-moves-as-first method
-		if (curr_node->usesRave()) {
-			// determine which player's turn it is on this move
-			// add this action to the list of actions that this player has taken in this simulation
-			// update this node's stats using the all-moves-as-first method
-			int turn = curr_node->getState()->turn();
-			ASSERT(turn == 1 || turn == -1, "Turn must have been 1 or -1");
-			if (turn == 1) {
-				player1_actions.push_back(chosen_action);
-				curr_node->updateStatsRave(player1_actions, reward);
+	PROFILE_SCOPE(PROPAGATE_STATS);
+
+	ASSERT(node != NULL, "Cannot propagate stats starting at a null node");
+	ASSERT(!node->isTerminal(), "Cannot propagate rollout stats starting at a terminal node");
+	ASSERT(rollout_actions.size() > 0, "A rollout from a non-terminal node must have at least one action");
+
+	// NODE took the first rollout action, and the players alternated after that.
+	// seed each player's RAVE action list with the rest of the rollout, as if the rollout nodes had been made
+	vector<int> player1_actions;
+	vector<int> player2_actions;
+	if (node->usesRave()) {
+		int turn = node->getState()->turn();
+		for (int i = 1; i < rollout_actions.size(); i++) {
+			int player = (i % 2 == 0) ? turn : -turn;
+			if (player == 1) {
+				player1_actions.push_back(rollout_actions[i]);
 			} else {
-				player2_actions.push_back(chosen_action);
-				curr_node->updateStatsRave(player2_actions, reward);
+				player2_actions.push_back(rollout_actions[i]);
 			}
-
-		}
-		
-		// if we've reached the top of the tree (a root node), mark this simulation as finished 
-		if (curr_node->isRoot()) {
-			curr_node->markSimulationFinished();
-			profiler.stop("propagateStats");
-			return curr_node;
 		}
+	}
 
-		// update variables to prepare for next iteration up the tree
-		chosen_action = curr_node->getChildIndex();
-		curr_node = curr_node->getParent();
+	MCTS_Node* root = propagateStatsFrom(node, rollout_actions[0], reward, &player1_actions, &player2_actions, path);
 
-	}
-	
-	ASSERT(false, "propagateStats should have returned before this point");
+	return root;
+}
+
+MCTS_Node* propagateStats(MCTS_Node* node, RolloutBatch* batch, vector<PathStep>* path) {
+
+	PROFILE_SCOPE(PROPAGATE_STATS);
+
+	ASSERT(node != NULL, "Cannot propagate stats starting at a null node");
+	ASSERT(batch != NULL, "Cannot propagate a null batch of rollouts");
+	ASSERT(!node->isTerminal(), "Cannot propagate rollout stats starting at a terminal node");
+	ASSERT(batch->size() > 0, "Cannot propagate an empty batch of rollouts");
 
+	// the path above the leaf is the same for every rollout, so the player lists start out empty
+	vector<int> player1_actions;
+	vector<int> player2_actions;
+	MCTS_Node* root = propagateStatsFrom(node, -1, 0, &player1_actions, &player2_actions, path, batch);
+
+	return root;
 }
 
 
-MCTS_Node* rolloutSimulation(MCTS_Node* node) {
-	profiler.start("rolloutSimulation");
+/**
+ * Returns this thread's scratch state, overwritten with a copy of STATE.
+ * The scratch state is allocated on the first rollout of each thread, and reused by every rollout after that.
+ */
+static EnvState* scratchState(const EnvState* state) {
+	thread_local unique_ptr<EnvState> scratch;
+	if (scratch == nullptr) {
+		scratch.reset(state->clone());
+	} else {
+		scratch->copyFrom(*state);
+	}
+	return scratch.get();
+}
+
+/**
+ * Plays one random game out from NODE's state, without making any nodes, and returns its (normalized) reward.
+ * ROLLOUT_ACTIONS is overwritten with the actions of the rollout, in order.
+ */
+static double playRollout(MCTS_Node* node, vector<int>* rollout_actions) {
+
+	// profile the rollout on its own, apart from the stats propagation after it
+	PROFILE_SCOPE(ROLLOUT_SIMULATION);
+
+	rollout_actions->clear();
+	double reward;
+	double max_reward;
+	if (node->usesFillRollouts()) {
+		// fill the board in one go
+		reward = node->getState()->fillRollout(rollout_actions, &max_reward);
+	} else {
+		// choose a random action, take it in place. repeat until terminal state
+		EnvState* scratch = scratchState(node->getState());
+		while (!scratch->isTerminalState()) {
+			int random_action = scratch->randomAction();
+			rollout_actions->push_back(random_action);
+			scratch->applyAction(random_action);
+		}
+		reward = scratch->reward();
+		max_reward = scratch->maxReward();
+	}
+	return reward / max_reward;
+}
+
+MCTS_Node* rolloutSimulation(MCTS_Node* node, vector<PathStep>* path) {
 
 	ASSERT(node != NULL, "Cannot roll out simulation starting at a null node");
+	ASSERT(!node->isTerminal(), "Cannot roll out simulation starting at a terminal node");
 
-	// choose a random action, take it. repeat until terminal action, return terminal action
-	MCTS_Node* curr_node = node;
-	while (!curr_node->isTerminal()) {
-		int random_action = curr_node->getState()->randomAction();
-		curr_node = curr_node->makeChild(random_action);
+	// the rollout actions are kept for the RAVE updates; the vector is reused across rollouts on this thread
+	thread_local vector<int> rollout_actions;
+
+	int num_rollouts = node->getConfig()->rollouts_per_leaf;
+	if (num_rollouts == 1) {
+		double reward = playRollout(node, &rollout_actions);
+		return propagateStats(node, reward, rollout_actions, path);
 	}
 
-	profiler.stop("rolloutSimulation");
-	return curr_node;
+	// play every rollout first, totalling the results (the batch is reused across leaves on this thread)
+	thread_local RolloutBatch batch;
+	batch.reset(node->getNumActions(), node->getState()->turn(), node->usesRave());
+	if (node->usesFillRollouts() && node->getState()->supportsBatchRollout()) {
+		// play all the rollouts at once
+		PROFILE_SCOPE(ROLLOUT_SIMULATION);
+		node->getState()->batchRollout(num_rollouts, &batch);
+	} else {
+		for (int rollout_num = 0; rollout_num < num_rollouts; rollout_num++) {
+			double reward = playRollout(node, &rollout_actions);
+			batch.addRollout(rollout_actions, reward);
+		}
+	}
+
+	return propagateStats(node, &batch, path);
 }
 
 
 
 
 
+
 MCTS_Node* runMCTS(MCTS_Node* node, int max_depth, ActionDistribution* ad) {
 
 	ASSERT(node != NULL, "Cannot have a null node in runMCTS");
 	ASSERT(max_depth > 0, "Must have positive max depth");
 
-	profiler.start("runMCTS");
+	PROFILE_SCOPE(RUN_MCTS);
 
 	MCTS_Node* curr_node = node;
 
@@ -949,7 +1341,7 @@ MCTS_Node* runMCTS(MCTS_Node* node, int max_depth, ActionDistribution* ad) {
 
 		// if we are at max depth, perform rollout
 		if (curr_node->getDepth() == max_depth) {
-			curr_node = rolloutSimulation(curr_node); // should return terminal node
+			curr_node = rolloutSimulation(curr_node); // should return root node
 			continue;
 		}
 
@@ -958,7 +1350,6 @@ MCTS_Node* runMCTS(MCTS_Node* node, int max_depth, ActionDistribution* ad) {
 		if (curr_node->requiresNN()) {
 			if (curr_node->neverSubmittedToNN()) {
 				curr_node->markSubmittedToNN();
-				profiler.stop("runMCTS");
 				return curr_node;
 			}
 			// if was previously waiting for AD, grab the given one and set it as a field
@@ -976,23 +1367,246 @@ MCTS_Node* runMCTS(MCTS_Node* node, int max_depth, ActionDistribution* ad) {
 
 	}
 
-	profiler.stop("runMCTS");
 	return curr_node;
 }
 
 
-MCTS_Node* runAllSimulations(MCTS_Node* node, int max_depth) {
+/* How a simulation of runMCTSInFlight stopped. */
+enum SimulationStop {
+	SIMULATION_FINISHED, // its stats were propagated up to the root
+	SIMULATION_WAITING, // it reached a node that needs an NN prior, and submitted it
+	SIMULATION_COLLIDED // it reached a node that another simulation is already waiting on
+};
+
+/**
+ * Continues a simulation from NODE, along PATH (which led to it from the root), until it finishes or stops at a node
+ * whose NN prior it has to wait on.  In the latter case, the node is returned through WAITING_NODE.
+ */
+static SimulationStop continueSimulation(MCTS_Node* node, int max_depth, vector<PathStep>* path, MCTS_Node** waiting_node) {
+	while (true) {
+		if (node->isTerminal()) {
+			propagateStats(node, path);
+			return SIMULATION_FINISHED;
+		}
+		if (node->getDepth() == max_depth) {
+			rolloutSimulation(node, path);
+			return SIMULATION_FINISHED;
+		}
+		if (node->neverSubmittedToNN()) {
+			node->markSubmittedToNN();
+			*waiting_node = node;
+			return SIMULATION_WAITING;
+		}
+		if (node->awaitingNNResults()) {
+			*waiting_node = node;
+			return SIMULATION_COLLIDED;
+		}
+		node = node->chooseBestAction(path);
+	}
+}
+
+/* Takes the virtual loss of each step of an abandoned simulation's PATH back out. */
+static void abandonSimulation(const vector<PathStep>& path) {
+	for (const PathStep& step : path) {
+		step.node->revertVirtualLoss(step.action);
+	}
+}
+
+int runMCTSInFlight(MCTS_Node* root, int max_depth, int max_in_flight, vector<PendingEvaluation>* in_flight) {
+
+	ASSERT(root != NULL && root->isRoot(), "Can only run in-flight simulations from a root node");
+	ASSERT(root->requiresNN(), "Only trees that require an NN have simulations waiting on it");
+	ASSERT(max_depth > 0, "Must have positive max depth");
+	ASSERT(max_in_flight > 0, "Must allow a positive number of simulations in flight, not " << max_in_flight);
+	ASSERT(in_flight != NULL, "Cannot run in-flight simulations with a null in_flight vector");
+
+	PROFILE_SCOPE(RUN_MCTS);
+
+	if (root->simulationsFinished()) {
+		return 0;
+	}
+	// selection counts a virtual loss on every edge a simulation is waiting below, as when several threads search the tree
+	if (!root->getConfig()->concurrent) {
+		ASSERT(in_flight->empty(), "The tree must stay concurrent while simulations are in flight");
+		root->setConcurrent(true);
+	}
+
+	// resume the simulations whose priors have arrived
+	int i = 0;
+	while (i < in_flight->size()) {
+		PendingEvaluation& pending = in_flight->at(i);
+		if (pending.node->awaitingNNResults()) {
+			i++;
+			continue;
+		}
+		MCTS_Node* waiting_node = NULL;
+		SimulationStop stop = continueSimulation(pending.node, max_depth, &pending.path, &waiting_node);
+		if (stop == SIMULATION_WAITING) {
+			pending.node = waiting_node;
+			i++;
+			continue;
+		}
+		if (stop == SIMULATION_COLLIDED) {
+			abandonSimulation(pending.path);
+		}
+		// the order of the simulations does not matter, so fill the gap with the last one
+		in_flight->at(i) = in_flight->back();
+		in_flight->pop_back();
+	}
+
+	// start new simulations, counting the ones in flight as started, until enough are waiting
+	while (in_flight->size() < max_in_flight && root->numSimulationsFinished() + in_flight->size() < root->numSimulations()) {
+		PendingEvaluation pending;
+		MCTS_Node* waiting_node = NULL;
+		SimulationStop stop = continueSimulation(root, max_depth, &pending.path, &waiting_node);
+		if (stop == SIMULATION_WAITING) {
+			pending.node = waiting_node;
+			in_flight->push_back(pending);
+		} else if (stop == SIMULATION_COLLIDED) {
+			// the next simulations would most likely take the same path, so wait for the priors instead
+			abandonSimulation(pending.path);
+			break;
+		}
+	}
+
+	// free the tree once the last simulation has finished, as runMCTS does
+	if (in_flight->empty()) {
+		ASSERT(root->simulationsFinished(), "Every simulation should have finished once none are in flight");
+		root->setConcurrent(false);
+		root->deleteTree();
+	}
+	return in_flight->size();
+}
+
+
+/**
+ * The work of one of the threads that search ROOT's tree together: runs whole simulations (without an NN),
+ * each down to MAX_DEPTH and then rolled out, until every simulation has been claimed by some thread.
+ */
+static void searchTree(MCTS_Node* root, int max_depth) {
+
+	PROFILE_SCOPE(RUN_MCTS);
+
+	// each thread keeps the path of its own simulation
+	vector<PathStep> path;
+
+	while (root->claimSimulation()) {
+		MCTS_Node* curr_node = root;
+		while (!curr_node->isTerminal() && curr_node->getDepth() < max_depth) {
+			curr_node = curr_node->chooseBestAction(&path);
+		}
+
+		if (curr_node->isTerminal()) {
+			propagateStats(curr_node, &path);
+		} else {
+			rolloutSimulation(curr_node, &path);
+		}
+	}
+}
+
+/* Runs searchTree on a new thread, which draws its random numbers from RNG (split off from the thread that started it). */
+static void searchTreeOnThread(MCTS_Node* root, int max_depth, Rng rng) {
+	setThreadRng(rng);
+	searchTree(root, max_depth);
+}
+
+MCTS_Node* runAllSimulations(MCTS_Node* node, int max_depth, int num_threads) {
 
 	ASSERT(node != NULL, "Cannot run all simulations with a null node");
 	ASSERT(max_depth > 0, "Must have positive max depth");
+	ASSERT(num_threads > 0, "Must have a positive number of threads, not " << num_threads);
+
+	if (num_threads == 1) {
+		while (!node->simulationsFinished()) {
+			node = runMCTS(node, max_depth, NULL /* ad */);
+		}
+		return node;
+	}
+
+	ASSERT(node->isRoot(), "Only root nodes can be searched by several threads");
+	ASSERT(!node->requiresNN(), "Trees that require an NN cannot be searched by several threads");
 
-	while (!node->simulationsFinished()) {
-		node = runMCTS(node, max_depth, NULL /* ad */);
+	// the calling thread searches too, alongside NUM_THREADS - 1 new ones
+	node->setConcurrent(true);
+	vector<thread> workers;
+	for (int thread_num = 1; thread_num < num_threads; thread_num++) {
+		workers.push_back(thread(searchTreeOnThread, node, max_depth, threadRng().split()));
 	}
+	searchTree(node, max_depth);
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	node->setConcurrent(false);
+
+	// free the tree, as runMCTS does once the last simulation has finished
+	node->deleteTree();
 	return node;
 }
 
 
+/* The root stats of one tree of an ensemble.  Each is aligned to its own cache lines, so that no two threads write to the same line. */
+struct alignas(CACHE_LINE_SIZE) EnsembleStats {
+	vector<int> action_counts;
+	vector<double> total_rewards;
+};
+
+/**
+ * The work of one of the threads of an ensemble: searches a tree of its own, copied from ROOT, with NUM_THREADS threads,
+ * and adds its root stats into STATS.  The tree (and its arena) is made and deleted on this thread, so it shares no memory with the others.
+ * The thread draws its random numbers from RNG (split off from the thread that started it).
+ */
+static void searchEnsembleTree(const MCTS_Node* root, int max_depth, int num_threads, EnsembleStats* stats, Rng rng) {
+	setThreadRng(rng);
+	MCTS_Node* tree = root->copyRoot();
+	runAllSimulations(tree, max_depth, num_threads);
+	tree->addActionStats(&stats->action_counts, &stats->total_rewards);
+	delete tree;
+}
+
+MCTS_Node* runEnsembleSimulations(MCTS_Node* root, int num_trees, int max_depth, vector<int>* action_counts, vector<double>* mean_rewards,
+	int num_threads_per_tree) {
+
+	ASSERT(root != NULL && root->isRoot(), "Can only run an ensemble from a root node");
+	ASSERT(!root->requiresNN(), "Trees that require an NN cannot be searched as an ensemble");
+	ASSERT(num_trees > 0, "Must have a positive number of trees, not " << num_trees);
+	ASSERT(action_counts != NULL && mean_rewards != NULL, "Cannot merge ensemble stats into null vectors");
+
+	int num_actions = root->getNumActions();
+	vector<EnsembleStats> tree_stats(num_trees);
+	for (EnsembleStats& stats : tree_stats) {
+		stats.action_counts.assign(num_actions, 0);
+		stats.total_rewards.assign(num_actions, 0.0);
+	}
+
+	// the calling thread searches ROOT's own tree, alongside NUM_TREES - 1 new threads with a tree each
+	vector<thread> workers;
+	for (int tree_num = 1; tree_num < num_trees; tree_num++) {
+		workers.push_back(thread(searchEnsembleTree, root, max_depth, num_threads_per_tree, &tree_stats[tree_num], threadRng().split()));
+	}
+	root = runAllSimulations(root, max_depth, num_threads_per_tree);
+	root->addActionStats(&tree_stats[0].action_counts, &tree_stats[0].total_rewards);
+	for (thread& worker : workers) {
+		worker.join();
+	}
+
+	// merge the trees: sum the counts and rewards, then take the means
+	action_counts->assign(num_actions, 0);
+	mean_rewards->assign(num_actions, 0.0);
+	for (const EnsembleStats& stats : tree_stats) {
+		for (int action = 0; action < num_actions; action++) {
+			action_counts->at(action) += stats.action_counts[action];
+			mean_rewards->at(action) += stats.total_rewards[action];
+		}
+	}
+	for (int action = 0; action < num_actions; action++) {
+		if (action_counts->at(action) != 0) {
+			mean_rewards->at(action) /= action_counts->at(action);
+		}
+	}
+	return root;
+}
+
+
 
 
 
@@ -1145,9 +1759,14 @@ int readCSVFile(string game, int num_states, string file_path, vector<MCTS_Node*
     	double c_b = options.getDouble("c_b", DEFAULT_C_B);
     	double c_rave = options.getDouble("c_rave", DEFAULT_C_RAVE);
     	double w_a = options.getDouble("w_a", DEFAULT_W_A);
+    	bool fill_rollouts = options.getBool("fill_rollouts", DEFAULT_FILL_ROLLOUTS);
+    	bool use_transpositions = options.getBool("use_transpositions", DEFAULT_USE_TRANSPOSITIONS);
+    	double virtual_loss = options.getDouble("virtual_loss", DEFAULT_VIRTUAL_LOSS);
+    	int rollouts_per_leaf = options.getInt("rollouts_per_leaf", DEFAULT_ROLLOUTS_PER_LEAF);
 
     	// build an MCTS_Node from this state
-    	MCTS_Node* node = new MCTS_Node(state, is_root, num_simulations, sample_actions, requires_nn, use_rave, c_b, c_rave, w_a);
+    	MCTS_Node* node = new MCTS_Node(state, is_root, num_simulations, sample_actions, requires_nn, use_rave, c_b, c_rave, w_a, fill_rollouts,
+    		use_transpositions, virtual_loss, rollouts_per_leaf);
     	// add the node to the vector of nodes
     	nodes->push_back(node);
 
@@ -6,6 +6,9 @@
 //#include "tictactoe.h"
 #include "config.h"
 #include "utils.h"
+#include "node_arena.h"
+#include "uct_kernel.h"
+#include "transposition_table.h"
 
 #include <vector>
 #include <map>
@@ -15,6 +18,8 @@
 #include <string>
 #include <random>
 #include <math.h> // log
+#include <stdint.h>
+#include <atomic>
 
 
 
@@ -43,6 +48,9 @@ public:
 	 * Errors if K is out of range. */
 	double at(int k) const;
 
+	/* Returns the number of elements in the _sv vector. */
+	int size() const;
+
 	/* Returns a CSV string representation of this StateVector. */
 	string asCSVString() const;
 
@@ -80,6 +88,61 @@ public:
 };
 
 
+/**
+ * One step of a simulation's path down the tree: the node, and the action that was taken from it.
+ * With transpositions, a node can be reached from several parents, so stats are propagated back up the path that
+ * the simulation actually took, rather than through parent pointers.
+ */
+struct PathStep {
+	MCTS_Node* node;
+	int action;
+};
+
+
+/**
+ * The flags and hyperparameters of one MCTS tree.
+ * These are the same for every node in a tree, so the root owns a single SearchConfig and every node points to it.
+ */
+struct SearchConfig {
+
+	/* If true, sample actions with softmax probabilities, if false, choose action with highest score. */
+	bool sample_actions;
+	/* Specifies whether an NN apprentice is needed when determining which action to take during MCTS. */
+	bool requires_nn;
+	/* Specifies whether to use Rapid Value Estimation (RAVE) when computing action scores. */
+	bool use_rave;
+	/* Specifies whether rollouts fill the board in one go, instead of making a node per move. */
+	bool fill_rollouts;
+	/**
+	 * Specifies whether move orders that reach the same position share one node (see TranspositionTable).
+	 * Positions are keyed by their canonical hash (see EnvState::canonicalHash), so symmetric positions share a node too.
+	 */
+	bool use_transpositions;
+	/**
+	 * The number of rollouts played from each leaf that a simulation reaches.  If it is more than 1, the rollouts' results
+	 * are totalled and propagated up the tree once (see RolloutBatch), counting as that many visits of every node on the path.
+	 * With fill rollouts, states that support batch rollouts play all of them at once (see EnvState::batchRollout).
+	 */
+	int rollouts_per_leaf;
+
+	/* Hyperparameter that weighs exploration vs taking the best actions. */
+	double c_b;
+	/* Hyperparameter that determines how quickly RAVE values are down-weighted as the number of samples increases. */
+	double c_rave;
+	/* Hyperparameter that determines how much weight to give the NN apprentice recommendation. */
+	double w_a;
+	/* The (normalized) reward counted as lost on each edge that a thread is still searching below, when several threads search the tree. */
+	double virtual_loss;
+
+	/**
+	 * Set while several threads search the tree at once (see runAllSimulations).  Stats are then updated atomically,
+	 * children are made under the root's expansion lock, and selection adds virtual loss to spread the threads out.
+	 */
+	bool concurrent;
+
+};
+
+
 // To do: make public getters for state, and updaters for N, R, etc
 class MCTS_Node {
 
@@ -98,26 +161,54 @@ public:
 	 * If false, it does not need to query an NN apprentice when choosing an action.
 	 * The flag USE_RAVE specifies whether to use Rapid Value Estimation (RAVE) when choosing actions.
 	 * See comments for NRave and RRave functions for details.
+	 * The flag FILL_ROLLOUTS specifies whether rollouts fill the board in one go (see EnvState::fillRollout) rather than
+	 * making a node per move.  It is ignored if the state does not support fill rollouts.
+	 * The flag USE_TRANSPOSITIONS specifies whether move orders that reach the same position (or a symmetric one) share
+	 * a single node (and so its stats and NN prior), which turns the tree into a directed acyclic graph.  It is off by default
+	 * (agents turn it on with the "use_transpositions" option).
+	 * VIRTUAL_LOSS is only used when several threads search the tree at once (see runAllSimulations).
+	 * ROLLOUTS_PER_LEAF is the number of rollouts played from each leaf a simulation reaches (see SearchConfig::rollouts_per_leaf).
+	 *
+	 * Only root nodes are constructed directly (IS_ROOT must be true); the rest of the tree is made by makeChild.
+	 * The root owns STATE, the tree's SearchConfig, and a NodeArena that all of its descendants (their stats arrays and states included) live in.
 	 */
 	MCTS_Node(EnvState* state, bool is_root=true, int num_simulations=DEFAULT_NUM_SIMULATIONS, bool sample_actions=DEFAULT_SAMPLE_ACTIONS, bool requires_nn=DEFAULT_REQUIRES_NN, bool use_rave=DEFAULT_USE_RAVE,
-		double c_b=DEFAULT_C_B, double c_rave=DEFAULT_C_RAVE, double w_a=DEFAULT_W_A);
+		double c_b=DEFAULT_C_B, double c_rave=DEFAULT_C_RAVE, double w_a=DEFAULT_W_A, bool fill_rollouts=DEFAULT_FILL_ROLLOUTS,
+		bool use_transpositions=DEFAULT_USE_TRANSPOSITIONS, double virtual_loss=DEFAULT_VIRTUAL_LOSS, int rollouts_per_leaf=DEFAULT_ROLLOUTS_PER_LEAF);
 
 	/**
-	 * Deletes all of the N and R vectors for this node.
-	 * Does NOT delete this->state, this->state_vector or this->nn_result, because this could cause the calling code 
-	 * in the ThreadManager to be messed up.
-	 * This function also recursively calls the destructor on all of its non-null children.
+	 * Only root nodes may be deleted.  Deletes the root's state, stats arrays and StateVector, its transposition table,
+	 * and its NodeArena, which frees the whole rest of the tree at once.
 	 */
 	~MCTS_Node();
 
 	/**
 	 * This function is meant to be called on root nodes only (errors otherwise).
-	 * It does not delete itself, but recursively calls the destructor on all of its non-null children.
-	 * This way, the rest of the tree gets deleted, but not the root.
+	 * It does not delete itself, but frees the rest of the tree by releasing the root's NodeArena (and its transposition table).
+	 * This costs O(number of arena chunks), however many nodes the tree has.
 	 * This function is used to free up memory space once all simulations are done, but because we need the root nodes to stay alive.
 	 */
 	void deleteTree();
 
+	/**
+	 * Root only.  Returns a new root for a copy of this root's state, with the same number of simulations and the same
+	 * flags and hyperparameters, but a tree (and arena) of its own.  Used to search several trees of one position (see runEnsembleSimulations).
+	 */
+	MCTS_Node* copyRoot() const;
+
+	/* Returns the NodeArena that this node's tree is allocated from (for capacity and high water stats, or to reserve memory). */
+	NodeArena* getArena() const;
+
+	/* Returns the transposition table of this node's tree.  NULL if the tree does not use transpositions, or has not made any nodes yet. */
+	TranspositionTable* getTranspositions() const;
+
+	/**
+	 * Returns the path that the current simulation of this node's tree has taken from the root: the nodes it has chosen
+	 * actions from (see chooseBestAction), in order.  The path is cleared whenever the root chooses an action.
+	 * This is the path used when no other path is passed in.  Threads that search the tree together each keep their own.
+	 */
+	vector<PathStep>* getPath() const;
+
 
 
 	/* Returns true if this node's state is a terminal state, and false otherwise. */
@@ -131,18 +222,39 @@ public:
 	 * Returns true if this root node has finished all the simulations it was meant to, and false otherwise. */
 	bool simulationsFinished() const;
 
-	/* Mark that another simulation has finished (increment this->num_simulations_finished). */
+	/* Mark that another simulation has finished (increment this->num_simulations_finished).  Safe to call from several threads. */
 	void markSimulationFinished();
 
+	/**
+	 * Only relevant if this node is a root node, when several threads search the tree.
+	 * Claims one of the simulations that have not yet been started, and returns true, or returns false if they all have been.
+	 */
+	bool claimSimulation();
+
+	/**
+	 * Root only.  Marks whether several threads are about to search this tree at once (see SearchConfig::concurrent).
+	 * Must not be called while any thread is searching the tree.
+	 */
+	void setConcurrent(bool concurrent);
+
+	/* Only relevant if this node is a root node.  Returns the total number of simulations this root must complete. */
+	int numSimulations() const;
+
 
 
 	
 	/* Returns whether this node uses Rapid Value Estimation (RAVE). */
 	bool usesRave() const;
 
+	/* Returns whether rollouts from this node fill the board in one go, rather than making a node per move. */
+	bool usesFillRollouts() const;
+
 	/* Returns whether this node requires a Neural Net apprentice when choosing actions. */
 	bool requiresNN() const;
 
+	/* Returns the flags and hyperparameters shared by this node's tree. */
+	const SearchConfig* getConfig() const;
+
 	/**
 	 * Returns true if this node requires an NN, AND has not yet submitted its state vector to the NN.
 	 * Returns false if this node doesn't use an NN, OR if the node has previously submitted to the NN.
@@ -165,13 +277,19 @@ public:
 	/* Returns this->num_actions. */
 	int getNumActions() const;
 
+	/* Returns the number of edges out of this node (one per legal action of its state). */
+	int getNumEdges() const;
+
+	/* Returns the action that edge EDGE takes.  Edges are sorted by action. */
+	int getEdgeAction(int edge) const;
+
 	/* Returns the depth of this node in its tree. (Root nodes have a depth of 0). */
 	int getDepth() const;
 
-	/* Returns the parent of this node (Root nodes have a NULL parent). */
+	/* Returns the parent of this node, which is the node it was first made from (Root nodes have a NULL parent). */
 	MCTS_Node* getParent() const;
 
-	/* Returns the K-th child of this node, which may be NULL if this node has never visited its K-th child. */
+	/* Returns the K-th child of this node, which is NULL if this node has never visited its K-th child (or action K is not legal). */
 	MCTS_Node* getChild(int k) const;
 
 	/* Returns the child_index of this node.  If this node is the K-th child of its parent, then its child_index is K. */
@@ -180,12 +298,30 @@ public:
 	/* Returns the root of this node's tree.  If this node is a root, returns itself. */
 	MCTS_Node* getRoot() const;
 
+	/**
+	 * Returns the symmetry that maps this node's state to its canonical position (see EnvState::canonicalHash).
+	 * This is 0 unless the tree uses transpositions, and always 0 for the root.
+	 */
+	int getSymmetry() const;
+
+	/**
+	 * Returns the symmetry that maps the position action K leads to onto its canonical position.
+	 * If that differs from the K-th child's own symmetry, the child is shared with a symmetric position, and actions in the
+	 * child's frame map to actions in this node's frame by getState()->symmetricAction through the child's symmetry, then this one.
+	 * This is 0 unless the tree uses transpositions.  Errors if action K is not legal.
+	 */
+	int getEdgeSymmetry(int k) const;
+
 	/**
 	 * Returns the K-th child of this node, creating it if it hasn't yet been created.
 	 * If this node's state is terminal, returns itself.
 	 * If this node's K-th child has already been made, just returns that child.
+	 * If the tree uses transpositions, and another node already holds the position that action K leads to (or a symmetric one),
+	 * that node becomes this node's K-th child too, and is returned.  Its state (and so the frame its actions are in) is then the
+	 * other node's, see getEdgeSymmetry.
 	 *
-	 * Otherwise, grabs the state that results from taking action K from this node's state, and creates a node for that new state
+	 * Otherwise, copies this node's state into the tree's NodeArena and takes action K on the copy in place,
+	 * then creates a node for that new state in the NodeArena.
 	 * Sets that node to be the K-th child of this one (and sets the parent of that new node to be this node).
 	 * Sets all the instance variables of the new node appropriately (the depth, for example, is one more than the depth of this node.)
 	 * Returns the new node.
@@ -196,17 +332,17 @@ public:
 
 
 
-	/* Returns the vector of edge traversals. */
-	vector<int>* edgeTraversals() const;
+	/* Returns the array of edge traversals (one per edge, see getEdgeAction). */
+	const uint32_t* edgeTraversals() const;
 
-	/* Returns the vector of edge rewards. */
-	vector<double>* edgeRewards() const;
+	/* Returns the array of edge rewards (one per edge). */
+	const float* edgeRewards() const;
 
-	/* Returns the vector of edge traversals for RAVE. */
-	vector<int>* edgeTraversalsRave() const;
+	/* Returns the array of edge traversals for RAVE (one per edge).  NULL if the tree does not use RAVE. */
+	const uint32_t* edgeTraversalsRave() const;
 
-	/* Returns the vector of edge rewards for RAVE. */
-	vector<double>* edgeRewardsRave() const;
+	/* Returns the array of edge rewards for RAVE (one per edge).  NULL if the tree does not use RAVE. */
+	const float* edgeRewardsRave() const;
 
 
 
@@ -214,14 +350,24 @@ public:
 	/* Return a pointer to the EnvState instance (the state) of this node. */
 	EnvState* getState() const;
 
-	/* Return a pointer to a StateVector instance that acts as a wrapper around the state vector of this node's state. */
-	StateVector* getStateVector() const;
+	/**
+	 * Return a pointer to a StateVector instance that acts as a wrapper around the state vector of this node's state.
+	 * The StateVector is only built the first time it is asked for (when the node is queued for inference),
+	 * so nodes that never query an NN never pay for it.
+	 */
+	StateVector* getStateVector();
 
-	/* Set the nn_result field with the given ActionDistribution. */
+	/**
+	 * Copies the given ActionDistribution into this node's NN prior (one per edge, in the tree's NodeArena), and deletes AD.
+	 * This also frees this node's StateVector, since the NN has no further use for it.
+	 */
 	void setNNActionDistribution(ActionDistribution* ad);
 
-	/* Returns a vector where the K-th element is the number of times action K was taken from this node during MCTS. */
-	vector<int>* getActionCounts() const;
+	/**
+	 * Populates a vector where the K-th element is the number of times action K was taken from this node during MCTS.
+	 * The action_counts vector must not be null, and must have at least this->num_actions elements.
+	 */
+	void getActionCounts(vector<int>* action_counts) const;
 
 	/**
 	 * Populates a vector where the K-th element is the proportion of times action K was taken from this node during MCTS. 
@@ -234,14 +380,16 @@ public:
 
 	/**
 	 * Choose the best action (from previous simulation stats and/or NN apprentice advice) to take from this node's state.
-	 * Does this by first computing scores for each action (UCT, UCT-NN, UCT-Rave, UCT-NN-Rave, etc).
-	 * Then either samples an action with probabilities proportional to the softmax of the scores (if this->sample_actions is true),
+	 * Does this by first computing scores for each edge (UCT, UCT-NN, UCT-Rave, UCT-NN-Rave, etc).
+	 * Then either samples an edge with probabilities proportional to the softmax of the scores (if config->sample_actions is true),
 	 * or else picks the action with the highest score.
 	 *
 	 * Suppose the above logic chooses action K as the best action.
-	 * This function will then return the K-th child node, creating that node if it has never been visited before.
+	 * This function will then add this node and K to the path of the current simulation (PATH, or the tree's path if NULL, see getPath),
+	 * and return the K-th child node, creating that node if it has never been visited before.
+	 * If several threads search the tree, edge K also gets a virtual loss, until propagateStats takes it back out.
 	 */
-	MCTS_Node* chooseBestAction();
+	MCTS_Node* chooseBestAction(vector<PathStep>* path=NULL);
 
 
 
@@ -250,15 +398,38 @@ public:
 	 * This function is used when the node does not use RAVE. 
 	 * Increments this->num_node_vists and this->num_edge_traversals(action_num) by 1, and increment this->edge_rewards(action_num) by REWARD.
 	 * CHOSEN_ACTION is expected to be within the correct range, and it is an error if it is not.
+	 * Regular stats can only be updated for legal actions (which have an edge); RAVE updates for other actions are ignored.
+	 * If NUM_VISITS is more than 1, the action was taken in that many simulations (see SearchConfig::rollouts_per_leaf),
+	 * which are all counted at once, and REWARD is their total reward.
 	 */
-	inline void updateStats(int chosen_action, double reward, bool update_rave_stats=false);
+	inline void updateStats(int chosen_action, double reward, bool update_rave_stats=false, int num_visits=1);
+
+	/**
+	 * Like updateStats, for an action that chooseBestAction took while several threads searched the tree.
+	 * The visit was already counted along with the virtual loss, so this adds REWARD (and the other NUM_VISITS - 1 visits),
+	 * and takes the virtual loss back out.
+	 */
+	inline void updateStatsAfterVirtualLoss(int chosen_action, double reward, int num_visits=1);
+
+	/**
+	 * Takes back the visit and the virtual loss that chooseBestAction counted for CHOSEN_ACTION, for a simulation that
+	 * was abandoned before it finished (see runMCTSInFlight).  The tree must be concurrent (see setConcurrent).
+	 */
+	void revertVirtualLoss(int chosen_action);
 
 	/**
 	 * Updates the necessary stats for this node, using the RAVE all-moves-as-first method.
 	 * this->num_edge_traversals_rave and this->num_node_visits_rave are both incremented by 1 for every action in the given list.
 	 * this->edge_rewards_rave is incremented by REWARD for every action in the given list.
+	 * If NUM_VISITS is more than 1, the actions were taken in that many simulations, and REWARD is their total reward.
 	 */
-	void updateStatsRave(const vector<int>& chosen_actions, double reward);
+	void updateStatsRave(const vector<int>& chosen_actions, double reward, int num_visits=1);
+
+	/**
+	 * Like updateStatsRave, for actions that were each taken in a different number of rollouts from one leaf:
+	 * ACTIONS[i] was taken in COUNTS[i] of them, whose total reward was REWARDS[i] (see RolloutBatch).
+	 */
+	void updateStatsRave(const vector<int>& actions, const vector<uint32_t>& counts, const vector<double>& rewards);
 
 	
 	/**
@@ -272,6 +443,13 @@ public:
 	 */
 	void getMeanRewards(vector<double>* mean_reward_vec) const;
 
+	/**
+	 * Adds this node's stats to those of other trees searched from the same position: ACTION_COUNTS[K] is incremented by the
+	 * number of times action K was taken from this node, and TOTAL_REWARDS[K] by the total reward over those times.
+	 * Both vectors must have at least this->num_actions elements.
+	 */
+	void addActionStats(vector<int>* action_counts, vector<double>* total_rewards) const;
+
 
 	// debug
 	void printMeanReward() const;
@@ -281,7 +459,22 @@ public:
 
 private:
 
-	
+	/**
+	 * Creates the K-th child of PARENT, for the given STATE (which must already live in the tree's NodeArena).
+	 * Shares PARENT's SearchConfig, and allocates its stats arrays from the NodeArena.
+	 * Only used by makeChild, which places the node itself in the NodeArena.
+	 */
+	MCTS_Node(EnvState* state, MCTS_Node* parent, int k);
+
+	/* Sets up the fields shared by root and child nodes, and allocates an edge (with its stats) for each legal action. */
+	void initialize(EnvState* state);
+
+	/* Returns the edge that takes ACTION, or -1 if ACTION is not legal in this node's state. */
+	int edgeIndex(int action) const;
+
+	/* Returns a zero-initialized array of N elements: from the heap for root nodes, and from the tree's NodeArena otherwise. */
+	template <typename T>
+	T* allocateArray(int n);
 
 
 
@@ -307,20 +500,20 @@ private:
 	/* Returns the number of times this node has been visited during MCTS. */
 	int N() const; // n(s)
 
-	/* Returns the number of times action A has been taken from this node during MCTS.*/
-	int N(int a) const; // n(s,a)
+	/* Returns the number of times edge E has been taken from this node during MCTS.*/
+	int N(int e) const; // n(s,a)
 
-	/* Returns the total reward over all simulations in which we took action A from this node. */
-	double R(int a) const; // r(s, a)
+	/* Returns the total reward over all simulations in which we took edge E from this node. */
+	double R(int e) const; // r(s, a)
 
 	 /* Returns the number of times this node has been visited during MCTS, using the RAVE formula. */ 
 	int NRave() const; // n(s)
 
-	/* Returns the number of times action A has been taken from this node during MCTS, using the RAVE formula. */
-	int NRave(int a) const; // n(s,a)
+	/* Returns the number of times edge E has been taken from this node during MCTS, using the RAVE formula. */
+	int NRave(int e) const; // n(s,a)
 
-	/* Returns the total reward over all simulation in which we took action A from this node, using the RAVE formula. */
-	double RRave(int a) const; // r(s, a)
+	/* Returns the total reward over all simulation in which we took edge E from this node, using the RAVE formula. */
+	double RRave(int e) const; // r(s, a)
 
 
 
@@ -343,45 +536,51 @@ private:
 
 
 
+	/* Returns this node's edge statistics, in the form the scoring kernels (see uct_kernel.h) take them. */
+	EdgeStats edgeStats() const;
+
+	/* Returns this node's RAVE edge statistics, in the form the scoring kernels take them. */
+	EdgeStats edgeStatsRave() const;
+
 	/**
-	 * Computes scores for each action using the basic UCT formula.
-	 * The given vector is populated with these scores.
-	 * Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	 * Computes scores for each edge using the basic UCT formula.
+	 * The given array (which must have room for this->num_edges scores) is populated with these scores.
+	 * Errors if the given array is a NULL pointer.
 	 */
-	void computeUCT(vector<double>* action_scores) const;
+	void computeUCT(float* edge_scores) const;
 
 	/**
-	 * Computes scores for each action using the UCT_RAVE formula.
-	 * The given vector is populated with these scores.
-	 * Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	 * Computes scores for each edge using the UCT_RAVE formula.
+	 * The given array (which must have room for this->num_edges scores) is populated with these scores.
+	 * Errors if the given array is a NULL pointer, or if the tree does not use RAVE.
 	 */
-	void computeUCT_Rave(vector<double>* action_scores) const;
+	void computeUCT_Rave(float* edge_scores) const;
 
 	/**
-	 * Computes scores for each action using the UCT_U_RAVE formula.
-	 * The given vector is populated with these scores.
-	 * Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	 * Computes scores for each edge using the UCT_U_RAVE formula.
+	 * The given EDGE_SCORES array is populated with these scores, and RAVE_SCORES is used as scratch space for the UCT_RAVE scores.
+	 * Both must have room for this->num_edges scores.  Errors if either is a NULL pointer.
 	 */
-	void computeUCT_U_Rave(vector<double>* action_scores) const;
+	void computeUCT_U_Rave(float* edge_scores, float* rave_scores) const;
 
 	/**
-	 * Computes scores for each action using the UCT_NN formula.
-	 * The given vector is populated with these scores.
-	 * Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	 * Computes scores for each edge using the UCT_NN formula.
+	 * The given array (which must have room for this->num_edges scores) is populated with these scores.
+	 * Errors if the given array is a NULL pointer.
 	 */
-	void computeUCT_NN(vector<double>* action_scores) const;
+	void computeUCT_NN(float* edge_scores) const;
 
 	/**
-	 * Computes scores for each action using the UCT_NN_RAVE formula.
-	 * The given vector is populated with these scores.
-	 * Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	 * Computes scores for each edge using the UCT_NN_RAVE formula.
+	 * The given EDGE_SCORES array is populated with these scores, and RAVE_SCORES is used as scratch space for the UCT_RAVE scores.
+	 * Both must have room for this->num_edges scores.  Errors if either is a NULL pointer.
 	 */
-	void computeUCT_NN_Rave(vector<double>* action_scores) const;
+	void computeUCT_NN_Rave(float* edge_scores, float* rave_scores) const;
 
 
 
 	/**
-	* Computes scores for each of the actions.
+	* Computes scores for each of the edges.
 	* The scores are computed using one of the above formulas:
 	*
 	* if neither NN nor RAVE is used, UCT(s, a)
@@ -389,90 +588,111 @@ private:
 	* if RAVE but not NN, UCT_U,RAVE(s, a)
 	* if NN and RAVE, UCT_NN_RAVE(s, a)
 	*
-	* The given vector is populated with these scores.
-	* Errors if the given vector is a NULL pointer, or is not of size this->num_actions.
+	* The given EDGE_SCORES array is populated with these scores (RAVE_SCORES is scratch space for the RAVE formulas).
+	* Both must have room for this->num_edges scores.  Errors if either is a NULL pointer.
 	*/
-	void computeActionScores(vector<double>* action_scores) const;
+	void computeActionScores(float* edge_scores, float* rave_scores) const;
+
+
+	/**
+	 * This method is passed an array of scores, one for each of the edges.
+	 * An edge is sampled, and returned, with probability proportional to the softmax of its score.
+	 * WEIGHTS is scratch space for the softmax, with room for this->num_edges floats. */
+	int sampleEdge(const float* edge_scores, float* weights);
 
 
 	/**
-	 * This method is passed a vector of scores, one for each of the actions.
-	 * First, the softmaxes are computed for each scores (the scores for the illegal actions are given a softmax value of 0).
-	 * Then an action is sampled, and returned, with probability proportional to the softmax values.
-	 * It is expected that the number of elements in action_dist is this->num_actions. */
-	int sampleLegalAction(const vector<double>& action_scores);
+	 * This method is passed an array of scores, one for each of the edges.
+	 * It returns the edge that has the highest score. */
+	int bestEdge(const float* edge_scores);
+
+
+	/**
+	 * The table from position hashes to the nodes of this tree.  Only set (and owned) by root nodes, and only if the tree
+	 * uses transpositions.  It is made with the first child, and deleted (with the rest of the tree) by deleteTree.
+	 */
+	TranspositionTable* transpositions;
 
+	/* The path of the current simulation (see getPath).  Only set (and owned) by root nodes. */
+	vector<PathStep>* path;
+
+	/* Held while making a child, when several threads search the tree (the NodeArena is not thread-safe).  Only set (and owned) by root nodes. */
+	mutex* expansion_lock;
 
 	/**
-	 * This method is passed a vector of scores, one for each of the action.
-	 * It returns the legal action that has the highest score.
-	 * It is expected that the number of elements in action_dist is this->num_actions. */
-	int bestLegalAction(const vector<double>& action_scores);
+	 * The arena that everything below the root of this tree lives in.  Only set (and owned) by root nodes.
+	 * The root's own state and arrays are allocated separately, so that deleteTree can release the arena
+	 * while the root (and its stats) stay alive.
+	 */
+	NodeArena* arena;
 
+	/* The flags and hyperparameters of this node's tree.  Owned by the root, and shared by every node in the tree. */
+	SearchConfig* config;
 
 	/* The state that this node represents. */
 	EnvState* state;
-	/* A Neural Net representation of that state. */
+	/* A Neural Net representation of that state. NULL until getStateVector is first called, and after NN results are set. */
 	StateVector* state_vector;
 
 	/* Denotes whether this node is the root of its tree. */
 	bool is_root;
 	/* Denotes the number of simulations this node has completed (only relevant if root node). */
-	int num_simulations_finished;
+	atomic<int> num_simulations_finished;
+	/* Denotes the number of simulations that threads have claimed, when several search the tree (only relevant if root node). */
+	atomic<int> num_simulations_started;
 	/* Denotes the total number of simulations this node must complete (only relevant if root node). */
 	int total_num_simulations;
 	/* Denotes this node's tree depth (root nodes have a depth of 0). */
 	int depth;
+	/* The symmetry that maps this node's state to its canonical position (see getSymmetry). */
+	int symmetry;
 
 
 	/* Denotes whether this node has submitted its state vector to the NN. */
 	bool submitted_to_nn;
 	/* Denotes whether this node has received results (an ActionDistribution) back from the NN. */
 	bool received_nn_results;
-	/* The result from the NN. */
-	ActionDistribution* nn_result;
+	/* The prior over actions recommended by the NN (one per edge).  NULL until NN results are received. */
+	float* nn_prior;
 	/* The size of the action space of the state's environment. */
 	int num_actions;
+	/* The number of edges out of this node, which is the number of legal actions in the state. */
+	int num_edges;
+	/* The action that each edge takes, in increasing order. */
+	uint16_t* edge_actions;
+	/* The symmetry of the position that each edge leads to (see getEdgeSymmetry).  NULL unless the tree uses transpositions. */
+	uint8_t* edge_symmetries;
 
 
 	/* A pointer to the root of this node's tree (if this is a root node, just a pointer to itself). */
 	MCTS_Node* root;
-	/* A pointer to the parent node of this node (if this is a root node, the parent is NULL). */
+	/* A pointer to the node this node was first made from (if this is a root node, the parent is NULL). */
 	MCTS_Node* parent;
-	/* A vector of this node's children (one for each action that in state's environment). */
-	vector<MCTS_Node*>* children;
-	/* If this node is the K-th child of its parent, its child_index is K.  (The child_index of a root node is -1). */
+	/* An array of this node's children (one for each edge). */
+	MCTS_Node** children;
+	/* If this node is the K-th child of its parent (the node it was first made from), its child_index is K.  (The child_index of a root node is -1). */
 	int child_index;
 
 
-	/* The number of times this node has been visited during MCTS. */
-	int num_node_visits; // n(s)
-	/* The number of times action A has been taken from this state during MCTS. */
-	vector<int>* num_edge_traversals; // n(s,a)
-	/* The total reward over all simulation in which action A was taken from this state during MCTS. */
-	vector<double>* edge_rewards; // r(s, a)
-
-
-	/* The same statistics as above, but using the Rapid Value Estimation formula (RAVE). */
-	int num_node_visits_rave; // n(s)-rave
-	vector<int>* num_edge_traversals_rave; // n(s,a)-rave
-	vector<double>* edge_rewards_rave; // r(s,a)-rave
-
+	/**
+	 * The edge statistics are kept as parallel arrays (one element per edge), so that computing the scores
+	 * scans contiguous memory.  Rewards are normalized to [-1, 1], so floats hold them with plenty of precision.
+	 * When several threads search the tree, each update is atomic, but scoring reads the arrays without locks:
+	 * a score computed from an update that is still in flight is off by at most one visit, which MCTS tolerates.
+	 */
 
-	/* Hyperparameter that weighs exploration vs taking the best actions. */
-	double c_b;
-	/* Hyperparameter that determines how quickly RAVE values are down-weighted as the number of samples increases. */
-	double c_rave;
-	/* Hyperparameter that determines how much weight to give the NN apprentice recommendation. */
-	double w_a;
+	/* The number of times this node has been visited during MCTS. */
+	uint32_t num_node_visits; // n(s)
+	/* The number of times each edge has been taken from this state during MCTS. */
+	uint32_t* num_edge_traversals; // n(s,a)
+	/* The total reward over all simulation in which each edge was taken from this state during MCTS. */
+	float* edge_rewards; // r(s, a)
 
 
-	/* If true, sample actions with softmax probabilities, if false, choose action with highest score. */
-	bool sample_actions;
-	/* Specifies whether an NN apprentice is needed when determining which action to take during MCTS. */
-	bool requires_nn;
-	/* Specifies whether to use Rapid Value Estimation (RAVE) when computing action scores. */
-	bool use_rave;
+	/* The same statistics as above, but using the Rapid Value Estimation formula (RAVE).  The arrays are NULL unless the tree uses RAVE. */
+	uint32_t num_node_visits_rave; // n(s)-rave
+	uint32_t* num_edge_traversals_rave; // n(s,a)-rave
+	float* edge_rewards_rave; // r(s,a)-rave
 
 
 
@@ -497,17 +717,42 @@ N_rave(S_ti) = sum_a N_rav(S_ti, a), for all t_i
 
 /**
  * This function takes in a terminal node which represents a terminal state that marked the end of a simulation.
- * It performs stats updates at every node, starting from this one, following the path up to the root of the tree.
+ * It performs stats updates at every node on the simulation's path (PATH, or the tree's path if NULL, see MCTS_Node::getPath),
+ * from the bottom up to the root of the tree, emptying the path.
  * if this->use_rave, RAVE updates are performed in addition to regular updates.
  * Finally returns the root node.
  */
-MCTS_Node* propagateStats(MCTS_Node* node);
+MCTS_Node* propagateStats(MCTS_Node* node, vector<PathStep>* path=NULL);
 
 /**
- * Starts at the given node, and randomly selects actions, progressing down the tree till a terminal state is reached.
- * Returns the node for this terminal state.
+ * This function takes in a non-terminal leaf node, from which a rollout was simulated without making any nodes
+ * (see rolloutSimulation).  The rollout took ROLLOUT_ACTIONS, in order, and resulted in the (normalized) REWARD.
+ * Stats are updated at this node, then at every node on the simulation's path (PATH, or the tree's path if NULL) up to the root,
+ * exactly as if the rollout nodes had been made
+ * and propagateStats had been called on the terminal one. Finally returns the root node.
  */
-MCTS_Node* rolloutSimulation(MCTS_Node* node);
+MCTS_Node* propagateStats(MCTS_Node* node, double reward, const vector<int>& rollout_actions, vector<PathStep>* path=NULL);
+
+/**
+ * Like the above, for several rollouts from the same non-terminal leaf node, whose results are totalled in BATCH.
+ * This node's stats are updated once per rollout (each rollout took its own first action from it), but every node above it
+ * on the path is updated once, with the batch's total reward, counting a visit per rollout.
+ * The batch's RAVE actions are mapped in place into the frame of each node they are credited to.  Finally returns the root node.
+ */
+MCTS_Node* propagateStats(MCTS_Node* node, RolloutBatch* batch, vector<PathStep>* path=NULL);
+
+/**
+ * Plays a random game out from the given (non-terminal) node's state, without making any nodes, then propagates
+ * the stats from this node up the simulation's PATH (the tree's path if NULL) to the root.  Returns the root node.
+ *
+ * If the node uses fill rollouts, the game is played out by EnvState::fillRollout.  Otherwise, random actions are
+ * applied one at a time to a per-thread scratch copy of the state, so the tree (and memory) only grows with
+ * the nodes that tree search actually expands.
+ *
+ * If the tree plays several rollouts per leaf, they are all played out first, and their results are then propagated
+ * up the path together, so the cost of selection and propagation is shared between them.
+ */
+MCTS_Node* rolloutSimulation(MCTS_Node* node, vector<PathStep>* path=NULL);
 
 /**
  * Runs a simulation starting from the given node and continuing till a terminal state.
@@ -523,15 +768,57 @@ MCTS_Node* rolloutSimulation(MCTS_Node* node);
  */
 MCTS_Node* runMCTS(MCTS_Node* node, int max_depth, ActionDistribution* ad=NULL);
 
+/* A simulation of an N-MCTS tree that is waiting on the NN prior of NODE, along the PATH that led it there from the root. */
+struct PendingEvaluation {
+	MCTS_Node* node;
+	vector<PathStep> path;
+};
+
+/**
+ * Like runMCTS, but lets up to MAX_IN_FLIGHT simulations of ROOT's tree (which must require an NN) wait on NN priors at once,
+ * so that one tree can fill several rows of an inference batch.
+ *
+ * IN_FLIGHT holds the simulations that are waiting.  Those whose node has received its prior since the last call (set with
+ * setNNActionDistribution and marked with markReceivedNNResults) are resumed first, and each either finishes or stops
+ * at the next node that needs a prior.  Then new simulations are started until MAX_IN_FLIGHT of them are waiting,
+ * or every simulation of the root has been started.  The simulations spread out over the tree by virtual loss (as when
+ * several threads search it, see runAllSimulations), so the tree is kept concurrent while any of them are in flight.
+ * A simulation that reaches a node another one is already waiting on is abandoned (its virtual loss is taken back out),
+ * and no more are started until the next call.
+ *
+ * Returns the number of simulations left in IN_FLIGHT, each waiting on a different node, which the caller submits to the NN.
+ * Once every simulation has finished, this is 0, and (as with runMCTS) the tree below the root is freed.
+ */
+int runMCTSInFlight(MCTS_Node* root, int max_depth, int max_in_flight, vector<PendingEvaluation>* in_flight);
+
 /**
  * Runs all the simulations for the given node.
  * Each simulation goes until the given max_depth then performs rollout.
  * This function is only used when the tree does not require an NN, since there is no ActionDistribution passed.
  * Returns the root node, after having finished all the simulations.
  *
+ * If NUM_THREADS is more than 1, the threads (the calling one, and NUM_THREADS - 1 new ones) search the tree together,
+ * each running whole simulations, with its own path, until all of the simulations have been claimed.  Selection adds
+ * a virtual loss to each edge a thread is searching below, so that threads running at once spread out over the tree.
+ *
  * Errors is NODE is null, or if max_depth is not a positive number.
  */
-MCTS_Node* runAllSimulations(MCTS_Node* node, int max_depth=DEFAULT_MAX_DEPTH);
+MCTS_Node* runAllSimulations(MCTS_Node* node, int max_depth=DEFAULT_MAX_DEPTH, int num_threads=1);
+
+/**
+ * Root-parallel search: searches NUM_TREES independent trees of ROOT's position at once, one per thread, and merges their root stats.
+ * ROOT's own tree is searched by the calling thread, and each of the other NUM_TREES - 1 trees is a copy of ROOT (see copyRoot) that
+ * one new thread makes, searches and deletes.  The trees share no stats or locks, so the threads never contend, and each thread
+ * samples from its own random stream, so the trees differ.  Every tree runs all of its simulations, with NUM_THREADS_PER_TREE
+ * threads (see runAllSimulations).
+ *
+ * ACTION_COUNTS and MEAN_REWARDS are populated as getActionCounts and getMeanRewards would be, over all the trees at once:
+ * each action's count is the sum over the trees, and its mean reward is the total reward over the trees divided by that count.
+ * Returns ROOT, after its tree has been freed.
+ * Errors if ROOT is not a root node, if it requires an NN, or if NUM_TREES is not positive.
+ */
+MCTS_Node* runEnsembleSimulations(MCTS_Node* root, int num_trees, int max_depth, vector<int>* action_counts, vector<double>* mean_rewards,
+	int num_threads_per_tree=1);
 
 
 
@@ -124,7 +124,7 @@ MCTS_Thread_Manager::MCTS_Thread_Manager(vector<MCTS_Node*>* all_nodes, int num_
 	}
 
 	// for bookkeeping
-	num_script_invocations = 0;
+	num_nn_batches = 0;
  
 }
 
@@ -336,41 +336,40 @@ void MCTS_Thread_Manager::markNodeComplete(int node_num) {
 
 
 
-void MCTS_Thread_Manager::serializeNNQueue(int minibatch_num, string outfile) {
-	ofstream f (outfile);
-
-  	if (f.is_open()) {
-  		for (int state_num = minibatch_num * minibatch_size; state_num < (minibatch_num + 1) * minibatch_size; state_num++) {
-  			f << nnQueueGet(state_num)->asCSVString() << "\n";
-  		}
-    	f.close();
-  	}
-  	else {
-  		throw invalid_argument("In serializeNNQueue, Unable to open file " + outfile);
-  	}
-}
-
-
+void MCTS_Thread_Manager::evaluateNNQueue(int minibatch_num, EvaluatorClient* evaluator, int round) {
+	assertValidMinibatchNum(minibatch_num);
+	ASSERT(evaluator != NULL, "Cannot evaluate minibatch " << minibatch_num << " without an evaluator");
+	shared_data_mutex.lock();
+	num_nn_batches++;
+	shared_data_mutex.unlock();
 
-void MCTS_Thread_Manager::deserializeNNResults(int minibatch_num, string infile, int round) {
-	string line;
-	ifstream f (infile);
+	// pack the minibatch's state vectors into one contiguous batch of rows
+	vector<float> rows;
+	int row_size = 0;
+	for (int state_num = minibatch_num * minibatch_size; state_num < (minibatch_num + 1) * minibatch_size; state_num++) {
+		StateVector* state_vector = nnQueueGet(state_num);
+		if (rows.empty()) {
+			row_size = state_vector->size();
+			rows.reserve(minibatch_size * row_size);
+		}
+		ASSERT(state_vector->size() == row_size, "Every state vector in minibatch " << minibatch_num << " must have " << row_size << " values");
+		for (int k = 0; k < row_size; k++) {
+			rows.push_back(state_vector->at(k));
+		}
+	}
 
-	if (f.is_open()) {
-		vector<ActionDistribution*>* minibatch_nn_results = new vector<ActionDistribution*>(minibatch_size);
-		int state_num = 0;
-		while(getline(f, line)) {
-			minibatch_nn_results->at(state_num) = new ActionDistribution(this->num_actions, line);
-			state_num++;
-	    }
-	    f.close();
+	vector<float> outputs;
+	int num_outputs;
+	evaluator->evaluate(rows.data(), minibatch_size, row_size, &outputs, &num_outputs);
+	ASSERT(num_outputs == this->num_actions, "The evaluator gave " << num_outputs << " action probabilities, rather than " << this->num_actions);
 
-	    submitToNNResults(minibatch_nn_results, minibatch_num, round);
-	}
-	else {
-		throw invalid_argument("In deserializeNNResults, Unable to open file " + infile);
+	vector<ActionDistribution*>* minibatch_nn_results = new vector<ActionDistribution*>(minibatch_size);
+	for (int state_num = 0; state_num < minibatch_size; state_num++) {
+		const float* output = outputs.data() + state_num * num_outputs;
+		minibatch_nn_results->at(state_num) = new ActionDistribution(new vector<double>(output, output + num_outputs));
 	}
 
+	submitToNNResults(minibatch_nn_results, minibatch_num, round);
 }
 
 
@@ -399,55 +398,6 @@ void MCTS_Thread_Manager::registerThreadName(__thread_id tid, string thread_name
 	cout_mutex.unlock();
 }
 
-void MCTS_Thread_Manager::invokePythonScript(string script_file, string infile, string outfile) {
-	shared_data_mutex.lock();
-	num_script_invocations++;
-	shared_data_mutex.unlock();
-
-	char *command = (char *) "python";
-	char script_name[100]; strcpy(script_name, script_file.c_str());
-	char infile_arg[100]; strcpy(infile_arg, infile.c_str());
-	char outfile_arg[100]; strcpy(outfile_arg, outfile.c_str());
-    char *pythonArgs[]={command, script_name, infile_arg, outfile_arg, NULL};
-
-    pid_t pid = fork();
-
-    // if child process, do the exec
-    if (pid == 0) {
-    	execvp(command, pythonArgs);
-     }
-
-    // for the parent process, wait till the child completes
-    else {
-        waitpid(pid, NULL, 0);
-    }
-}
-
-void MCTS_Thread_Manager::invokeNNScript(string script_file, string state_vector_file, string model_dirname, string action_distribution_file) {
-	shared_data_mutex.lock();
-	num_script_invocations++;
-	shared_data_mutex.unlock();
-
-	char *command = (char *) "python";
-	char script_name[100]; strcpy(script_name, script_file.c_str());
-	char infile_arg[100]; strcpy(infile_arg, state_vector_file.c_str());
-	char modeldir_arg[200]; strcpy(modeldir_arg, model_dirname.c_str());
-	char outfile_arg[100]; strcpy(outfile_arg, action_distribution_file.c_str());
-    char *pythonArgs[]={command, script_name, infile_arg, modeldir_arg, outfile_arg, NULL};
-
-    pid_t pid = fork();
-
-    // if child process, do the exec
-    if (pid == 0) {
-    	execvp(command, pythonArgs);
-     }
-
-    // for the parent process, wait till the child completes
-    else {
-        waitpid(pid, NULL, 0);
-    }
-}
-
 
 
 
@@ -2,6 +2,7 @@
 #define MCTS_THREAD_MANAGER_H
 
 #include "mcts.h"
+#include "evaluator_socket.h"
 #include <vector>
 #include <map>
 #include <thread>
@@ -100,15 +101,13 @@ public:
 	
 
 
-	/* Called by the master thread.  Grabs the given minibatch from the nn_queue, converts each StateVector into a serializable format, and writes it to file. */
-	void serializeNNQueue(int minibatch_num, string outfile);
+	/* Called by the master thread.  Grabs the given minibatch from the nn_queue, runs its StateVectors through the evaluator process
+	 * behind EVALUATOR in a single batch, and writes the resulting ActionDistributions to the nn_results queue. */
+	void evaluateNNQueue(int minibatch_num, EvaluatorClient* evaluator, int round=0);
 
 	/* Called by the master thread at very end.  Grabs the given minibatch from the nodes vector, and writes each node to file. */
 	void writeNodesToFile(int minibatch_num, string outfile);
 
-	/* Called by the master thread.  Reads the given file, unpacks it into a vector of ActionDistributions, and writes these to the nn_results queue. */
-	void deserializeNNResults(int minibatch_num, string infile, int round=0);
-
 	
 	
 
@@ -132,13 +131,6 @@ public:
 
 	
 
-	
-
-	/* Calls the given Python script, passing the infile and outfile as args. */
-	void invokePythonScript(string script_file, string infile, string outfile);
-
-	/* Calls the given Python script, passing the input state vector file, the model dir, and the output action distribution file as args. */
-	void invokeNNScript(string script_file, string state_vector_file, string model_dirname, string action_distribution_file);
 
 
 
@@ -279,8 +271,8 @@ private:
 	// active_nodes_in_minibatch_per_thread[b][t] gives the number of active (not permanently finished) nodes that Thread T controls in minibatch B
 
 
-	/* For record-keeping, track the number of invocations to Python script. */
-	int num_script_invocations;
+	/* For record-keeping, track the number of minibatches sent to the evaluator. */
+	int num_nn_batches;
 
 };
 
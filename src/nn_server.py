@@ -0,0 +1,251 @@
+from utils import *
+from config import *
+
+import mmap
+import numpy as np
+import os
+import socket
+import struct
+import sys
+
+
+"""
+The evaluator process for run-mcts: loads the model once, then answers batches sent over a Unix domain socket.
+
+Every message starts with a header of three native-order uint32s, the first of which is its magic number.
+A request (magic, num_rows, row_size) is followed by num_rows * row_size native-order float32s, the state vectors, and is
+answered with a response with the same header, followed by one row of action probabilities per state vector.
+An attach message (magic, buffer_id, count) is followed by count bytes, the name of a shared memory segment holding a batch
+buffer, which is mapped for the rest of the connection.  A shared request (magic, buffer_id, count) runs the first count rows
+of that buffer in place.  Both are answered with a done message, which echoes the buffer ID and count.
+These must match src/evaluator_socket.h.
+"""
+REQUEST_MAGIC = 0x31514e45
+RESPONSE_MAGIC = 0x31534e45
+ATTACH_MAGIC = 0x31414e45
+SHARED_MAGIC = 0x31424e45
+SHARED_DONE_MAGIC = 0x31444e45
+HEADER = struct.Struct("=III")
+
+"""
+A batch buffer starts with a header of native-order uint32s (magic, capacity, num_inputs, 4 input sizes, output_size), and is
+followed by a float32 region for each input field, then one for the outputs, each starting on a fresh 64-byte cache line.
+This must match src/batch_buffer.h.
+"""
+BUFFER_MAGIC = 0x31424248
+BUFFER_HEADER = struct.Struct("=IIIIIIII")
+CACHE_LINE_SIZE = 64
+
+
+
+class NNModel(object):
+    """
+    Runs batches through a saved HexNN model, in a session that stays open for the life of the server.
+    """
+
+    def __init__(self, hex_dim, model_path):
+        import tensorflow as tf
+        from hex_nn import HexNN
+
+        self.nn = HexNN(hex_dim)
+        self.sess = tf.Session()
+        self.nn.restoreCheckpoint(self.sess, model_path)
+        self.nodes = self.nn.getFromCollection()
+
+
+    def evaluate(self, rows):
+        """
+        Returns the softmax outputs of the NN for the given (num_rows x row_size) array of state vectors.
+        """
+        feed_dict = self.nn.createFeedDict(self.nodes, x=rows)
+        return self.sess.run(self.nodes['output'], feed_dict)
+
+
+    def evaluateBuffer(self, buffer, num_rows):
+        """
+        Feeds the first NUM_ROWS rows of BUFFER's x planes and turn masks (as encoded by EnvState::encodeNNInput) to the NN,
+        and writes its softmax outputs to the buffer's outputs.
+        """
+        x, turn_mask = buffer.inputs[0][:num_rows], buffer.inputs[1][:num_rows]
+        padded_dim = int(round(np.sqrt(x.shape[1] // 2)))
+        feed_dict = {self.nodes['x']: x.reshape(num_rows, padded_dim, padded_dim, 2), self.nodes['turn_mask']: turn_mask}
+        buffer.outputs[:num_rows] = self.sess.run(self.nodes['output'], feed_dict)
+
+
+
+class StubModel(object):
+    """
+    A stand-in for the NN, for testing the protocol without TensorFlow (the same as StubRowEvaluator in src/evaluator_socket.h).
+    Action A of each state is weighted by 1 + the value at index A % row_size of its state vector.
+    """
+
+    def __init__(self, num_actions):
+        self.num_actions = num_actions
+
+
+    def evaluate(self, rows):
+        columns = np.arange(self.num_actions) % rows.shape[1]
+        weights = 1 + rows[:, columns]
+        return weights / weights.sum(axis=1, keepdims=True)
+
+
+    def evaluateBuffer(self, buffer, num_rows):
+        """
+        Evaluates each row as the state vector held in its first input field (like RowEvaluator::evaluateInPlace).
+        """
+        buffer.outputs[:num_rows] = self.evaluate(buffer.inputs[0][:num_rows])
+
+
+
+class SharedBuffer(object):
+    """
+    A batch buffer made by run-mcts, mapped from its shared memory segment.  INPUTS holds a (capacity x input_size) array
+    for each input field, and OUTPUTS a (capacity x output_size) array, all views of the shared memory itself.
+    """
+
+    def __init__(self, shm_name):
+        with open("/dev/shm" + shm_name, "r+b") as segment:
+            self.memory = mmap.mmap(segment.fileno(), 0)
+        header = BUFFER_HEADER.unpack_from(self.memory, 0)
+        magic, capacity, num_inputs = header[:3]
+        assert magic == BUFFER_MAGIC, shm_name + " is not a batch buffer"
+
+        region_sizes = [size * 4 for size in header[3:3 + num_inputs]] + [header[7] * 4]
+        offset = alignedToCacheLine(BUFFER_HEADER.size)
+        regions = []
+        for region_size in region_sizes:
+            regions.append(np.frombuffer(self.memory, dtype=np.float32, count=capacity * region_size // 4, offset=offset)
+                .reshape(capacity, region_size // 4))
+            offset += alignedToCacheLine(capacity * region_size)
+        self.capacity = capacity
+        self.inputs = regions[:-1]
+        self.outputs = regions[-1]
+
+
+
+def alignedToCacheLine(size):
+    """
+    Returns SIZE rounded up to a whole number of cache lines.
+    """
+    return (size + CACHE_LINE_SIZE - 1) // CACHE_LINE_SIZE * CACHE_LINE_SIZE
+
+
+
+def receiveAll(conn, size):
+    """
+    Returns exactly SIZE bytes read from CONN, or None if the client disconnects first.
+    """
+    chunks = []
+    while size > 0:
+        chunk = conn.recv(min(size, 1 << 20))
+        if not chunk:
+            return None
+        chunks.append(chunk)
+        size -= len(chunk)
+    return b"".join(chunks)
+
+
+
+def serveClient(model, conn):
+    """
+    Answers batches from the client on CONN until it disconnects.  Returns the number of batches answered.
+    """
+    num_batches = 0
+    buffers = {}
+    while True:
+        header = receiveAll(conn, HEADER.size)
+        if header is None:
+            return num_batches
+        magic, first, second = HEADER.unpack(header)
+
+        if magic == ATTACH_MAGIC:
+            shm_name = receiveAll(conn, second)
+            if shm_name is None:
+                return num_batches
+            buffers[first] = SharedBuffer(shm_name.decode("ascii"))
+            conn.sendall(HEADER.pack(SHARED_DONE_MAGIC, first, second))
+            continue
+
+        if magic == SHARED_MAGIC:
+            assert first in buffers, "The client asked for buffer " + str(first) + ", which it never attached"
+            if second > 0:
+                model.evaluateBuffer(buffers[first], second)
+            conn.sendall(HEADER.pack(SHARED_DONE_MAGIC, first, second))
+            num_batches += 1
+            continue
+
+        assert magic == REQUEST_MAGIC, "Expected a request, not a message starting with " + hex(magic)
+        num_rows, row_size = first, second
+        payload = receiveAll(conn, num_rows * row_size * 4)
+        if payload is None:
+            return num_batches
+        rows = np.frombuffer(payload, dtype=np.float32).reshape(num_rows, row_size)
+
+        outputs = np.ascontiguousarray(model.evaluate(rows), dtype=np.float32) if num_rows > 0 else np.zeros((0, 0), dtype=np.float32)
+        conn.sendall(HEADER.pack(RESPONSE_MAGIC, num_rows, outputs.shape[1]) + outputs.tobytes())
+        num_batches += 1
+
+
+
+def serve(model, socket_path):
+    """
+    Listens at SOCKET_PATH (replacing any stale socket file there), and serves one client at a time, forever.
+    """
+    if os.path.exists(socket_path):
+        os.remove(socket_path)
+    server = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    server.bind(socket_path)
+    server.listen(16)
+    writeLog("Evaluator listening on " + socket_path)
+
+    while True:
+        conn, _ = server.accept()
+        num_batches = serveClient(model, conn)
+        conn.close()
+        writeLog("Evaluator answered " + str(num_batches) + " batches for a client")
+
+
+
+def main():
+    """
+    Usage:
+
+    python src/nn_server.py \
+    --socket_path <the Unix socket to listen on, which run-mcts is given as --evaluator_socket> [required] \
+    --hex_dim <dimension of hex game> [optional; defaults to 5] \
+    --model_path <the path at which the saved model is stored> [required unless stub is True] \
+    --stub <serve a stub model instead of the NN, to test without TensorFlow> [optional; defaults to False] \
+
+
+    Example:
+
+    python src/nn_server.py \
+    --socket_path /tmp/hexit_evaluator.sock \
+    --hex_dim 5 \
+    --model_path models/hex/5/best_model/ \
+
+    """
+
+    arg_map = parseArgs(sys.argv[1:])
+
+    socket_path = arg_map.getString("socket_path", required=True)
+
+    hex_dim = arg_map.getInt("hex_dim", default_val=DEFAULT_HEX_DIM)
+
+    stub = arg_map.getBoolean("stub", default_val=False)
+
+    if stub:
+        model = StubModel(hex_dim * hex_dim)
+    else:
+        # Turn off tensorflow warnings
+        os.environ['TF_CPP_MIN_LOG_LEVEL'] = '3'
+        model = NNModel(hex_dim, arg_map.getString("model_path", required=True))
+
+    serve(model, socket_path)
+
+
+
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,108 @@
+#include "node_arena.h"
+#include "utils.h"
+
+#include <stdint.h> // uintptr_t
+
+using namespace std;
+
+
+NodeArena::NodeArena(size_t chunk_size) {
+	ASSERT(chunk_size > 0, "Arena chunk size must be positive");
+	this->_chunk_size = chunk_size;
+	this->_current_chunk = -1;
+	this->_offset = 0;
+	this->_bytes_used = 0;
+	this->_high_water = 0;
+}
+
+NodeArena::~NodeArena() {
+	this->release();
+}
+
+void* NodeArena::allocate(size_t num_bytes, size_t alignment) {
+
+	ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0, "Arena alignment must be a power of 2, not " << alignment);
+
+	// try the current chunk, then move on to any chunks kept from before the last reset
+	for (int chunk_num = this->_current_chunk; chunk_num >= 0 && chunk_num < this->_chunks.size(); chunk_num++) {
+		Chunk& chunk = this->_chunks[chunk_num];
+		size_t offset = (chunk_num == this->_current_chunk) ? this->_offset : 0;
+		uintptr_t address = (uintptr_t) (chunk.memory + offset);
+		size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+
+		if (offset + padding + num_bytes <= chunk.size) {
+			this->_current_chunk = chunk_num;
+			this->_offset = offset + padding + num_bytes;
+			this->_bytes_used += padding + num_bytes;
+			if (this->_bytes_used > this->_high_water) {
+				this->_high_water = this->_bytes_used;
+			}
+			return chunk.memory + offset + padding;
+		}
+	}
+
+	// nothing fits, so add a new chunk (big enough for this request) and bump out of it
+	Chunk chunk;
+	chunk.size = this->_chunk_size;
+	if (num_bytes + alignment > chunk.size) {
+		chunk.size = num_bytes + alignment;
+	}
+	chunk.memory = new char[chunk.size];
+	this->_chunks.push_back(chunk);
+	this->_current_chunk = this->_chunks.size() - 1;
+	this->_offset = 0;
+	return this->allocate(num_bytes, alignment);
+}
+
+void NodeArena::reserve(size_t num_bytes) {
+	size_t total_capacity = this->capacity();
+	if (total_capacity >= num_bytes) {
+		return;
+	}
+
+	Chunk chunk;
+	chunk.size = num_bytes - total_capacity;
+	if (chunk.size < this->_chunk_size) {
+		chunk.size = this->_chunk_size;
+	}
+	chunk.memory = new char[chunk.size];
+	this->_chunks.push_back(chunk);
+	if (this->_current_chunk == -1) {
+		this->_current_chunk = 0;
+		this->_offset = 0;
+	}
+}
+
+void NodeArena::reset() {
+	this->_current_chunk = this->_chunks.empty() ? -1 : 0;
+	this->_offset = 0;
+	this->_bytes_used = 0;
+}
+
+void NodeArena::release() {
+	for (Chunk& chunk : this->_chunks) {
+		delete[] chunk.memory;
+	}
+	this->_chunks.clear();
+	this->reset();
+}
+
+size_t NodeArena::capacity() const {
+	size_t total_capacity = 0;
+	for (const Chunk& chunk : this->_chunks) {
+		total_capacity += chunk.size;
+	}
+	return total_capacity;
+}
+
+size_t NodeArena::bytesUsed() const {
+	return this->_bytes_used;
+}
+
+size_t NodeArena::highWater() const {
+	return this->_high_water;
+}
+
+int NodeArena::numChunks() const {
+	return this->_chunks.size();
+}
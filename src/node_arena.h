@@ -0,0 +1,96 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include "config.h"
+
+#include <stddef.h> // size_t, max_align_t
+#include <string.h> // memset
+#include <vector>
+
+using namespace std;
+
+
+/**
+ * A bump allocator for everything below the root of one MCTS tree: the nodes, their stats arrays and their states.
+ *
+ * Memory is handed out from large chunks, by bumping an offset.  Nothing is ever freed individually:
+ * reset() makes all of the memory available again (keeping the chunks around for reuse), and release() returns
+ * the chunks to the system.  Both cost O(number of chunks), no matter how many nodes the tree has.
+ * Because of this, objects placed in an arena must not rely on their destructors being run.
+ *
+ * An arena is not thread-safe.  Each tree owns its own arena, so worker threads do not contend on malloc while growing
+ * their trees; when several threads search one tree, they only allocate while holding the root's expansion lock.
+ */
+class NodeArena {
+
+public:
+
+	/* Creates an empty arena, which will allocate chunks of (at least) CHUNK_SIZE bytes as it needs them. */
+	NodeArena(size_t chunk_size=DEFAULT_ARENA_CHUNK_SIZE);
+
+	/* Frees all the chunks. */
+	~NodeArena();
+
+	/**
+	 * Returns NUM_BYTES of uninitialized memory, aligned to ALIGNMENT (which must be a power of 2).
+	 * A new chunk is only allocated if the request does not fit in any of the remaining chunks.
+	 */
+	void* allocate(size_t num_bytes, size_t alignment=alignof(max_align_t));
+
+	/* Returns a zero-initialized array of N elements of type T.  T must be a type that is fine to zero with memset. */
+	template <typename T>
+	T* allocateArray(int n);
+
+	/* Makes sure the arena has at least NUM_BYTES of capacity, so the tree can be sized up front. */
+	void reserve(size_t num_bytes);
+
+	/* Makes all the memory handed out so far available again, keeping the chunks.  Everything allocated before is invalid. */
+	void reset();
+
+	/* Like reset, but also frees all the chunks. */
+	void release();
+
+	/* Returns the total number of bytes in the arena's chunks. */
+	size_t capacity() const;
+
+	/* Returns the number of bytes handed out (including alignment padding) since the last reset or release. */
+	size_t bytesUsed() const;
+
+	/* Returns the largest bytesUsed() that this arena has ever reached.  This survives reset and release. */
+	size_t highWater() const;
+
+	/* Returns the number of chunks the arena currently holds. */
+	int numChunks() const;
+
+private:
+
+	/* A block of memory that allocations are bumped out of. */
+	struct Chunk {
+		char* memory;
+		size_t size;
+	};
+
+	vector<Chunk> _chunks;
+	int _current_chunk; // index of the chunk being bumped out of (-1 if there are no chunks)
+	size_t _offset; // offset of the first free byte in the current chunk
+	size_t _chunk_size;
+	size_t _bytes_used;
+	size_t _high_water;
+
+};
+
+
+
+/***** Inline definitions *****/
+
+template <typename T>
+inline T* NodeArena::allocateArray(int n) {
+	size_t num_bytes = n * sizeof(T);
+	T* array = (T*) this->allocate(num_bytes, alignof(T));
+	memset(array, 0, num_bytes);
+	return array;
+}
+
+
+
+#endif
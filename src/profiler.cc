@@ -0,0 +1,170 @@
+#include "profiler.h"
+#include "utils.h"
+
+#include <fstream>
+#include <thread> // sleep_for
+#include <math.h> // ldexp
+#include <iomanip> // setw, setprecision
+
+using namespace std;
+
+
+Profiler profiler;
+bool profiler_on = DEFAULT_PROFILE;
+
+
+/* The names of the blocks, in the order of the ProfileBlock enum. */
+#define PROFILE_BLOCK_NAME(id, name) name,
+static const char* PROFILE_BLOCK_NAMES[NUM_PROFILE_BLOCKS] = {
+	PROFILE_BLOCKS(PROFILE_BLOCK_NAME)
+};
+#undef PROFILE_BLOCK_NAME
+
+
+/**
+ * The time stamp counter and the monotonic clock, read together at startup.
+ * Comparing how far each has moved since then gives the tick rate.
+ */
+static const uint64_t START_TICKS = profileTicks();
+static const chrono::steady_clock::time_point START_TIME = chrono::steady_clock::now();
+
+
+ProfileCounters::ProfileCounters() {
+	for (int block = 0; block < NUM_PROFILE_BLOCKS; block++) {
+		this->counts[block] = 0;
+		this->total_ticks[block] = 0;
+		this->self_ticks[block] = 0;
+		for (int bucket = 0; bucket < PROFILE_NUM_BUCKETS; bucket++) {
+			this->histogram[block][bucket] = 0;
+		}
+	}
+}
+
+void ProfileCounters::add(const ProfileCounters& other) {
+	for (int block = 0; block < NUM_PROFILE_BLOCKS; block++) {
+		addToCounter(this->counts[block], other.counts[block].load(memory_order_relaxed));
+		addToCounter(this->total_ticks[block], other.total_ticks[block].load(memory_order_relaxed));
+		addToCounter(this->self_ticks[block], other.self_ticks[block].load(memory_order_relaxed));
+		for (int bucket = 0; bucket < PROFILE_NUM_BUCKETS; bucket++) {
+			addToCounter(this->histogram[block][bucket], other.histogram[block][bucket].load(memory_order_relaxed));
+		}
+	}
+}
+
+
+
+ThreadProfile::ThreadProfile() {
+	this->current_scope = NULL;
+	lock_guard<mutex> lock(profiler._mutex);
+	profiler._running.push_back(this);
+}
+
+ThreadProfile::~ThreadProfile() {
+	lock_guard<mutex> lock(profiler._mutex);
+	profiler._exited.add(this->counters);
+	for (int i = 0; i < profiler._running.size(); i++) {
+		if (profiler._running[i] == this) {
+			profiler._running.erase(profiler._running.begin() + i);
+			break;
+		}
+	}
+}
+
+
+
+uint64_t Profiler::count(ProfileBlock block) {
+	ProfileCounters* totals = new ProfileCounters();
+	this->collect(totals);
+	uint64_t block_count = totals->counts[block];
+	delete totals;
+	return block_count;
+}
+
+const char* Profiler::blockName(ProfileBlock block) {
+	ASSERT(0 <= block && block < NUM_PROFILE_BLOCKS, "No profile block " << block);
+	return PROFILE_BLOCK_NAMES[block];
+}
+
+void Profiler::collect(ProfileCounters* totals) {
+	lock_guard<mutex> lock(this->_mutex);
+	totals->add(this->_exited);
+	for (ThreadProfile* running : this->_running) {
+		totals->add(running->counters);
+	}
+}
+
+double profileTicksPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+	// sleep a little if we are asked right after startup, so the rate is measured over a reasonable interval
+	while (chrono::steady_clock::now() - START_TIME < chrono::milliseconds(10)) {
+		this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	uint64_t ticks = profileTicks() - START_TICKS;
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - START_TIME).count();
+	return ticks / seconds;
+#else
+	return 1e9;
+#endif
+}
+
+/**
+ * Returns the number of ticks that the given fraction of calls took at most, using the histogram of one block.
+ * Within a bucket, the calls are taken to be spread evenly.
+ */
+static double histogramPercentile(const atomic<uint64_t>* histogram, uint64_t num_calls, double fraction) {
+	double target = fraction * num_calls;
+	double seen = 0;
+	for (int bucket = 0; bucket < PROFILE_NUM_BUCKETS; bucket++) {
+		double in_bucket = histogram[bucket].load(memory_order_relaxed);
+		if (in_bucket > 0 && seen + in_bucket >= target) {
+			// the bucket covers [low, high) ticks (see profileBucket)
+			double low, high;
+			if (bucket < PROFILE_SUB_BUCKETS) {
+				low = bucket;
+				high = bucket + 1;
+			} else {
+				int exponent = bucket / PROFILE_SUB_BUCKETS + 1;
+				int sub_bucket = bucket % PROFILE_SUB_BUCKETS;
+				low = ldexp(PROFILE_SUB_BUCKETS + sub_bucket, exponent - 2);
+				high = ldexp(PROFILE_SUB_BUCKETS + sub_bucket + 1, exponent - 2);
+			}
+			return low + (high - low) * ((target - seen) / in_bucket);
+		}
+		seen += in_bucket;
+	}
+	return 0;
+}
+
+void Profiler::report(ostream& out) {
+	ProfileCounters* totals = new ProfileCounters();
+	this->collect(totals);
+	double ns_per_tick = 1e9 / profileTicksPerSecond();
+
+	out << left << setw(20) << "block" << right << setw(12) << "calls" << setw(12) << "total_ms" << setw(12) << "self_ms"
+		<< setw(14) << "mean_ns" << setw(14) << "p50_ns" << setw(14) << "p90_ns" << setw(14) << "p99_ns" << "\n";
+	out << fixed << setprecision(1);
+	for (int block = 0; block < NUM_PROFILE_BLOCKS; block++) {
+		uint64_t num_calls = totals->counts[block];
+		if (num_calls == 0) {
+			continue;
+		}
+		double total_ns = totals->total_ticks[block] * ns_per_tick;
+		double self_ns = totals->self_ticks[block] * ns_per_tick;
+		out << left << setw(20) << PROFILE_BLOCK_NAMES[block] << right << setw(12) << num_calls
+			<< setw(12) << total_ns / 1e6 << setw(12) << self_ns / 1e6 << setw(14) << total_ns / num_calls;
+		double percentiles[3] = {0.5, 0.9, 0.99};
+		for (double fraction : percentiles) {
+			out << setw(14) << histogramPercentile(totals->histogram[block], num_calls, fraction) * ns_per_tick;
+		}
+		out << "\n";
+	}
+	delete totals;
+}
+
+void Profiler::log(string file_name) {
+	if (!profiler_on) return;
+	ofstream log_file (file_name);
+	ASSERT(log_file.is_open(), "Unable to open file " << file_name);
+	this->report(log_file);
+	log_file.close();
+}
@@ -0,0 +1,236 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#endif
+
+using namespace std;
+
+
+/**
+ * The blocks of code that can be profiled.  To profile a new block, add it here, and open a PROFILE_SCOPE in it.
+ * Each entry is X(ID, name): the ID is used in code (as PROFILE_ID), and the name is used in the report.
+ * Since the IDs are interned at compile time, entering a block costs no string hashing or map lookups.
+ */
+#define PROFILE_BLOCKS(X) \
+	X(RUN_MCTS, "runMCTS") \
+	X(CHOOSE_BEST_ACTION, "chooseBestAction") \
+	X(PROPAGATE_STATS, "propagateStats") \
+	X(UPDATE_STATS, "updateStats") \
+	X(UPDATE_STATS_RAVE, "updateStatsRave") \
+	X(ROLLOUT_SIMULATION, "rolloutSimulation") \
+	X(MAKE_BATCH_ACTIONS, "makeBatchActions")
+
+#define PROFILE_BLOCK_ENUM(id, name) PROFILE_##id,
+enum ProfileBlock {
+	PROFILE_BLOCKS(PROFILE_BLOCK_ENUM)
+	NUM_PROFILE_BLOCKS
+};
+#undef PROFILE_BLOCK_ENUM
+
+/**
+ * Scope latencies are kept in a histogram with PROFILE_SUB_BUCKETS buckets per power of 2 (of clock ticks),
+ * so the percentiles in the report are accurate to within 1 / PROFILE_SUB_BUCKETS.
+ */
+const int PROFILE_SUB_BUCKETS = 4;
+const int PROFILE_NUM_BUCKETS = 64 * PROFILE_SUB_BUCKETS;
+
+
+/* Whether profile scopes record anything (set from the "profile" option).  Scopes cost a single branch when it is off. */
+extern bool profiler_on;
+
+
+/**
+ * Counters for every block.  Each thread has its own, and only the owning thread writes them, so there are no locks or
+ * atomic read-modify-writes on the hot path; the counters are atomics only so the report can read them while the thread runs.
+ */
+struct ProfileCounters {
+
+	/* Number of times each block was entered. */
+	atomic<uint64_t> counts[NUM_PROFILE_BLOCKS];
+	/* Total ticks spent in each block, including the blocks nested inside it. */
+	atomic<uint64_t> total_ticks[NUM_PROFILE_BLOCKS];
+	/* Ticks spent in each block itself, excluding the blocks nested inside it. */
+	atomic<uint64_t> self_ticks[NUM_PROFILE_BLOCKS];
+	/* Histogram of the total ticks of each call of each block. */
+	atomic<uint64_t> histogram[NUM_PROFILE_BLOCKS][PROFILE_NUM_BUCKETS];
+
+	/* Creates zeroed counters. */
+	ProfileCounters();
+
+	/* Adds OTHER's counters to these. */
+	void add(const ProfileCounters& other);
+
+};
+
+
+/* One thread's counters, and its stack of open scopes. */
+struct ThreadProfile {
+
+	ProfileCounters counters;
+
+	/* The innermost open scope on this thread (NULL if there is none). */
+	class ProfileScope* current_scope;
+
+	/* Creates zeroed counters, and registers them with the profiler. */
+	ThreadProfile();
+
+	/* Merges the counters into the profiler's totals, when the thread exits. */
+	~ThreadProfile();
+
+};
+
+
+/**
+ * Times the enclosing scope as the given block, from construction to destruction.
+ * Scopes nest (and may re-enter the same block, as with recursion): each one is timed on its own, and the time
+ * spent in nested scopes is subtracted from the self time of the scope around them.
+ * Use it through PROFILE_SCOPE, rather than directly.
+ */
+class ProfileScope {
+
+public:
+
+	ProfileScope(ProfileBlock block);
+
+	~ProfileScope();
+
+private:
+
+	ProfileBlock _block;
+	uint64_t _start;
+	uint64_t _child_ticks; // total ticks of the scopes nested directly inside this one
+	ProfileScope* _parent;
+	ThreadProfile* _profile; // NULL if the profiler was off when the scope was opened
+
+};
+
+/* Profiles the rest of the enclosing scope as the block PROFILE_<ID>. */
+#define PROFILE_SCOPE(id) ProfileScope profile_scope_##id(PROFILE_##id)
+
+
+/**
+ * Collects the counters of every thread, and reports on them.
+ * Threads that have exited are merged into running totals; threads that are still running are read in place.
+ */
+class Profiler {
+
+public:
+
+	/* Writes the report to the given file.  Does nothing if the profiler is off. */
+	void log(string file_name);
+
+	/**
+	 * Writes a report with a line per block that was entered: the number of calls, total and self time,
+	 * and the mean, 50th, 90th and 99th percentile time per call.
+	 */
+	void report(ostream& out);
+
+	/* Returns the number of times the given block has been entered, over all threads. */
+	uint64_t count(ProfileBlock block);
+
+	/* Returns the name of the given block, as it appears in the report. */
+	static const char* blockName(ProfileBlock block);
+
+private:
+
+	friend struct ThreadProfile;
+
+	/* Adds up the counters of every thread (running or exited) into TOTALS. */
+	void collect(ProfileCounters* totals);
+
+	/* Guards the list of running threads, and the totals of exited ones. */
+	mutex _mutex;
+	vector<ThreadProfile*> _running;
+	ProfileCounters _exited;
+
+};
+
+extern Profiler profiler;
+
+
+/**
+ * Returns the current time in clock ticks.
+ * Uses the time stamp counter on x86 (a few nanoseconds to read, and constant-rate on any CPU from the last decade),
+ * and the monotonic clock elsewhere.  See profileTicksPerSecond to convert to seconds.
+ */
+uint64_t profileTicks();
+
+/* Returns the number of ticks of profileTicks per second (measured against the monotonic clock). */
+double profileTicksPerSecond();
+
+
+
+/***** Inline definitions *****/
+
+inline uint64_t profileTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/* Returns this thread's counters, creating them on first use. */
+inline ThreadProfile* threadProfile() {
+	thread_local ThreadProfile profile;
+	return &profile;
+}
+
+/* Adds VALUE to a counter that only this thread writes (a plain load and store, not an atomic add). */
+inline void addToCounter(atomic<uint64_t>& counter, uint64_t value) {
+	counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/* Returns the histogram bucket for a call that took TICKS. */
+inline int profileBucket(uint64_t ticks) {
+	if (ticks < PROFILE_SUB_BUCKETS) {
+		return ticks;
+	}
+	int exponent = 63 - __builtin_clzll(ticks);
+	int sub_bucket = (ticks >> (exponent - 2)) & (PROFILE_SUB_BUCKETS - 1);
+	return (exponent - 1) * PROFILE_SUB_BUCKETS + sub_bucket;
+}
+
+inline ProfileScope::ProfileScope(ProfileBlock block) {
+	if (!profiler_on) {
+		this->_profile = NULL;
+		return;
+	}
+	this->_block = block;
+	this->_child_ticks = 0;
+	this->_profile = threadProfile();
+	this->_parent = this->_profile->current_scope;
+	this->_profile->current_scope = this;
+	this->_start = profileTicks();
+}
+
+inline ProfileScope::~ProfileScope() {
+	if (this->_profile == NULL) {
+		return;
+	}
+	uint64_t elapsed = profileTicks() - this->_start;
+	ProfileCounters& counters = this->_profile->counters;
+	addToCounter(counters.counts[this->_block], 1);
+	addToCounter(counters.total_ticks[this->_block], elapsed);
+	addToCounter(counters.self_ticks[this->_block], elapsed - this->_child_ticks);
+	addToCounter(counters.histogram[this->_block][profileBucket(elapsed)], 1);
+
+	this->_profile->current_scope = this->_parent;
+	if (this->_parent != NULL) {
+		this->_parent->_child_ticks += elapsed;
+	}
+}
+
+
+
+#endif
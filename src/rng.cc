@@ -0,0 +1,75 @@
+#include "rng.h"
+
+#include <mutex>
+#include <random>
+
+using namespace std;
+
+
+Rng::Rng(uint64_t seed) {
+	// zobristMix is the splitmix64 finalizer, so these are the first four outputs of splitmix64 seeded with SEED
+	for (int i = 0; i < 4; i++) {
+		this->_state[i] = zobristMix(seed + i * 0x9E3779B97F4A7C15ULL);
+	}
+}
+
+void Rng::jump() {
+	static const uint64_t JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+
+	uint64_t jumped[4] = {0, 0, 0, 0};
+	for (int word = 0; word < 4; word++) {
+		for (int bit = 0; bit < 64; bit++) {
+			if (JUMP[word] & (1ULL << bit)) {
+				for (int i = 0; i < 4; i++) {
+					jumped[i] ^= this->_state[i];
+				}
+			}
+			this->next();
+		}
+	}
+	for (int i = 0; i < 4; i++) {
+		this->_state[i] = jumped[i];
+	}
+}
+
+Rng Rng::split() {
+	Rng child = *this;
+	this->jump();
+	return child;
+}
+
+
+/* The run's generator, which threads without a stream of their own split theirs off from (under the mutex). */
+static mutex run_rng_mutex;
+
+static Rng& runRng() {
+	static Rng run_rng(((uint64_t) random_device{}() << 32) ^ random_device{}());
+	return run_rng;
+}
+
+/* A thread's generator, split off from the run's when the thread first draws a number. */
+struct ThreadRng {
+	Rng rng;
+
+	ThreadRng() {
+		lock_guard<mutex> lock(run_rng_mutex);
+		this->rng = runRng().split();
+	}
+};
+
+void seedRng(uint64_t seed) {
+	// the calling thread's generator must exist before the lock is taken, since making it takes the lock too
+	Rng& rng = threadRng();
+	lock_guard<mutex> lock(run_rng_mutex);
+	runRng() = Rng(seed);
+	rng = runRng().split();
+}
+
+Rng& threadRng() {
+	thread_local ThreadRng thread_rng;
+	return thread_rng.rng;
+}
+
+void setThreadRng(const Rng& rng) {
+	threadRng() = rng;
+}
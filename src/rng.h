@@ -0,0 +1,102 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include "zobrist.h"
+
+#include <stdint.h>
+
+using namespace std;
+
+
+/**
+ * A fast pseudorandom number generator (xoshiro256**): four words of state, and a few shifts, rotates and multiplies per number.
+ *
+ * Every thread has its own generator (see threadRng), so drawing a number takes no lock, unlike the global rand().
+ * Generators are splittable: jump() skips 2^128 numbers ahead, so split() can hand a new thread a stream of its own
+ * that will never overlap the parent's.  Threads that are started with a stream split off from their parent's generator
+ * draw the same numbers in every run with the same seed (see seedRng) and the same number of threads.
+ *
+ * The small, hot methods are defined inline at the bottom of this header, since they run on every move of every rollout.
+ */
+class Rng {
+
+public:
+
+	/* Creates a generator from SEED.  The state is filled in by splitmix64, so nearby seeds give unrelated streams. */
+	Rng(uint64_t seed=0);
+
+	/* Returns a uniformly random 64-bit number. */
+	uint64_t next();
+
+	/**
+	 * Returns a uniformly random integer in [0, N), for a positive N.
+	 * Uses Lemire's multiply-shift rather than a modulo, which is biased by at most N / 2^64.
+	 */
+	uint32_t uniformInt(uint32_t n);
+
+	/* Returns a uniformly random double in [0, 1), with 53 random bits. */
+	double uniformDouble();
+
+	/* Advances the generator by 2^128 numbers, as if next() had been called that many times. */
+	void jump();
+
+	/**
+	 * Returns a generator that continues this one's stream, and jumps this one ahead to a new stream.
+	 * Neither will reach numbers the other draws, unless one of them draws 2^128 numbers.
+	 */
+	Rng split();
+
+private:
+
+	uint64_t _state[4];
+
+};
+
+
+/**
+ * Seeds the run: the calling thread's generator, and the generator that any threads started later without a stream
+ * of their own are split off from.  Called once at startup with the "seed" option, if it is given;
+ * otherwise the run is seeded from the system, so that every run differs.
+ */
+void seedRng(uint64_t seed);
+
+/**
+ * Returns the calling thread's generator.  A thread's generator is split off from the run's the first time it is used,
+ * unless the thread has been given a stream with setThreadRng.
+ */
+Rng& threadRng();
+
+/* Replaces the calling thread's generator with RNG (typically split off from the parent thread's generator before starting this one). */
+void setThreadRng(const Rng& rng);
+
+
+
+/***** Inline definitions *****/
+
+inline uint64_t rotateLeft(uint64_t x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+inline uint64_t Rng::next() {
+	uint64_t result = rotateLeft(this->_state[1] * 5, 7) * 9;
+	uint64_t t = this->_state[1] << 17;
+	this->_state[2] ^= this->_state[0];
+	this->_state[3] ^= this->_state[1];
+	this->_state[1] ^= this->_state[2];
+	this->_state[0] ^= this->_state[3];
+	this->_state[2] ^= t;
+	this->_state[3] = rotateLeft(this->_state[3], 45);
+	return result;
+}
+
+inline uint32_t Rng::uniformInt(uint32_t n) {
+	return (uint32_t) (((unsigned __int128) this->next() * n) >> 64);
+}
+
+inline double Rng::uniformDouble() {
+	return (this->next() >> 11) * 0x1.0p-53;
+}
+
+
+
+#endif
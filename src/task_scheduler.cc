@@ -0,0 +1,99 @@
+#include "task_scheduler.h"
+
+using namespace std;
+
+
+TaskScheduler::TaskScheduler(int num_workers, int num_tasks) {
+	ASSERT(num_workers > 0, "Must have a positive number of workers, not " << num_workers);
+	ASSERT(num_tasks >= 0, "Cannot schedule " << num_tasks << " tasks");
+	this->_num_workers = num_workers;
+	this->_num_tasks = num_tasks;
+	this->_num_stolen = 0;
+
+	// the first NUM_TASKS % NUM_WORKERS workers get one task more than the rest, so no task is left out
+	this->_queues = new WorkerQueue[num_workers];
+	int task = 0;
+	for (int worker = 0; worker < num_workers; worker++) {
+		int block_size = num_tasks / num_workers + ((worker < num_tasks % num_workers) ? 1 : 0);
+		for (int i = 0; i < block_size; i++) {
+			this->_queues[worker].tasks.push_back(task);
+			task++;
+		}
+	}
+}
+
+TaskScheduler::~TaskScheduler() {
+	delete[] this->_queues;
+}
+
+int TaskScheduler::nextTask(int worker) {
+	ASSERT(0 <= worker && worker < this->_num_workers, "There is no worker " << worker);
+	WorkerQueue& queue = this->_queues[worker];
+	while (true) {
+		{
+			lock_guard<mutex> lock(queue.lock);
+			if (!queue.tasks.empty()) {
+				int task = queue.tasks.front();
+				queue.tasks.pop_front();
+				return task;
+			}
+		}
+		// tasks are never added once the scheduler is made, so when nothing is left to steal, the work is all handed out
+		if (!this->steal(worker)) {
+			return -1;
+		}
+	}
+}
+
+bool TaskScheduler::steal(int worker) {
+
+	// pick the fullest victim.  the sizes are read one queue at a time, so the victim may have shrunk by the time it is locked
+	int victim = -1;
+	int victim_size = 0;
+	for (int other = 0; other < this->_num_workers; other++) {
+		if (other == worker) {
+			continue;
+		}
+		lock_guard<mutex> lock(this->_queues[other].lock);
+		int size = this->_queues[other].tasks.size();
+		if (size > victim_size) {
+			victim = other;
+			victim_size = size;
+		}
+	}
+	if (victim == -1) {
+		return false;
+	}
+
+	// take the back half, in order, then hand it over.  the two locks are never held at once, so workers cannot deadlock
+	deque<int> stolen;
+	{
+		lock_guard<mutex> lock(this->_queues[victim].lock);
+		deque<int>& tasks = this->_queues[victim].tasks;
+		int num_to_steal = (tasks.size() + 1) / 2;
+		for (int i = 0; i < num_to_steal; i++) {
+			stolen.push_front(tasks.back());
+			tasks.pop_back();
+		}
+	}
+	this->_num_stolen += stolen.size();
+
+	lock_guard<mutex> lock(this->_queues[worker].lock);
+	for (int task : stolen) {
+		this->_queues[worker].tasks.push_back(task);
+	}
+	// if the victim emptied its queue before it was locked, nothing was stolen, and nextTask simply looks again
+	return true;
+}
+
+int TaskScheduler::numWorkers() const {
+	return this->_num_workers;
+}
+
+int TaskScheduler::numTasks() const {
+	return this->_num_tasks;
+}
+
+int TaskScheduler::numStolen() const {
+	return this->_num_stolen;
+}
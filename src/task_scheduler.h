@@ -0,0 +1,70 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include "utils.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+using namespace std;
+
+
+/**
+ * Hands out tasks (numbered 0 to N - 1, such as the root states of a run) to a fixed set of worker threads, with work stealing.
+ *
+ * Each worker has a queue of its own, which starts out with a contiguous block of the tasks, and takes tasks from its front.
+ * A worker whose queue runs dry steals the back half of the fullest other queue (the tasks its owner would have reached last),
+ * so workers whose tasks happen to be cheap (such as roots that are nearly terminal) take over the rest of the work,
+ * and the run ends when the total work is done rather than when the slowest block is.
+ *
+ * Every queue has its own lock, on its own cache line, so workers only ever contend when one of them steals.
+ */
+class TaskScheduler {
+
+public:
+
+	/* Creates a scheduler for NUM_WORKERS workers, which deals tasks 0 to NUM_TASKS - 1 out in contiguous blocks of (nearly) equal size. */
+	TaskScheduler(int num_workers, int num_tasks);
+
+	~TaskScheduler();
+
+	/**
+	 * Returns the next task for WORKER (between 0 and the number of workers - 1): the front of its own queue,
+	 * or else one of the tasks it steals from another queue.  Returns -1 once every task has been handed out.
+	 */
+	int nextTask(int worker);
+
+	/* Returns the number of workers. */
+	int numWorkers() const;
+
+	/* Returns the number of tasks. */
+	int numTasks() const;
+
+	/* Returns the number of tasks that have been stolen (handed to a worker other than the one they were dealt to). */
+	int numStolen() const;
+
+private:
+
+	/* One worker's queue, aligned to its own cache lines so that workers do not share a line. */
+	struct alignas(CACHE_LINE_SIZE) WorkerQueue {
+		mutex lock;
+		deque<int> tasks;
+	};
+
+	/**
+	 * Moves the back half (rounding up) of the fullest queue other than WORKER's into WORKER's queue, and returns true.
+	 * Returns false if every other queue is empty.
+	 */
+	bool steal(int worker);
+
+	int _num_workers;
+	int _num_tasks;
+	WorkerQueue* _queues;
+	atomic<int> _num_stolen;
+
+};
+
+
+
+#endif
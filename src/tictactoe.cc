@@ -1,9 +1,10 @@
 #include <numeric>
 #include <math.h> // pow
-#include <stdlib.h> // srand, rand
+#include <stdlib.h> // exit
 #include <iostream>
 
 #include "tictactoe.h"
+#include "rng.h"
 
 using namespace std;
 
@@ -376,7 +377,7 @@ int Tictactoe::randomAction() {
 		printBoard();
 		exit(1);
 	}
-	int r = rand() % num_legal_moves;
+	int r = threadRng().uniformInt(num_legal_moves);
 	set<int>::const_iterator it(_legal_actions.begin());
 	advance(it, r);
 	return *it;
@@ -427,7 +428,7 @@ string Tictactoe::asCSVString() {
 
 Tictactoe* generateRandomTictactoeBoard() {
 	Tictactoe* board = new Tictactoe();
-	int total_num_moves = rand() % NUM_ACTIONS;
+	int total_num_moves = threadRng().uniformInt(NUM_ACTIONS);
 	int num_moves_made = 0;
 	while (!board->isTerminalState() && num_moves_made < total_num_moves) {
 		int action = board->randomAction();
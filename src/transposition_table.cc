@@ -0,0 +1,81 @@
+#include "transposition_table.h"
+#include "utils.h"
+
+using namespace std;
+
+
+TranspositionTable::TranspositionTable(int min_capacity) {
+	ASSERT(min_capacity > 0, "Transposition table capacity must be positive, not " << min_capacity);
+	this->_capacity = 1;
+	while (this->_capacity < min_capacity) {
+		this->_capacity *= 2;
+	}
+	this->_max_size = (this->_capacity / 4) * 3;
+	this->_entries = new Entry[this->_capacity];
+	this->clear();
+}
+
+TranspositionTable::~TranspositionTable() {
+	delete[] this->_entries;
+}
+
+uint64_t TranspositionTable::slotKey(uint64_t hash) {
+	return (hash == 0) ? 1 : hash;
+}
+
+MCTS_Node* TranspositionTable::lookup(uint64_t hash) const {
+	uint64_t key = slotKey(hash);
+	int mask = this->_capacity - 1;
+
+	// probe from the key's home slot until the key or an empty slot is found
+	for (int i = key & mask; ; i = (i + 1) & mask) {
+		uint64_t slot_key = this->_entries[i].key.load(memory_order_acquire);
+		if (slot_key == key) {
+			// NULL if the inserting thread has claimed the slot but not yet published the node
+			return this->_entries[i].node.load(memory_order_acquire);
+		}
+		if (slot_key == 0) {
+			return NULL;
+		}
+	}
+}
+
+bool TranspositionTable::insert(uint64_t hash, MCTS_Node* node) {
+	ASSERT(node != NULL, "Cannot insert a null node into a transposition table");
+	if (this->_size.load(memory_order_relaxed) >= this->_max_size) {
+		return false;
+	}
+
+	uint64_t key = slotKey(hash);
+	int mask = this->_capacity - 1;
+
+	// claim the first empty slot on the key's probe sequence, unless the key is already on it
+	for (int i = key & mask; ; i = (i + 1) & mask) {
+		uint64_t slot_key = 0;
+		if (this->_entries[i].key.compare_exchange_strong(slot_key, key, memory_order_acq_rel)) {
+			this->_entries[i].node.store(node, memory_order_release);
+			this->_size.fetch_add(1, memory_order_relaxed);
+			return true;
+		}
+		// the CAS failed, so SLOT_KEY now holds the key that was already in the slot
+		if (slot_key == key) {
+			return false;
+		}
+	}
+}
+
+void TranspositionTable::clear() {
+	for (int i = 0; i < this->_capacity; i++) {
+		this->_entries[i].key.store(0, memory_order_relaxed);
+		this->_entries[i].node.store(NULL, memory_order_relaxed);
+	}
+	this->_size.store(0, memory_order_relaxed);
+}
+
+int TranspositionTable::size() const {
+	return this->_size.load(memory_order_relaxed);
+}
+
+int TranspositionTable::capacity() const {
+	return this->_capacity;
+}
@@ -0,0 +1,70 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include <stdint.h>
+#include <atomic>
+
+using namespace std;
+
+class MCTS_Node;
+
+
+/**
+ * A table from position hashes (see EnvState::hash) to the MCTS nodes for those positions.
+ * When a search reaches a position it has already expanded through a different move order, it reuses that node
+ * (and with it the node's statistics and NN prior), so the tree becomes a directed acyclic graph.
+ *
+ * The table is a fixed-size, open-addressing hash table with linear probing.  It is lock-free: a slot is claimed by
+ * compare-and-swapping its key, then the node is published, so any number of threads can look up and insert at once.
+ * Entries are never removed one at a time (the nodes all live in one tree, and are freed together by clear()).
+ * Once the table is three quarters full, inserts fail, and the search simply stops sharing new positions.
+ */
+class TranspositionTable {
+
+public:
+
+	/* Creates an empty table with room for (at least) MIN_CAPACITY entries.  The capacity is rounded up to a power of 2. */
+	TranspositionTable(int min_capacity);
+
+	/* Frees the table (but not the nodes in it). */
+	~TranspositionTable();
+
+	/* Returns the node stored for the position with the given HASH, or NULL if there is none (yet). */
+	MCTS_Node* lookup(uint64_t hash) const;
+
+	/**
+	 * Stores NODE for the position with the given HASH, and returns true.
+	 * Returns false (and stores nothing) if there is already a node for that position, or the table is full.
+	 */
+	bool insert(uint64_t hash, MCTS_Node* node);
+
+	/* Removes every entry.  Must not be called while other threads use the table. */
+	void clear();
+
+	/* Returns the number of entries in the table. */
+	int size() const;
+
+	/* Returns the number of slots in the table. */
+	int capacity() const;
+
+private:
+
+	/* A slot of the table.  An empty slot has a key of 0 (hashes of 0 are stored as 1, see slotKey). */
+	struct Entry {
+		atomic<uint64_t> key;
+		atomic<MCTS_Node*> node;
+	};
+
+	/* Returns the key that HASH is stored under (never 0, which marks empty slots). */
+	static uint64_t slotKey(uint64_t hash);
+
+	Entry* _entries;
+	int _capacity;
+	int _max_size; // inserts fail once the table has this many entries
+	atomic<int> _size;
+
+};
+
+
+
+#endif
@@ -0,0 +1,259 @@
+#include "uct_kernel.h"
+#include "utils.h"
+
+#include <math.h> // log, sqrt, exp
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UCT_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+
+/**
+ * The AVX2 versions are compiled for AVX2 whatever the build flags are, and only called if the CPU supports it,
+ * so one binary uses AVX2 where it can and runs everywhere else.
+ */
+#ifdef UCT_KERNEL_X86
+#define UCT_KERNEL_AVX2 __attribute__((target("avx2")))
+
+static bool detectAVX2() {
+	// this runs during static initialization, which may be before the CPU features have been read
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static const bool USE_AVX2 = detectAVX2();
+#else
+static const bool USE_AVX2 = false;
+#endif
+
+
+bool uctKernelUsesAVX2() {
+	return USE_AVX2;
+}
+
+
+
+/***** Scalar kernels (also used for the tail of the AVX2 loops) *****/
+
+static void scoreUCTScalar(const EdgeStats& stats, int start, float log_visits, float turn, float c_b, float* scores) {
+	for (int e = start; e < stats.num_edges; e++) {
+		float n = (float) stats.visits[e];
+		float mean = (n == 0) ? 0.0f : (stats.rewards[e] * turn) / n;
+		scores[e] = mean + c_b * sqrtf(log_visits / (n + 1.0f));
+	}
+}
+
+static void blendScoresScalar(int start, int num_edges, float beta, const float* rave_scores, float* scores) {
+	for (int e = start; e < num_edges; e++) {
+		scores[e] = (beta * rave_scores[e]) + ((1.0f - beta) * scores[e]);
+	}
+}
+
+static void addPriorScoresScalar(int start, int num_edges, float w_a, const float* prior, const uint32_t* visits, float* scores) {
+	for (int e = start; e < num_edges; e++) {
+		scores[e] += w_a * (prior[e] / ((float) visits[e] + 1.0f));
+	}
+}
+
+static float maxScoreScalar(int start, int num_edges, const float* scores, float max_score) {
+	for (int e = start; e < num_edges; e++) {
+		if (scores[e] > max_score) {
+			max_score = scores[e];
+		}
+	}
+	return max_score;
+}
+
+
+
+/***** AVX2 kernels *****/
+
+#ifdef UCT_KERNEL_X86
+
+UCT_KERNEL_AVX2
+static void scoreUCTAVX2(const EdgeStats& stats, float log_visits, float turn, float c_b, float* scores) {
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 turn_v = _mm256_set1_ps(turn);
+	const __m256 c_b_v = _mm256_set1_ps(c_b);
+	const __m256 log_visits_v = _mm256_set1_ps(log_visits);
+
+	int e = 0;
+	for (; e + 8 <= stats.num_edges; e += 8) {
+		__m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (stats.visits + e)));
+		__m256 r = _mm256_loadu_ps(stats.rewards + e);
+
+		// the mean is garbage for unvisited edges (0 / 0), so mask it to 0
+		__m256 mean = _mm256_div_ps(_mm256_mul_ps(r, turn_v), n);
+		mean = _mm256_blendv_ps(mean, zero, _mm256_cmp_ps(n, zero, _CMP_EQ_OQ));
+
+		__m256 explore = _mm256_mul_ps(c_b_v, _mm256_sqrt_ps(_mm256_div_ps(log_visits_v, _mm256_add_ps(n, one))));
+		_mm256_storeu_ps(scores + e, _mm256_add_ps(mean, explore));
+	}
+	scoreUCTScalar(stats, e, log_visits, turn, c_b, scores);
+}
+
+UCT_KERNEL_AVX2
+static void blendScoresAVX2(int num_edges, float beta, const float* rave_scores, float* scores) {
+	const __m256 beta_v = _mm256_set1_ps(beta);
+	const __m256 one_minus_beta_v = _mm256_set1_ps(1.0f - beta);
+
+	int e = 0;
+	for (; e + 8 <= num_edges; e += 8) {
+		__m256 rave = _mm256_mul_ps(beta_v, _mm256_loadu_ps(rave_scores + e));
+		__m256 uct = _mm256_mul_ps(one_minus_beta_v, _mm256_loadu_ps(scores + e));
+		_mm256_storeu_ps(scores + e, _mm256_add_ps(rave, uct));
+	}
+	blendScoresScalar(e, num_edges, beta, rave_scores, scores);
+}
+
+UCT_KERNEL_AVX2
+static void addPriorScoresAVX2(int num_edges, float w_a, const float* prior, const uint32_t* visits, float* scores) {
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 w_a_v = _mm256_set1_ps(w_a);
+
+	int e = 0;
+	for (; e + 8 <= num_edges; e += 8) {
+		__m256 n = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*) (visits + e)));
+		__m256 term = _mm256_mul_ps(w_a_v, _mm256_div_ps(_mm256_loadu_ps(prior + e), _mm256_add_ps(n, one)));
+		_mm256_storeu_ps(scores + e, _mm256_add_ps(_mm256_loadu_ps(scores + e), term));
+	}
+	addPriorScoresScalar(e, num_edges, w_a, prior, visits, scores);
+}
+
+UCT_KERNEL_AVX2
+static float maxScoreAVX2(int num_edges, const float* scores) {
+	int e = 0;
+	float max_score = scores[0];
+	if (num_edges >= 8) {
+		__m256 max_v = _mm256_loadu_ps(scores);
+		for (e = 8; e + 8 <= num_edges; e += 8) {
+			max_v = _mm256_max_ps(max_v, _mm256_loadu_ps(scores + e));
+		}
+		// reduce the eight lanes to one
+		__m128 max_4 = _mm_max_ps(_mm256_castps256_ps128(max_v), _mm256_extractf128_ps(max_v, 1));
+		max_4 = _mm_max_ps(max_4, _mm_movehl_ps(max_4, max_4));
+		max_4 = _mm_max_ss(max_4, _mm_shuffle_ps(max_4, max_4, 1));
+		max_score = _mm_cvtss_f32(max_4);
+	}
+	return maxScoreScalar(e, num_edges, scores, max_score);
+}
+
+UCT_KERNEL_AVX2
+static int argmaxScoreAVX2(int num_edges, const float* scores) {
+	float max_score = maxScoreAVX2(num_edges, scores);
+
+	// find the first edge with the max score, eight at a time
+	const __m256 max_v = _mm256_set1_ps(max_score);
+	int e = 0;
+	for (; e + 8 <= num_edges; e += 8) {
+		int matches = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(scores + e), max_v, _CMP_EQ_OQ));
+		if (matches != 0) {
+			return e + __builtin_ctz(matches);
+		}
+	}
+	for (; e < num_edges; e++) {
+		if (scores[e] == max_score) {
+			return e;
+		}
+	}
+	return 0; // only reached if the scores are NaN
+}
+
+#endif
+
+
+
+/***** Dispatch *****/
+
+void scoreUCT(const EdgeStats& stats, float turn, float c_b, float* scores) {
+	if (stats.node_visits == 0) {
+		for (int e = 0; e < stats.num_edges; e++) {
+			scores[e] = 0.0f;
+		}
+		return;
+	}
+
+	float log_visits = (float) log((double) stats.node_visits);
+#ifdef UCT_KERNEL_X86
+	if (USE_AVX2) {
+		scoreUCTAVX2(stats, log_visits, turn, c_b, scores);
+		return;
+	}
+#endif
+	scoreUCTScalar(stats, 0, log_visits, turn, c_b, scores);
+}
+
+void blendScores(int num_edges, float beta, const float* rave_scores, float* scores) {
+#ifdef UCT_KERNEL_X86
+	if (USE_AVX2) {
+		blendScoresAVX2(num_edges, beta, rave_scores, scores);
+		return;
+	}
+#endif
+	blendScoresScalar(0, num_edges, beta, rave_scores, scores);
+}
+
+void addPriorScores(int num_edges, float w_a, const float* prior, const uint32_t* visits, float* scores) {
+#ifdef UCT_KERNEL_X86
+	if (USE_AVX2) {
+		addPriorScoresAVX2(num_edges, w_a, prior, visits, scores);
+		return;
+	}
+#endif
+	addPriorScoresScalar(0, num_edges, w_a, prior, visits, scores);
+}
+
+int argmaxScore(int num_edges, const float* scores) {
+	ASSERT(num_edges > 0, "Cannot take the argmax of " << num_edges << " scores");
+#ifdef UCT_KERNEL_X86
+	if (USE_AVX2) {
+		return argmaxScoreAVX2(num_edges, scores);
+	}
+#endif
+	int max_index = 0;
+	for (int e = 1; e < num_edges; e++) {
+		if (scores[e] > scores[max_index]) {
+			max_index = e;
+		}
+	}
+	return max_index;
+}
+
+int sampleSoftmaxScore(int num_edges, const float* scores, double uniform, float* weights) {
+	ASSERT(num_edges > 0, "Cannot sample from " << num_edges << " scores");
+
+	// subtracting the max score leaves the softmax unchanged, and keeps the powers from overflowing
+	float max_score;
+#ifdef UCT_KERNEL_X86
+	if (USE_AVX2) {
+		max_score = maxScoreAVX2(num_edges, scores);
+	} else {
+		max_score = maxScoreScalar(1, num_edges, scores, scores[0]);
+	}
+#else
+	max_score = maxScoreScalar(1, num_edges, scores, scores[0]);
+#endif
+
+	// base ^ (score - max) = exp((score - max) * log(base))
+	const float log_base = logf(UCT_SOFTMAX_BASE);
+	double total_weight = 0;
+	for (int e = 0; e < num_edges; e++) {
+		weights[e] = expf((scores[e] - max_score) * log_base);
+		total_weight += weights[e];
+	}
+
+	// the edge with the max score has a weight of 1, so the total is at least 1
+	double threshold = uniform * total_weight;
+	double accum_weight = 0;
+	for (int e = 0; e < num_edges; e++) {
+		accum_weight += weights[e];
+		if (threshold < accum_weight) {
+			return e;
+		}
+	}
+	return num_edges - 1; // only reached through rounding, when UNIFORM is very close to 1
+}
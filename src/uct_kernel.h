@@ -0,0 +1,64 @@
+#ifndef UCT_KERNEL_H
+#define UCT_KERNEL_H
+
+#include <stdint.h>
+
+using namespace std;
+
+
+/**
+ * The kernels that score a node's edges during MCTS selection, and pick an edge from those scores.
+ *
+ * Selection runs at every tree level of every simulation, so these work on the flat per-edge arrays that MCTS_Node keeps,
+ * write into caller-provided buffers (nothing is allocated), and only ever visit legal moves (a node only has edges for those).
+ * On CPUs with AVX2 (checked once, at startup) eight edges are scored at a time; otherwise a scalar loop computes the same values.
+ * See the note in mcts.h for the formulas.
+ */
+
+
+/* The base used by the softmax when sampling edges (see sampleSoftmaxScore). */
+const float UCT_SOFTMAX_BASE = 2.7;
+
+
+/* One node's edge statistics, as parallel arrays with one element per edge. */
+struct EdgeStats {
+	int num_edges;
+	/* n(s) */
+	uint32_t node_visits;
+	/* n(s,a) for each edge */
+	const uint32_t* visits;
+	/* r(s,a) for each edge */
+	const float* rewards;
+};
+
+
+/**
+ * Writes the UCT score of each edge into SCORES:
+ * scores[e] = turn * rewards[e] / visits[e] + c_b * sqrt(log(node_visits) / (visits[e] + 1)),
+ * where the mean reward term is 0 for edges that were never taken.  If the node was never visited, every score is 0.
+ * TURN (1 or -1) makes player 2 minimize the reward.
+ */
+void scoreUCT(const EdgeStats& stats, float turn, float c_b, float* scores);
+
+/* Sets scores[e] = beta * rave_scores[e] + (1 - beta) * scores[e], for each of the NUM_EDGES edges. */
+void blendScores(int num_edges, float beta, const float* rave_scores, float* scores);
+
+/* Adds the NN prior term to each of the NUM_EDGES scores: scores[e] += w_a * prior[e] / (visits[e] + 1). */
+void addPriorScores(int num_edges, float w_a, const float* prior, const uint32_t* visits, float* scores);
+
+/* Returns the index of the largest of the NUM_EDGES scores (the first one, if there are ties).  NUM_EDGES must be positive. */
+int argmaxScore(int num_edges, const float* scores);
+
+/**
+ * Samples an index with probability proportional to UCT_SOFTMAX_BASE ^ scores[e] (a softmax over the scores), and returns it.
+ * The softmax and the sampling are done in one go: the weights are written into WEIGHTS (which must have room for NUM_EDGES floats),
+ * then UNIFORM (a random number in [0, 1)) picks the index.  NUM_EDGES must be positive.
+ */
+int sampleSoftmaxScore(int num_edges, const float* scores, double uniform, float* weights);
+
+/* Returns true if the kernels use AVX2 on this CPU. */
+bool uctKernelUsesAVX2();
+
+
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include "bitboard.h"
+
+#include <stddef.h> // size_t, offsetof
+#include <stdint.h>
+
+using namespace std;
+
+
+/* Number of extra elements a UnionFind holds beyond the board cells (the four virtual board edges in Hex). */
+const int UNION_FIND_NUM_VIRTUAL = 4;
+
+/* The largest number of elements a UnionFind can hold. */
+const int UNION_FIND_CAPACITY = BITBOARD_MAX_CELLS + UNION_FIND_NUM_VIRTUAL;
+
+
+/**
+ * A disjoint-set forest over the elements 0 ... num_elements - 1, with union by rank and path halving,
+ * so find() and unite() run in near-constant (inverse Ackermann) time.
+ *
+ * The forest is stored in a fixed-size inline array (no heap memory), so a UnionFind is copied along with
+ * the state that owns it by a flat copy.  Only the first num_elements entries of the array are in use, and only those are
+ * copied and counted by sizeInBytes(), so an owner whose last member is its UnionFind can be cloned into memory sized for
+ * the elements it actually has (see HexState::sizeInBytes).  find() compresses paths as it goes, so it is not const.
+ *
+ * The small methods are defined inline at the bottom of this header, since they run on every move of every rollout.
+ */
+class UnionFind {
+
+public:
+
+	/* Creates a forest with no elements.  Call reset() before using it. */
+	UnionFind();
+
+	/* Copies OTHER's elements only, so the unused rest of the array is never read or written. */
+	UnionFind(const UnionFind& other);
+	UnionFind& operator=(const UnionFind& other);
+
+	/* Puts each of the elements 0 ... NUM_ELEMENTS - 1 into its own set. NUM_ELEMENTS may be at most UNION_FIND_CAPACITY. */
+	void reset(int num_elements);
+
+	/* Returns the representative element of the set containing element X. */
+	int find(int x);
+
+	/* Merges the sets containing elements A and B. */
+	void unite(int a, int b);
+
+	/* Returns true if elements A and B are in the same set. */
+	bool connected(int a, int b);
+
+	/* Returns the number of bytes of this forest that are in use, from its start through its last element. */
+	size_t sizeInBytes() const;
+
+private:
+
+	struct Element {
+		uint16_t parent;
+		uint8_t rank;
+	};
+
+	int _num_elements;
+	Element _elements[UNION_FIND_CAPACITY]; // only the first _num_elements are in use
+
+};
+
+
+
+/***** Inline definitions *****/
+
+inline UnionFind::UnionFind() {
+	this->_num_elements = 0;
+}
+
+inline UnionFind::UnionFind(const UnionFind& other) {
+	*this = other;
+}
+
+inline UnionFind& UnionFind::operator=(const UnionFind& other) {
+	this->_num_elements = other._num_elements;
+	for (int x = 0; x < other._num_elements; x++) {
+		this->_elements[x] = other._elements[x];
+	}
+	return *this;
+}
+
+inline void UnionFind::reset(int num_elements) {
+	this->_num_elements = num_elements;
+	for (int x = 0; x < num_elements; x++) {
+		this->_elements[x].parent = x;
+		this->_elements[x].rank = 0;
+	}
+}
+
+inline int UnionFind::find(int x) {
+	while (this->_elements[x].parent != x) {
+		// path halving: point x at its grandparent, then move up
+		this->_elements[x].parent = this->_elements[this->_elements[x].parent].parent;
+		x = this->_elements[x].parent;
+	}
+	return x;
+}
+
+inline void UnionFind::unite(int a, int b) {
+	int root_a = this->find(a);
+	int root_b = this->find(b);
+	if (root_a == root_b) {
+		return;
+	}
+
+	// attach the shallower tree under the deeper one
+	if (this->_elements[root_a].rank < this->_elements[root_b].rank) {
+		this->_elements[root_a].parent = root_b;
+	} else if (this->_elements[root_a].rank > this->_elements[root_b].rank) {
+		this->_elements[root_b].parent = root_a;
+	} else {
+		this->_elements[root_b].parent = root_a;
+		this->_elements[root_a].rank += 1;
+	}
+}
+
+inline bool UnionFind::connected(int a, int b) {
+	return this->find(a) == this->find(b);
+}
+
+inline size_t UnionFind::sizeInBytes() const {
+	return offsetof(UnionFind, _elements) + this->_num_elements * sizeof(Element);
+}
+
+
+
+#endif
@@ -1,4 +1,5 @@
 #include "utils.h"
+#include "rng.h"
 
 #include <random>
 #include <cfloat>       // std::numeric_limits
@@ -12,49 +13,6 @@
 using namespace std;
 
 
-/*** Profiler Class ****/
-Profiler profiler;
-bool profiler_on = false;
-
-void Profiler::start(string block_name) {
-	if (!profiler_on) return;
-	if (block_starts.count(block_name) > 0) {
-		return;
-	}
-	clock_t now = clock();
-	block_starts[block_name] = now;
-	block_counts[block_name] += 1;
-}
-
-void Profiler::stop(string block_name) {
-	if (!profiler_on) return;
-	ASSERT(block_starts.count(block_name) > 0, "Cannot stop block " << block_name << " that hasn't been started.");
-	clock_t now = clock();
-	clock_t elapsed = now - block_starts[block_name];
-	block_times[block_name] += elapsed;
-	block_starts.erase(block_name);
-}
-
-void Profiler::log(string file_name) {
-	if (!profiler_on) return;
-	ofstream log_file (file_name);
-	ASSERT(log_file.is_open(), "Unable to open file " << file_name);
-	for (auto block : block_times) {
-		string block_name = block.first;
-		clock_t block_time = block.second;
-		double elapsed_secs = double(block_time) / CLOCKS_PER_SEC;
-
-		int block_count = block_counts[block_name];
-		log_file << block_name << ": " << elapsed_secs << ", " << block_count << "\n";
-
-	}
-
-	log_file.close();
-
-}
-
-
-
 /**** ArgMap Class for Argument passing *****/
 
 ArgMap::ArgMap() {
@@ -345,11 +303,7 @@ string asCSVString(const vector<double>& vec) {
 
 
 double randomDouble(double lower_bound, double upper_bound) {
-	random_device rd;  //Will be used to obtain a seed for the random number engine
-	mt19937 rng(rd()); //Standard mersenne_twister_engine seeded with rd()
-	
-	uniform_real_distribution<> dist(lower_bound, upper_bound);
-	return dist(rng);
+	return lower_bound + (upper_bound - lower_bound) * threadRng().uniformDouble();
 }
 
 
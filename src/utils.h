@@ -9,6 +9,9 @@
 
 using namespace std;
 
+/* The size in bytes of a cache line.  Data written by different threads is kept on separate lines, so the threads don't falsely share them. */
+const int CACHE_LINE_SIZE = 64;
+
 /* ASSERT Macro. */
 
 #   define ASSERT(condition, message) \
@@ -44,35 +47,6 @@ using namespace std;
 extern map<string, time_t> function_times;
 extern map<string, int> function_counts;*/
 
-/* Class used to profile blocks of code, since no gprof on Mac. */
-
-class Profiler {
-public:
-
-	/* Marks entrance into a particular block of code, with the given name. */
-	void start(string block_name);
-
-	/* Marks the exit from a particular block of code with the given name, and calculates the time spent in that block. */
-	void stop(string block_name);
-
-	/* Logs the profile info to the given file. */
-	void log(string file_name);
-
-private:
-
-	/* Tracks the time at which blocks are entered. */
-	map<string, clock_t> block_starts; 
-
-	/* Tracks the total time spent in blocks. */
-	map<string, clock_t> block_times;
-
-	/* Number of times each block was run. */
-	map<string, int> block_counts;
-
-
-};
-
-extern Profiler profiler;
 
 /* Small class to read and store command line arguments. */
 
@@ -184,7 +158,7 @@ string asCSVString(const vector<double>& vec);
 
 /**** Other Assorted Utilities ****/
 
-/* Returns a double uniformly at random between the given bounds. */
+/* Returns a double uniformly at random between the given bounds (drawn from the calling thread's generator, see rng.h). */
 double randomDouble(double lower_bound, double upper_bound);
 
 /* Prints a vector of doubles in a human-readable format, and also prints the given name. */
@@ -0,0 +1,46 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <stdint.h>
+
+using namespace std;
+
+
+/**
+ * Zobrist hashing for board positions.
+ * Each (position, player) pair has a fixed pseudorandom 64-bit key, and the hash of a board is the XOR of the keys
+ * of its stones, so placing or removing a stone updates the hash with a single XOR.
+ * The keys are computed on the fly with the splitmix64 finalizer (a handful of arithmetic instructions),
+ * so there is no key table to initialize or keep in cache, and the keys are the same in every run.
+ */
+
+
+/* Returns a well-mixed 64-bit value for X (the splitmix64 finalizer). */
+inline uint64_t zobristMix(uint64_t x) {
+	x += 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+/* Returns the key of a stone of PLAYER (1 or -1) at position POS. */
+inline uint64_t zobristKey(int pos, int player) {
+	return zobristMix(2 * (uint64_t) pos + (player == 1 ? 0 : 1));
+}
+
+/* Returns the key that every board of the given DIMENSION starts from, so boards of different sizes do not share hashes. */
+inline uint64_t zobristBoardKey(int dimension) {
+	return zobristMix(~(uint64_t) dimension);
+}
+
+/**
+ * Returns the key for Player 2 (-1) being the one to move.  Only hashes that can't tell the turn from the stones need it
+ * (such as the images of a board under symmetries that swap the players).
+ */
+inline uint64_t zobristTurnKey() {
+	return zobristMix(1ULL << 62);
+}
+
+
+
+#endif
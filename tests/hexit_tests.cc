@@ -2,6 +2,19 @@
 #include "test_mcts.h"
 #include "test_thread_manager.h"
 #include "test_hex.h"
+#include "test_node_arena.h"
+#include "test_uct_kernel.h"
+#include "test_profiler.h"
+#include "test_transposition_table.h"
+#include "test_tree_parallel.h"
+#include "test_leaf_parallel.h"
+#include "test_batch_rollout.h"
+#include "test_rng.h"
+#include "test_task_scheduler.h"
+#include "test_inference_service.h"
+#include "test_evaluator_socket.h"
+#include "test_batch_buffer.h"
+#include "test_batch_encoder.h"
 
 #include<iostream> 
 #include <stdlib.h> // srand, rand
@@ -16,7 +29,20 @@ int main()
 	//runTictactoeTests();
 	runMctsTests();
 	//runThreadManagerTests();
-	//runHexTests();
+	runHexTests();
+	runNodeArenaTests();
+	runUCTKernelTests();
+	runProfilerTests();
+	runTranspositionTableTests();
+	runTreeParallelTests();
+	runLeafParallelTests();
+	runBatchRolloutTests();
+	runBatchEncoderTests();
+	runRngTests();
+	runTaskSchedulerTests();
+	runBatchBufferTests();
+	runInferenceServiceTests();
+	runEvaluatorSocketTests();
 	cout << endl << "Finished Tests..." << endl << endl;
 }
 
@@ -0,0 +1,87 @@
+#include <fcntl.h>
+#include <iostream>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "test_batch_buffer.h"
+
+using namespace std;
+
+
+
+void testLayout() {
+
+	// every region starts on its own cache line, and rows follow each other within it
+	vector<int> input_sizes = {98, 2};
+	BatchBuffer buffer(5, input_sizes, 25);
+	ASSERT(buffer.capacity() == 5 && buffer.numInputs() == 2 && buffer.outputSize() == 25, "The buffer should keep its layout");
+	ASSERT(buffer.inputSize(0) == 98 && buffer.inputSize(1) == 2, "The buffer should keep the size of each input field");
+	ASSERT(buffer.shmName() == "", "A buffer of its own memory should not be in a segment");
+	for (int field = 0; field < 2; field++) {
+		ASSERT((uintptr_t) buffer.input(field, 0) % CACHE_LINE_SIZE == 0, "Input field " << field << " should start on a cache line");
+		ASSERT(buffer.input(field, 3) == buffer.input(field, 0) + 3 * input_sizes[field], "The rows of field " << field << " should be contiguous");
+	}
+	ASSERT((uintptr_t) buffer.output(0) % CACHE_LINE_SIZE == 0, "The outputs should start on a cache line");
+	ASSERT(buffer.output(4) == buffer.output(0) + 4 * 25, "The rows of outputs should be contiguous");
+	ASSERT(buffer.input(0, 4) + 98 <= buffer.input(1, 0) && buffer.input(1, 4) + 2 <= buffer.output(0), "The regions should not overlap");
+
+	// the memory starts zeroed, and writing one row leaves its neighbours alone
+	for (int value = 0; value < 98; value++) {
+		ASSERT(buffer.input(0, 2)[value] == 0, "A new buffer should be zeroed");
+		buffer.input(0, 2)[value] = 1;
+	}
+	ASSERT(buffer.input(0, 1)[97] == 0 && buffer.input(0, 3)[0] == 0, "Writing a row should not touch its neighbours");
+
+}
+
+
+void testSharedSegment() {
+
+	// a buffer attached by name maps the same memory as the one that created it, with the same layout
+	string shm_name = "/hexit_test_batch_buffer_" + to_string(getpid());
+	BatchBuffer* buffer = new BatchBuffer(3, {10, 2, 1}, 4, shm_name);
+	ASSERT(buffer->shmName() == shm_name, "The buffer should know the name of its segment");
+	BatchBuffer* attached = new BatchBuffer(shm_name);
+	ASSERT(attached->capacity() == 3 && attached->numInputs() == 3 && attached->inputSize(0) == 10 && attached->inputSize(1) == 2
+		&& attached->inputSize(2) == 1 && attached->outputSize() == 4, "An attached buffer should read its layout from the segment");
+
+	buffer->input(1, 2)[1] = 0.5;
+	attached->output(1)[3] = 7;
+	ASSERT(attached->input(1, 2)[1] == 0.5, "An input written by the creator should be seen by the attached buffer");
+	ASSERT(buffer->output(1)[3] == 7, "An output written by the attached buffer should be seen by the creator");
+
+	// deleting the attached buffer leaves the segment, but deleting the creator removes it
+	delete attached;
+	ASSERT(buffer->output(1)[3] == 7, "The creator should still map the segment once the attached buffer is gone");
+	delete buffer;
+	int fd = shm_open(shm_name.c_str(), O_RDWR, 0);
+	ASSERT(fd < 0, "The segment should be removed along with the buffer that created it");
+
+}
+
+
+void testExternalInputs() {
+
+	// inputs in someone else's memory are used in place, and only the outputs are the buffer's own
+	vector<float> x(4 * 6, 0);
+	vector<float> turn_mask(4 * 2, 0);
+	BatchBuffer buffer(4, {x.data(), turn_mask.data()}, {6, 2}, 3);
+	ASSERT(buffer.input(0, 0) == x.data() && buffer.input(0, 2) == x.data() + 12, "Input field 0 should be the given memory");
+	ASSERT(buffer.input(1, 3) == turn_mask.data() + 6, "Input field 1 should be the given memory");
+	buffer.input(1, 1)[0] = 1;
+	ASSERT(turn_mask[2] == 1, "Writing an input row should write the given memory");
+	buffer.output(3)[2] = 0.25;
+	ASSERT(buffer.output(3)[2] == 0.25, "The outputs should be writable");
+
+}
+
+
+
+void runBatchBufferTests() {
+	cout << "Running Batch Buffer Tests..." << endl << endl;
+	testLayout();
+	testSharedSegment();
+	testExternalInputs();
+	cout << "Finished running Batch Buffer Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_BATCH_BUFFER_H
+#define TEST_BATCH_BUFFER_H
+
+#include "../src/batch_buffer.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runBatchBufferTests();
+
+#endif
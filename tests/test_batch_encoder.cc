@@ -0,0 +1,122 @@
+#include <iostream>
+
+#include "test_batch_encoder.h"
+
+using namespace std;
+
+
+
+/* Returns a random board of the given DIM, played out NUM_MOVES moves (or fewer, if it is won first) from an empty board. */
+static HexState randomState(int dim, int num_moves) {
+	HexState state(dim, vector<int>(dim * dim, 0));
+	for (int i = 0; i < num_moves && !state.isTerminalState(); i++) {
+		state.applyAction(state.randomAction());
+	}
+	return state;
+}
+
+/* Checks that X and TURN_MASK hold the encoding of STATE: its state vector with the channels interleaved, or blanks if it is terminal. */
+static void checkEncoding(const HexState& state, const float* x, const float* turn_mask) {
+	int padded_dim = state.dimension() + 4;
+	int channel_size = padded_dim * padded_dim;
+	if (state.isTerminalState()) {
+		for (int i = 0; i < 2 * channel_size; i++) {
+			ASSERT(x[i] == 0, "A terminal state should have blank channels");
+		}
+		ASSERT(turn_mask[0] == 1 && turn_mask[1] == 0, "A terminal state should have Player 1's turn mask");
+		return;
+	}
+
+	vector<double> state_vector;
+	state.makeStateVector(&state_vector);
+	for (int channel = 0; channel < 2; channel++) {
+		for (int cell = 0; cell < channel_size; cell++) {
+			ASSERT(x[cell * 2 + channel] == state_vector[channel * channel_size + cell],
+				"Cell " << cell << " of channel " << channel << " should match the state vector, on a board of dimension " << state.dimension());
+		}
+	}
+	ASSERT(turn_mask[0] == state_vector[2 * channel_size] && turn_mask[1] == state_vector[2 * channel_size + 1],
+		"The turn mask should match the state vector");
+}
+
+
+void testMatchesStateVector() {
+
+	// for any dimension, the encoding is the state vector with its channels interleaved
+	for (int dim : {1, 2, 3, 5, 8, 9, 11, 19}) {
+		for (int trial = 0; trial < 20; trial++) {
+			HexState state = randomState(dim, rand() % (dim * dim + 1));
+			vector<float> x(state.nnInputSize(), -1);
+			float turn_mask[2] = {-1, -1};
+			state.encodeNNInput(x.data(), turn_mask);
+			checkEncoding(state, x.data(), turn_mask);
+		}
+	}
+
+}
+
+
+void testEngineDimensions() {
+
+	// an engine that changes dimension encodes the same as one set up for that dimension from the start
+	HexBatchEncoder engine(5);
+	ASSERT(engine.dimension() == 5 && engine.paddedDim() == 9 && engine.inputSize() == 2 * 81, "The engine should be set up for 5 x 5 boards");
+	engine.setDimension(11);
+	ASSERT(engine.dimension() == 11 && engine.inputSize() == 2 * 15 * 15, "The engine should take the new dimension");
+	engine.setDimension(5);
+
+	HexBatchEncoder fresh(5);
+	HexState state = randomState(5, 7);
+	Bitboard player1_stones, player2_stones;
+	vector<int> board = state.board();
+	for (int pos = 0; pos < 25; pos++) {
+		if (board[pos] == 1) player1_stones.set(pos);
+		if (board[pos] == -1) player2_stones.set(pos);
+	}
+	vector<float> x(engine.inputSize()), expected(engine.inputSize());
+	float turn_mask[2], expected_turn_mask[2];
+	engine.encode(player1_stones, player2_stones, -1, x.data(), turn_mask);
+	fresh.encode(player1_stones, player2_stones, -1, expected.data(), expected_turn_mask);
+	ASSERT(x == expected && turn_mask[0] == 0 && turn_mask[1] == 1, "Changing dimension back and forth should not change the encoding");
+
+	// a terminal encoding clears whatever the memory held
+	engine.encodeTerminal(x.data(), turn_mask);
+	for (float value : x) {
+		ASSERT(value == 0, "A terminal encoding should be blank");
+	}
+
+}
+
+
+void testEncodeBatch() {
+
+	// a batch is encoded row after row into contiguous memory, and nothing past its last row is touched
+	int dim = 7;
+	vector<EnvState*> states;
+	for (int i = 0; i < 6; i++) {
+		states.push_back(new HexState(randomState(dim, i * 5)));
+	}
+	int input_size = states[0]->nnInputSize();
+	vector<float> x(6 * input_size, -1);
+	vector<float> turn_mask(6 * 2, -1);
+	encodeNNBatch(states, 5, x.data(), turn_mask.data());
+	for (int i = 0; i < 5; i++) {
+		checkEncoding(*(HexState*) states[i], x.data() + i * input_size, turn_mask.data() + 2 * i);
+	}
+	ASSERT(x[5 * input_size] == -1 && turn_mask[10] == -1, "Encoding 5 states should leave the 6th row alone");
+
+	for (EnvState* state : states) {
+		delete state;
+	}
+
+}
+
+
+
+void runBatchEncoderTests() {
+	cout << "Running Batch Encoder Tests..." << endl << endl;
+	testMatchesStateVector();
+	testEngineDimensions();
+	testEncodeBatch();
+	cout << "Finished running Batch Encoder Tests." << endl << endl;
+}
@@ -0,0 +1,12 @@
+#ifndef TEST_BATCH_ENCODER_H
+#define TEST_BATCH_ENCODER_H
+
+#include "../src/hex_batch_encoder.h"
+#include "../src/hex_state.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runBatchEncoderTests();
+
+#endif
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <math.h>
+
+#include "test_batch_rollout.h"
+
+using namespace std;
+
+
+
+/* Returns the board of a full Hex board with PLAYER1_STONES (Player 2 holds every other cell). */
+static vector<int> fullBoard(int dim, const Bitboard& player1_stones) {
+	vector<int> board(dim * dim);
+	for (int pos = 0; pos < dim * dim; pos++) {
+		board[pos] = player1_stones.test(pos) ? 1 : -1;
+	}
+	return board;
+}
+
+
+void testBatchWinners() {
+
+	// every game of a pass should be a fair fill of the empty cells, with the winner a HexState finds on the same board
+	HexBatchRollout engine;
+	for (int dim : {1, 2, 5, 8, 11}) {
+		engine.setDimension(dim);
+		ASSERT(engine.dimension() == dim, "The engine should take the new dimension");
+		for (int num_games : {1, 64, 100, HEX_BATCH_GAMES}) {
+
+			// start from a random partially played board
+			HexState state(dim, vector<int>(dim * dim, 0));
+			int num_opening_moves = rand() % (dim * dim);
+			for (int i = 0; i < num_opening_moves && !state.isTerminalState(); i++) {
+				state.applyAction(state.randomAction());
+			}
+			if (state.isTerminalState()) {
+				continue;
+			}
+
+			vector<int> board = state.board();
+			Bitboard player1_stones, empty_cells;
+			int num_empty = 0;
+			for (int pos = 0; pos < dim * dim; pos++) {
+				if (board[pos] == 1) {
+					player1_stones.set(pos);
+				} else if (board[pos] == 0) {
+					empty_cells.set(pos);
+					num_empty++;
+				}
+			}
+
+			engine.play(player1_stones, empty_cells, state.turn(), num_games);
+			ASSERT(engine.numGames() == num_games, "The engine should play " << num_games << " games");
+			int num_player1_wins = 0;
+			for (int game = 0; game < num_games; game++) {
+				Bitboard game_stones = engine.player1Stones(game);
+				ASSERT((game_stones & player1_stones) == player1_stones, "A game should keep Player 1's stones");
+				ASSERT(game_stones.andNot(player1_stones).andNot(empty_cells).empty(), "A game should only fill the empty cells");
+
+				// the player to move fills half the empty cells, rounding up
+				int num_filled = (game_stones & empty_cells).count();
+				int expected_filled = (state.turn() == 1) ? (num_empty + 1) / 2 : num_empty / 2;
+				ASSERT(num_filled == expected_filled, "Player 1 should fill " << expected_filled << " cells, not " << num_filled);
+
+				int first_action = engine.firstAction(game);
+				ASSERT(empty_cells.test(first_action), "The first action should be an empty cell");
+				ASSERT(game_stones.test(first_action) == (state.turn() == 1), "The player to move should fill the first action");
+
+				HexState full(dim, fullBoard(dim, game_stones));
+				ASSERT(full.isTerminalState(), "A full board should be terminal");
+				ASSERT(engine.winner(game) == full.winner(), "Game " << game << " should be won by " << full.winner());
+				if (full.winner() == 1) {
+					num_player1_wins++;
+				}
+			}
+			ASSERT(engine.numPlayer1Wins() == num_player1_wins, "The engine should count Player 1's wins");
+		}
+	}
+
+}
+
+
+void testBatchRolloutDecided() {
+
+	// Player 1 has two paths down the sides, each missing its middle cell, and Player 2 can only take one of them
+	vector<int> board = {
+		1, -1, 1,
+		0, -1, 0,
+		1, -1, 1
+	};
+	HexState decided(3, board, "basic");
+	ASSERT(!decided.isTerminalState() && decided.turn() == -1, "Player 2 should be to move");
+
+	ASSERT(decided.supportsBatchRollout(), "Hex states should support batch rollouts");
+	int num_rollouts = 600;
+	RolloutBatch batch;
+	batch.reset(9, decided.turn(), true /* use_rave */);
+	decided.batchRollout(num_rollouts, &batch);
+	ASSERT(batch.size() == num_rollouts, "The batch should hold every rollout, over several passes");
+	ASSERT(batch.total_reward == num_rollouts, "Player 1 should win every rollout");
+	for (int game = 0; game < num_rollouts; game++) {
+		ASSERT(batch.first_actions[game] == 3 || batch.first_actions[game] == 5, "Player 2 should start on an empty cell");
+	}
+
+	// each player filled one of the two cells in every rollout, and Player 1 won all of them
+	for (int player = 0; player < 2; player++) {
+		uint32_t total_count = 0;
+		for (int i = 0; i < batch.rave_actions[player].size(); i++) {
+			ASSERT(batch.rave_rewards[player][i] == batch.rave_counts[player][i], "Every rollout should have a reward of 1");
+			total_count += batch.rave_counts[player][i];
+		}
+		ASSERT(total_count == num_rollouts, "Each player should fill one cell per rollout, not " << total_count << " over " << num_rollouts);
+	}
+
+}
+
+
+void testBatchRolloutStats() {
+
+	// batch rollouts should win as often as fill rollouts from the same position
+	int num_rollouts = 4000;
+	HexState state(5, vector<int>(25, 0), "win_fast");
+	state.applyAction(0);
+	state.applyAction(12);
+
+	RolloutBatch batch;
+	batch.reset(25, state.turn(), false /* use_rave */);
+	state.batchRollout(num_rollouts, &batch);
+	ASSERT(batch.rave_actions[0].empty() && batch.rave_actions[1].empty(), "A batch without RAVE should keep no RAVE totals");
+	double batch_win_rate = (batch.total_reward / num_rollouts + 1) / 2;
+
+	int num_fill_wins = 0;
+	for (int rollout_num = 0; rollout_num < num_rollouts; rollout_num++) {
+		double max_reward;
+		if (state.fillRollout(NULL, &max_reward) > 0) {
+			num_fill_wins++;
+		}
+	}
+	double fill_win_rate = (double) num_fill_wins / num_rollouts;
+	ASSERT(fabs(batch_win_rate - fill_win_rate) < 0.06, "Batch rollouts win " << batch_win_rate << " of the time, but fill rollouts win " << fill_win_rate);
+
+}
+
+
+
+void runBatchRolloutTests() {
+	cout << "Running Batch Rollout Tests..." << endl << endl;
+	testBatchWinners();
+	testBatchRolloutDecided();
+	testBatchRolloutStats();
+	cout << "Finished running Batch Rollout Tests." << endl << endl;
+}
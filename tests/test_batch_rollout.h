@@ -0,0 +1,12 @@
+#ifndef TEST_BATCH_ROLLOUT_H
+#define TEST_BATCH_ROLLOUT_H
+
+#include "../src/hex_batch_rollout.h"
+#include "../src/hex_state.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runBatchRolloutTests();
+
+#endif
@@ -0,0 +1,157 @@
+#include <iostream>
+#include <math.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "test_evaluator_socket.h"
+
+using namespace std;
+
+
+
+/* Returns a socket path that no other run of the tests is using. */
+static string testSocketPath(const string& name) {
+	return "/tmp/hexit_" + name + "_" + to_string(getpid()) + ".sock";
+}
+
+
+void testProtocolRoundTrip() {
+
+	// a batch written on one end of a socket pair reads back whole on the other, for any number of rows
+	int fds[2];
+	ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0, "Unable to create a socket pair");
+	vector<float> rows = {0.5, -1, 2, 3.25, 0, 7};
+	vector<float> received;
+	int num_rows, row_size;
+	ASSERT(writeEvalBatch(fds[0], EVAL_REQUEST_MAGIC, rows.data(), 2, 3), "Writing a batch should succeed");
+	ASSERT(writeEvalBatch(fds[0], EVAL_REQUEST_MAGIC, rows.data(), 0, 3), "Writing an empty batch should succeed");
+	ASSERT(readEvalBatch(fds[1], EVAL_REQUEST_MAGIC, &received, &num_rows, &row_size), "Reading a batch should succeed");
+	ASSERT(num_rows == 2 && row_size == 3 && received == rows, "The batch should read back exactly as it was written");
+	ASSERT(readEvalBatch(fds[1], EVAL_REQUEST_MAGIC, &received, &num_rows, &row_size), "Reading an empty batch should succeed");
+	ASSERT(num_rows == 0 && received.empty(), "The empty batch should read back with no rows");
+
+	// once the writer is gone, a read reports the closed connection instead of blocking
+	close(fds[0]);
+	ASSERT(!readEvalBatch(fds[1], EVAL_REQUEST_MAGIC, &received, &num_rows, &row_size), "Reading from a closed connection should fail");
+	close(fds[1]);
+
+}
+
+void testStubServer() {
+
+	// batches sent over one connection get back the stub's answer for their own rows, in order
+	string socket_path = testSocketPath("stub_server");
+	StubRowEvaluator stub(4);
+	EvaluatorServer* server = new EvaluatorServer(&stub, socket_path);
+	EvaluatorClient* client = new EvaluatorClient(socket_path);
+
+	vector<float> outputs, expected(3 * 4);
+	int num_outputs;
+	for (int batch = 0; batch < 5; batch++) {
+		vector<float> rows = {(float) batch, 1, 0, 3, 2, (float) batch};
+		client->evaluate(rows.data(), 3, 2, &outputs, &num_outputs);
+		stub.evaluate(rows.data(), 3, 2, expected.data());
+		ASSERT(num_outputs == 4 && outputs == expected, "Batch " << batch << " should get back the stub's answer for its rows");
+	}
+	ASSERT(client->numBatches() == 5 && server->numBatches() == 5, "Both ends should count five batches");
+
+	// the server moves on to the next client once the first one disconnects
+	delete client;
+	client = new EvaluatorClient(socket_path);
+	vector<float> rows = {1, 1};
+	client->evaluate(rows.data(), 1, 2, &outputs, &num_outputs);
+	ASSERT(outputs.size() == 4 && outputs[0] == 0.25, "A second client should be served too");
+	ASSERT(server->numBatches() == 6, "The server should count the second client's batch");
+
+	// stopping the server while a client is still connected
+	delete server;
+	ASSERT(access(socket_path.c_str(), F_OK) != 0, "The server should remove its socket file");
+	delete client;
+
+}
+
+void testSharedBatches() {
+
+	// a buffer the server has attached is evaluated in place, and row batches still work on the same connection
+	string socket_path = testSocketPath("shared_batches");
+	string shm_name = "/hexit_test_shared_batches_" + to_string(getpid());
+	StubRowEvaluator stub(4);
+	EvaluatorServer server(&stub, socket_path);
+	EvaluatorClient client(socket_path);
+	BatchBuffer buffer(3, {2}, 4, shm_name);
+	client.attach(7, shm_name);
+
+	vector<float> expected(3 * 4);
+	for (int batch = 0; batch < 3; batch++) {
+		for (int row = 0; row < 3; row++) {
+			buffer.input(0, row)[0] = batch + row;
+			buffer.input(0, row)[1] = 1;
+		}
+		client.evaluateShared(7, 2);
+		stub.evaluate(buffer.input(0, 0), 2, 2, expected.data());
+		for (int value = 0; value < 2 * 4; value++) {
+			ASSERT(buffer.output(0)[value] == expected[value], "Batch " << batch << " should get back the stub's answer for its rows, in place");
+		}
+		ASSERT(buffer.output(2)[0] == 0, "The row past the batch should be left alone");
+	}
+
+	vector<float> rows = {1, 1};
+	vector<float> outputs;
+	int num_outputs;
+	client.evaluate(rows.data(), 1, 2, &outputs, &num_outputs);
+	ASSERT(outputs.size() == 4 && outputs[0] == 0.25, "A row batch should still be answered after shared ones");
+	ASSERT(client.numBatches() == 4 && server.numBatches() == 4, "Both ends should count the shared batches too");
+
+}
+
+void testSocketEvaluator() {
+
+	// behind a socket evaluator, an inference service's states are encoded into shared memory, which the evaluator reads and
+	// writes its distributions over their actions to in place
+	string socket_path = testSocketPath("socket_evaluator");
+	StubRowEvaluator stub(25);
+	EvaluatorServer server(&stub, socket_path);
+	EvaluatorClient client(socket_path);
+	SocketEvaluator evaluator(&client);
+	InferenceService* service = new InferenceService(&evaluator, 4, 0);
+
+	InferenceRequest request;
+	vector<int> board(25, 0);
+	for (int i = 0; i < 3; i++) {
+		board[i * 7] = (i % 2 == 0) ? 1 : -1;
+		request.states.push_back(new HexState(5, board));
+	}
+	service->evaluate(&request);
+
+	for (int i = 0; i < 3; i++) {
+		vector<float> x(request.states[i]->nnInputSize());
+		float turn_mask[2];
+		request.states[i]->encodeNNInput(x.data(), turn_mask);
+		vector<float> expected(25);
+		stub.evaluate(x.data(), 1, x.size(), expected.data());
+
+		float* probs = request.result(i);
+		double total = 0;
+		for (int action = 0; action < 25; action++) {
+			ASSERT(fabs(probs[action] - expected[action]) < 1e-6, "State " << i << " got the wrong probability for action " << action);
+			total += probs[action];
+		}
+		ASSERT(fabs(total - 1) < 1e-4, "State " << i << "'s probabilities should sum to 1, not " << total);
+		delete request.states[i];
+	}
+	service->release(&request);
+	ASSERT(client.numBatches() == 1 && server.numBatches() == 1, "The three states should have been evaluated as one batch");
+	delete service;
+
+}
+
+
+
+void runEvaluatorSocketTests() {
+	cout << "Running Evaluator Socket Tests..." << endl << endl;
+	testProtocolRoundTrip();
+	testStubServer();
+	testSharedBatches();
+	testSocketEvaluator();
+	cout << "Finished running Evaluator Socket Tests." << endl << endl;
+}
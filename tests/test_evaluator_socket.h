@@ -0,0 +1,12 @@
+#ifndef TEST_EVALUATOR_SOCKET_H
+#define TEST_EVALUATOR_SOCKET_H
+
+#include "../src/evaluator_socket.h"
+#include "../src/hex_state.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runEvaluatorSocketTests();
+
+#endif
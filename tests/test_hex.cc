@@ -162,9 +162,326 @@ void testRandomActionHex() {
 }
 
 
+void testLargeBoardHex() {
+
+	// an 11 x 11 board spans two Bitboard words, so place stones on both sides of the word boundary
+	int dim = 11;
+	vector<int> b(dim * dim, 0);
+	b[0] = 1; b[63] = -1; b[64] = 1; b[120] = -1;
+	HexState large(dim, b, "win_fast");
+
+	ASSERT(large.numActions() == 121, "11 x 11 board has 121 actions");
+	ASSERT(large.numPiecesPlayed() == 4, "4 pieces played");
+	ASSERT(large.turn() == 1, "Turn should be 1");
+	ASSERT(large.board() == b, "board() should round trip the stones");
+	ASSERT(!large.isLegalAction(63) && !large.isLegalAction(64), "Occupied cells are illegal");
+	ASSERT(large.isLegalAction(62) && large.isLegalAction(65), "Empty cells are legal");
+	ASSERT(!large.isLegalAction(-1) && !large.isLegalAction(121), "Out of range actions are illegal");
+
+	// random actions are always legal, and reach cells in every word
+	bool low_word = false, high_word = false;
+	for (int t = 0; t < 1000; t++) {
+		int a = large.randomAction();
+		ASSERT(large.isLegalAction(a), "Random action " << a << " should be legal");
+		low_word = low_word || a < 64;
+		high_word = high_word || a >= 64;
+	}
+	ASSERT(low_word && high_word, "Random actions should cover both Bitboard words");
+
+	// the last empty cell is the only possible random action
+	HexState almost_full(3, {1,-1,1,-1,1,-1,-1,0,1}, "basic");
+	ASSERT(almost_full.randomAction() == 7, "Only cell 7 is empty");
+
+}
+
+
+// brute-force flood fill, used to check the incremental winner detection
+int floodFillWinner(int dim, const vector<int>& board) {
+	int dr[6] = {-1, -1, 0, 0, 1, 1};
+	int dc[6] = {0, 1, -1, 1, -1, 0};
+	for (int player : {1, -1}) {
+		vector<bool> reached(dim * dim, false);
+		vector<int> frontier;
+		for (int i = 0; i < dim; i++) {
+			int pos = (player == 1) ? i : i * dim;
+			if (board[pos] == player) {
+				reached[pos] = true;
+				frontier.push_back(pos);
+			}
+		}
+		while (!frontier.empty()) {
+			int pos = frontier.back();
+			frontier.pop_back();
+			int r = pos / dim, c = pos % dim;
+			if ((player == 1 && r == dim - 1) || (player == -1 && c == dim - 1)) {
+				return player;
+			}
+			for (int n = 0; n < 6; n++) {
+				int nr = r + dr[n], nc = c + dc[n];
+				int npos = (nr * dim) + nc;
+				if (nr >= 0 && nr < dim && nc >= 0 && nc < dim && board[npos] == player && !reached[npos]) {
+					reached[npos] = true;
+					frontier.push_back(npos);
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+
+void testIncrementalWinnerHex() {
+
+	// play random games, checking the incrementally maintained winner against a flood fill after every move
+	for (int dim : {1, 2, 5, 9, 11}) {
+		for (int game = 0; game < 50; game++) {
+			HexState* state = new HexState(dim, vector<int>(dim * dim, 0), "basic");
+			while (true) {
+				int expected = floodFillWinner(dim, state->board());
+				ASSERT(state->winner() == expected, "Winner should be " << expected << " on a " << dim << " x " << dim << " board");
+				HexState rebuilt(dim, state->board(), "basic");
+				ASSERT(rebuilt.winner() == expected, "Winner of rebuilt state should be " << expected);
+				if (state->isTerminalState()) {
+					break;
+				}
+				HexState* next_state = state->nextState(state->randomAction());
+				delete state;
+				state = next_state;
+			}
+			delete state;
+		}
+	}
+
+}
+
+
+void testApplyUndoActionHex() {
+
+	// play random games in place, checking each state against nextState, then undo all the way back to empty
+	for (int dim : {2, 5, 11}) {
+		for (int game = 0; game < 20; game++) {
+			HexState* state = new HexState(dim, vector<int>(dim * dim, 0), "win_fast");
+			vector<HexState*> history;
+			vector<int> actions;
+			while (!state->isTerminalState()) {
+				history.push_back(state->clone());
+				int action = state->randomAction();
+				actions.push_back(action);
+				HexState* expected = state->nextState(action);
+				state->applyAction(action);
+				ASSERT(state->equals(*expected), "applyAction should match nextState");
+				ASSERT(state->turn() == expected->turn() && state->winner() == expected->winner(), "applyAction should match nextState");
+				delete expected;
+			}
+			ASSERT(state->reward() != 0.0, "Finished game should have a nonzero reward");
+
+			for (int i = actions.size() - 1; i >= 0; i--) {
+				state->undoAction(actions[i]);
+				ASSERT(state->equals(*history[i]), "undoAction should restore the previous board");
+				ASSERT(state->turn() == history[i]->turn(), "undoAction should restore the previous turn");
+				ASSERT(state->winner() == history[i]->winner() && !state->isTerminalState(), "undoAction should restore the previous winner");
+				ASSERT(state->isLegalAction(actions[i]), "Undone action should be legal again");
+				delete history[i];
+			}
+			ASSERT(state->numPiecesPlayed() == 0, "Board should be empty after undoing every action");
+
+			// copyFrom overwrites a scratch state with another
+			HexState* scratch = new HexState(dim, vector<int>(dim * dim, 0), "win_fast");
+			state->applyAction(0);
+			scratch->copyFrom(*state);
+			ASSERT(scratch->equals(*state) && scratch->turn() == -1, "copyFrom should copy the board and turn");
+			delete scratch;
+
+			// cloneInto only needs room for this board's cells, and the clone keeps playing correctly
+			char* memory = new char[state->sizeInBytes()];
+			HexState* clone = state->cloneInto(memory);
+			ASSERT(clone->equals(*state) && clone->turn() == -1, "cloneInto should copy the board and turn");
+			while (!clone->isTerminalState()) {
+				clone->applyAction(clone->randomAction());
+			}
+			HexState rebuilt(dim, clone->board(), "win_fast");
+			ASSERT(clone->winner() == rebuilt.winner(), "A clone's connectivity should find the same winner as rebuilding it");
+			clone->~HexState();
+			delete[] memory;
+			delete state;
+		}
+	}
+
+	// a state's size grows with its board
+	HexState small(2, vector<int>(4, 0), "win_fast");
+	HexState large(11, vector<int>(121, 0), "win_fast");
+	ASSERT(small.sizeInBytes() < large.sizeInBytes() && large.sizeInBytes() <= sizeof(HexState), "A Hex state's size should grow with its board");
+
+}
+
+
+void testFillRolloutHex() {
+
+	// replaying the actions of a fill rollout move by move should end the game exactly on the last one, with the same reward
+	for (int dim : {1, 2, 5, 11}) {
+		for (string reward_type : {"basic", "win_fast"}) {
+			for (int game = 0; game < 50; game++) {
+
+				// start from a random partially played board
+				HexState* state = new HexState(dim, vector<int>(dim * dim, 0), reward_type);
+				int num_opening_moves = rand() % (dim * dim);
+				for (int i = 0; i < num_opening_moves && !state->isTerminalState(); i++) {
+					state->applyAction(state->randomAction());
+				}
+				if (state->isTerminalState()) {
+					delete state;
+					continue;
+				}
+
+				ASSERT(state->supportsFillRollout(), "Hex states should support fill rollouts");
+				vector<int> rollout_actions;
+				double max_reward;
+				double reward = state->fillRollout(&rollout_actions, &max_reward);
+				ASSERT(!state->isTerminalState(), "fillRollout should not change the state");
+
+				HexState* replay = state->clone();
+				for (int i = 0; i < rollout_actions.size(); i++) {
+					ASSERT(!replay->isTerminalState(), "Game should not end before the last rollout action");
+					replay->applyAction(rollout_actions[i]);
+				}
+				ASSERT(replay->isTerminalState(), "Game should end on the last rollout action");
+				ASSERT(replay->reward() == reward, "Fill rollout reward " << reward << " should be " << replay->reward());
+				ASSERT(replay->maxReward() == max_reward, "Fill rollout max reward should match the terminal state");
+
+				// without the rollout actions, the reward is still a win or loss of the max reward
+				double unused_max_reward;
+				double sign = state->fillRollout(NULL, &unused_max_reward);
+				ASSERT(sign == 1.0 * unused_max_reward || sign == -1.0 * unused_max_reward, "Fill rollout should have a winner");
+
+				delete replay;
+				delete state;
+			}
+		}
+	}
+
+}
+
+
+void testHashHex() {
+
+	for (int dim : {2, 5, 11}) {
+		for (int game = 0; game < 20; game++) {
+			HexState* state = new HexState(dim, vector<int>(dim * dim, 0), "win_fast");
+			vector<uint64_t> hashes;
+			vector<int> actions;
+			while (!state->isTerminalState()) {
+				hashes.push_back(state->hash());
+				int action = state->randomAction();
+				actions.push_back(action);
+				uint64_t expected = state->hashAfterAction(action);
+				state->applyAction(action);
+				ASSERT(state->hash() == expected, "hashAfterAction should predict the hash after applyAction");
+
+				// the incremental hash matches the hash of the same board built from scratch
+				HexState rebuilt(dim, state->board(), "win_fast");
+				ASSERT(rebuilt.hash() == state->hash(), "Incremental hash should match the hash of the rebuilt board");
+			}
+
+			// undoing restores the hashes
+			for (int i = actions.size() - 1; i >= 0; i--) {
+				state->undoAction(actions[i]);
+				ASSERT(state->hash() == hashes[i], "undoAction should restore the previous hash");
+			}
+			delete state;
+		}
+	}
+
+	// the same stones played in a different order give the same hash, and different stones do not
+	HexState a(5, vector<int>(25, 0), "win_fast");
+	HexState b(5, vector<int>(25, 0), "win_fast");
+	for (int action : {3, 7, 12, 20}) {
+		a.applyAction(action);
+	}
+	for (int action : {12, 20, 3, 7}) {
+		b.applyAction(action);
+	}
+	ASSERT(a.hash() == b.hash() && a.equals(b), "Transposed move orders should give the same hash");
+	HexState c(5, vector<int>(25, 0), "win_fast");
+	for (int action : {7, 3, 12, 20}) {
+		c.applyAction(action);
+	}
+	ASSERT(c.hash() != a.hash() && !c.equals(a), "Swapping which player owns two stones should change the hash");
+
+	// boards of different sizes do not share hashes
+	HexState small(4, vector<int>(16, 0), "win_fast");
+	ASSERT(small.hash() != HexState(5, vector<int>(25, 0), "win_fast").hash(), "Empty boards of different sizes should have different hashes");
+
+}
+
+void testCanonicalHashHex() {
+
+	for (int dim : {2, 5, 11}) {
+		int num_cells = dim * dim;
+		for (int game = 0; game < 20; game++) {
+			HexState* state = new HexState(dim, vector<int>(num_cells, 0), "win_fast");
+			while (!state->isTerminalState()) {
+				int action = state->randomAction();
+				int expected_symmetry;
+				uint64_t expected = state->canonicalHashAfterAction(action, &expected_symmetry);
+				state->applyAction(action);
+				int symmetry;
+				ASSERT(state->canonicalHash(&symmetry) == expected && symmetry == expected_symmetry,
+					"canonicalHashAfterAction should predict the canonical hash after applyAction");
+
+				// the board rotated by 180 degrees is in the same class, and maps each cell to the same canonical cell
+				vector<int> board = state->board();
+				vector<int> rotated_board(num_cells);
+				for (int pos = 0; pos < num_cells; pos++) {
+					rotated_board[num_cells - 1 - pos] = board[pos];
+				}
+				HexState rotated(dim, rotated_board, "win_fast");
+				int rotated_symmetry;
+				ASSERT(rotated.canonicalHash(&rotated_symmetry) == state->canonicalHash(), "Rotated boards should have the same canonical hash");
+				if (rotated.hash() != state->hash()) {
+					for (int pos = 0; pos < num_cells; pos++) {
+						ASSERT(state->symmetricAction(pos, symmetry) == rotated.symmetricAction(num_cells - 1 - pos, rotated_symmetry),
+							"Rotated boards should map each cell to the same canonical cell");
+					}
+				}
+			}
+			delete state;
+		}
+	}
+
+	// every symmetry is its own inverse, and only HEX_TRANSPOSE_SWAP swaps the players
+	HexState state(5, vector<int>(25, 0), "win_fast");
+	for (int symmetry = 0; symmetry < HEX_NUM_SYMMETRIES; symmetry++) {
+		for (int pos = 0; pos < 25; pos++) {
+			ASSERT(state.symmetricAction(state.symmetricAction(pos, symmetry), symmetry) == pos, "Symmetries should be their own inverses");
+		}
+		ASSERT(state.symmetrySwapsPlayers(symmetry) == ((symmetry & HEX_TRANSPOSE_SWAP) != 0), "Only transposing should swap the players");
+	}
+	ASSERT(state.symmetricAction(1, HEX_TRANSPOSE_SWAP) == 5 && state.symmetricAction(1, HEX_ROTATE) == 23, "Incorrect symmetric cells");
+
+	// transposing without swapping the colours is not a symmetry, and the hash includes the player to move
+	HexState a(5, vector<int>(25, 0), "win_fast");
+	HexState b(5, vector<int>(25, 0), "win_fast");
+	a.applyAction(1);
+	b.applyAction(5);
+	ASSERT(a.canonicalHash() != b.canonicalHash(), "A stone and its transpose (without a colour swap) should not be equivalent");
+	ASSERT(a.canonicalHash() != HexState(5, vector<int>(25, 0), "win_fast").canonicalHashAfterAction(5), "Different stones should give different canonical hashes");
+
+}
+
+
 void testAsCSVStringHex() {
-	ASSERT(boards["empty"]->asCSVString() == "0,0,0,0,0,0,0,0,0", "Empty board CSV String incorrect");
-	ASSERT(boards["complex_p2_win"]->asCSVString() == "-1,1,-1,-1,-1,1,1,1,1", "CSV String incorrect for complex p2 win");
+
+	// the CSV string is the state vector (the NN's training input), not the raw board
+	for (string name : {"empty", "simple_p1_win", "complex_p2_win"}) {
+		vector<double> state_vector;
+		boards[name]->makeStateVector(&state_vector);
+		string expected = "";
+		for (int i = 0; i < state_vector.size(); i++) {
+			expected += to_string(state_vector[i]) + ((i < state_vector.size() - 1) ? "," : "");
+		}
+		ASSERT(boards[name]->asCSVString() == expected, "CSV String incorrect for " << name);
+	}
+	ASSERT(boards["empty"]->asCSVString().substr(0, 9) == "1.000000,", "The empty board's CSV String should start with the padding");
 
 }
 
@@ -187,6 +504,12 @@ void runHexTests() {
 	testNextStateHex();
 	testIsLegalActionHex();
 	testRandomActionHex();
+	testLargeBoardHex();
+	testIncrementalWinnerHex();
+	testApplyUndoActionHex();
+	testFillRolloutHex();
+	testHashHex();
+	testCanonicalHashHex();
 	testAsCSVStringHex();
 	testPrintBoardHex();
 	cout << "Finished running Hex Tests." << endl << endl;
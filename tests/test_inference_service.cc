@@ -0,0 +1,209 @@
+#include <iostream>
+#include <math.h>
+#include <map>
+#include <thread>
+
+#include "test_inference_service.h"
+
+using namespace std;
+
+
+
+/**
+ * A stand-in for the NN, which encodes each state as its ID, and gives it that ID back as its only output (so results can be
+ * matched to states).  Records the size of every batch it is handed, and the number of buffers it makes.
+ */
+class StubEvaluator : public BatchEvaluator {
+
+public:
+
+	map<EnvState*, int> ids;
+	vector<int> batch_sizes;
+	int num_buffers = 0;
+
+	void layout(EnvState* example, vector<int>* input_sizes, int* output_size) {
+		*input_sizes = {1};
+		*output_size = 1;
+	}
+
+	BatchBuffer* newBuffer(int capacity, const vector<int>& input_sizes, int output_size) {
+		this->num_buffers++;
+		return BatchEvaluator::newBuffer(capacity, input_sizes, output_size);
+	}
+
+	void encode(EnvState* state, BatchBuffer* buffer, int row) {
+		buffer->input(0, row)[0] = this->ids.at(state);
+	}
+
+	void evaluate(BatchBuffer* buffer, int num_rows) {
+		this->batch_sizes.push_back(num_rows);
+		for (int row = 0; row < num_rows; row++) {
+			buffer->output(row)[0] = buffer->input(0, row)[0];
+		}
+	}
+
+};
+
+
+/* Makes NUM_STATES states for REQUEST, with IDs from FIRST_ID on, that EVALUATOR knows. */
+static void makeRequest(StubEvaluator* evaluator, InferenceRequest* request, int num_states, int first_id) {
+	vector<int> board(9, 0);
+	request->states.clear();
+	for (int i = 0; i < num_states; i++) {
+		EnvState* state = new HexState(3, board);
+		evaluator->ids[state] = first_id + i;
+		request->states.push_back(state);
+	}
+}
+
+/* Checks that REQUEST got back the results of its own states, then releases it and frees them. */
+static void checkResults(InferenceService* service, InferenceRequest* request, int first_id) {
+	ASSERT(request->done, "A request should be done once waited on");
+	for (int i = 0; i < request->states.size(); i++) {
+		ASSERT(request->result(i)[0] == first_id + i, "State " << first_id + i << " got the result of state " << request->result(i)[0]);
+		delete request->states[i];
+	}
+	service->release(request);
+}
+
+/* Submits REQUEST to SERVICE and waits on it, as a worker thread does. */
+static void evaluateRequest(InferenceService* service, InferenceRequest* request) {
+	service->evaluate(request);
+}
+
+
+void testFullBatches() {
+
+	// with a deadline far away, the batch runs as soon as the four requests fill it, and each gets its own results back
+	StubEvaluator evaluator;
+	InferenceService* service = new InferenceService(&evaluator, 8, 60 * 1000 * 1000);
+	vector<InferenceRequest> requests(4);
+	for (int i = 0; i < 4; i++) {
+		makeRequest(&evaluator, &requests[i], 2, 2 * i);
+	}
+	vector<thread> workers;
+	for (int i = 0; i < 4; i++) {
+		workers.push_back(thread(evaluateRequest, service, &requests[i]));
+	}
+	for (int i = 0; i < 4; i++) {
+		workers[i].join();
+	}
+	ASSERT(evaluator.batch_sizes.size() == 1 && evaluator.batch_sizes[0] == 8, "The four requests should have been run as one batch");
+	ASSERT(service->numBatches() == 1 && service->numRows() == 8 && service->fillRatio() == 1, "The service should count one full batch");
+	for (int i = 0; i < 4; i++) {
+		checkResults(service, &requests[i], 2 * i);
+	}
+
+	// once the requests are released, the next batch reuses their buffer
+	for (int i = 0; i < 4; i++) {
+		makeRequest(&evaluator, &requests[i], 2, 10 + 2 * i);
+	}
+	for (int i = 0; i < 4; i++) {
+		workers[i] = thread(evaluateRequest, service, &requests[i]);
+	}
+	for (int i = 0; i < 4; i++) {
+		workers[i].join();
+		checkResults(service, &requests[i], 10 + 2 * i);
+	}
+	ASSERT(evaluator.batch_sizes.size() == 2 && evaluator.num_buffers == 1, "Both batches should have run in the same buffer");
+	delete service;
+
+}
+
+
+void testBatchDeadline() {
+
+	// a request that cannot fill the batch runs once its deadline passes
+	StubEvaluator evaluator;
+	InferenceService* service = new InferenceService(&evaluator, 100, 1000);
+	InferenceRequest request;
+	makeRequest(&evaluator, &request, 3, 0);
+	service->evaluate(&request);
+	ASSERT(evaluator.batch_sizes.size() == 1 && evaluator.batch_sizes[0] == 3, "The request should have run on its own after the deadline");
+	ASSERT(fabs(service->fillRatio() - 0.03) < 1e-9, "The batch should be 3% full, not " << service->fillRatio());
+	checkResults(service, &request, 0);
+
+	// requests are never split: a batch takes whole requests while they fit, and an oversized one runs on its own (in a buffer big enough for it)
+	InferenceRequest first;
+	InferenceRequest second;
+	InferenceRequest oversized;
+	makeRequest(&evaluator, &first, 60, 0);
+	makeRequest(&evaluator, &second, 60, 60);
+	makeRequest(&evaluator, &oversized, 150, 120);
+	service->submit(&first);
+	service->submit(&second);
+	service->submit(&oversized);
+	service->wait(&oversized);
+	service->wait(&second);
+	service->wait(&first);
+	ASSERT(evaluator.batch_sizes.size() == 4, "The three requests should have run in three batches");
+	for (int batch = 1; batch < 4; batch++) {
+		int size = evaluator.batch_sizes[batch];
+		ASSERT(size == 60 || size == 150, "Each request should have run as a batch of its own, but a batch had " << size << " states");
+	}
+	ASSERT(evaluator.num_buffers == 3, "The three batches should each have had a buffer of their own, not " << evaluator.num_buffers);
+	checkResults(service, &first, 0);
+	checkResults(service, &second, 60);
+	checkResults(service, &oversized, 120);
+
+	// stopping the service runs whatever is still queued, and releases the requests that the workers have not
+	InferenceRequest released;
+	InferenceRequest kept;
+	InferenceRequest last;
+	makeRequest(&evaluator, &released, 1, 0);
+	makeRequest(&evaluator, &kept, 1, 1);
+	service->submit(&released);
+	service->submit(&kept);
+	service->wait(&released);
+	service->wait(&kept);
+	checkResults(service, &released, 0);
+	makeRequest(&evaluator, &last, 2, 2);
+	service->submit(&last);
+	delete service;
+	ASSERT(evaluator.batch_sizes.back() == 2, "Deleting the service should have run the last request");
+	for (InferenceRequest* request : {&kept, &last}) {
+		ASSERT(request->done && request->batch == NULL && request->buffer == NULL, "Deleting the service should release the requests left in it");
+		for (EnvState* state : request->states) {
+			delete state;
+		}
+	}
+
+}
+
+
+void testWorkersBlocked() {
+
+	// the deadline is far away, but once both workers are waiting, no more requests can come, so the batch runs right away
+	StubEvaluator evaluator;
+	InferenceService* service = new InferenceService(&evaluator, 100, 60 * 1000 * 1000, 2 /* num_workers */);
+	InferenceRequest first;
+	InferenceRequest second;
+	makeRequest(&evaluator, &first, 3, 0);
+	makeRequest(&evaluator, &second, 3, 3);
+	thread worker(evaluateRequest, service, &first);
+	service->evaluate(&second);
+	worker.join();
+	ASSERT(evaluator.batch_sizes.size() == 1 && evaluator.batch_sizes[0] == 6, "Both requests should have run together, as soon as both workers waited");
+	checkResults(service, &first, 0);
+	checkResults(service, &second, 3);
+
+	// once a worker has finished, the other one alone waiting is enough
+	service->workerFinished();
+	InferenceRequest last;
+	makeRequest(&evaluator, &last, 2, 0);
+	service->evaluate(&last);
+	ASSERT(evaluator.batch_sizes.size() == 2 && evaluator.batch_sizes[1] == 2, "The last worker's request should have run on its own");
+	checkResults(service, &last, 0);
+	delete service;
+
+}
+
+
+
+void runInferenceServiceTests() {
+	cout << "Running Inference Service Tests..." << endl << endl;
+	testFullBatches();
+	testBatchDeadline();
+	testWorkersBlocked();
+	cout << "Finished running Inference Service Tests." << endl << endl;
+}
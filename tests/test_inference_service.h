@@ -0,0 +1,12 @@
+#ifndef TEST_INFERENCE_SERVICE_H
+#define TEST_INFERENCE_SERVICE_H
+
+#include "../src/inference_service.h"
+#include "../src/hex_state.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runInferenceServiceTests();
+
+#endif
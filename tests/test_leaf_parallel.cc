@@ -0,0 +1,145 @@
+#include <iostream>
+#include <math.h>
+
+#include "test_leaf_parallel.h"
+
+using namespace std;
+
+
+
+/* Checks that two nodes (of two trees) have the same regular and RAVE edge stats, up to rounding. */
+static void checkSameStats(MCTS_Node* node, MCTS_Node* other) {
+	ASSERT(node->getNumEdges() == other->getNumEdges(), "The nodes should have the same edges");
+	for (int edge = 0; edge < node->getNumEdges(); edge++) {
+		ASSERT(node->edgeTraversals()[edge] == other->edgeTraversals()[edge], "Edge " << edge << " should have been taken as often in both trees");
+		ASSERT(fabs(node->edgeRewards()[edge] - other->edgeRewards()[edge]) < 1e-4, "Edge " << edge << " should have the same reward in both trees");
+		if (node->usesRave()) {
+			ASSERT(node->edgeTraversalsRave()[edge] == other->edgeTraversalsRave()[edge], "Edge " << edge << " should have the same RAVE count in both trees");
+			ASSERT(fabs(node->edgeRewardsRave()[edge] - other->edgeRewardsRave()[edge]) < 1e-4, "Edge " << edge << " should have the same RAVE reward in both trees");
+		}
+	}
+}
+
+
+void testRolloutBatch() {
+
+	vector<int> board(25, 0);
+	HexState state(5, board, "win_fast");
+	state.applyAction(12);
+
+	// Player 2 is to move, so it takes the even actions of each rollout
+	RolloutBatch batch;
+	batch.reset(25, state.turn(), true /* use_rave */);
+	batch.addRollout({3, 4, 5}, 1);
+	batch.addRollout({4, 3, 6}, -1);
+	ASSERT(batch.size() == 2 && batch.total_reward == 0, "The batch should hold both rollouts");
+	ASSERT(batch.first_actions[0] == 3 && batch.first_actions[1] == 4, "The batch should keep each rollout's first action");
+
+	// Player 1 took 4 and then 3, and Player 2 took 3, 5, 4 and 6
+	ASSERT(batch.rave_actions[0] == vector<int>({4, 3}), "Player 1's RAVE actions are in the order first taken");
+	ASSERT(batch.rave_counts[0] == vector<uint32_t>({1, 1}) && batch.rave_rewards[0] == vector<double>({1, -1}), "Each of Player 1's actions was taken once");
+	ASSERT(batch.rave_actions[1] == vector<int>({3, 5, 4, 6}), "Player 2's RAVE actions are in the order first taken");
+	ASSERT(batch.rave_rewards[1] == vector<double>({1, 1, -1, -1}), "Player 2's rewards should be those of the rollouts that took each action");
+
+	batch.addRollout({3, 4, 7}, 1);
+	ASSERT(batch.rave_counts[1][0] == 2 && batch.rave_rewards[1][0] == 2, "An action taken in two rollouts should count both");
+
+	// without RAVE, only the first actions and rewards are kept
+	batch.reset(25, state.turn(), false /* use_rave */);
+	batch.addRollout({3, 4, 5}, 1);
+	ASSERT(batch.size() == 1 && batch.rave_actions[0].empty() && batch.rave_actions[1].empty(), "A batch without RAVE should keep no RAVE totals");
+
+}
+
+
+void testBatchPropagation() {
+
+	int num_rollouts = 8;
+	for (bool use_rave : {false, true}) {
+		vector<int> board(25, 0);
+		MCTS_Node* batched_root = new MCTS_Node(new HexState(5, board, "win_fast"), true, 10, false, false, use_rave,
+			DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, false /* use_transpositions */);
+		MCTS_Node* single_root = new MCTS_Node(new HexState(5, board, "win_fast"), true, 10, false, false, use_rave,
+			DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, false /* use_transpositions */);
+
+		// walk both trees down the same two actions
+		vector<PathStep> batched_path = {{batched_root, 12}};
+		MCTS_Node* batched_child = batched_root->makeChild(12);
+		batched_path.push_back({batched_child, 7});
+		MCTS_Node* batched_leaf = batched_child->makeChild(7);
+		MCTS_Node* single_child = single_root->makeChild(12);
+		MCTS_Node* single_leaf = single_child->makeChild(7);
+
+		// play the rollouts, then propagate them as one batch in one tree, and one at a time in the other
+		RolloutBatch batch;
+		batch.reset(25, batched_leaf->getState()->turn(), use_rave);
+		for (int rollout_num = 0; rollout_num < num_rollouts; rollout_num++) {
+			vector<int> rollout_actions;
+			double max_reward;
+			double reward = batched_leaf->getState()->fillRollout(&rollout_actions, &max_reward) / max_reward;
+			batch.addRollout(rollout_actions, reward);
+
+			vector<PathStep> single_path = {{single_root, 12}, {single_child, 7}};
+			ASSERT(propagateStats(single_leaf, reward, rollout_actions, &single_path) == single_root, "Propagation should return the root");
+		}
+		ASSERT(propagateStats(batched_leaf, &batch, &batched_path) == batched_root, "Batch propagation should return the root");
+		ASSERT(batched_path.empty(), "Batch propagation should empty the path");
+
+		// the batch counts a visit per rollout, but only finishes one simulation
+		checkSameStats(batched_root, single_root);
+		checkSameStats(batched_child, single_child);
+		checkSameStats(batched_leaf, single_leaf);
+		ASSERT(batched_root->numSimulationsFinished() == 1 && single_root->numSimulationsFinished() == num_rollouts,
+			"A batch of rollouts should be a single simulation");
+
+		delete batched_root;
+		delete single_root;
+	}
+
+}
+
+
+void testRolloutsPerLeaf() {
+
+	int num_simulations = 300;
+	int rollouts_per_leaf = 4;
+	for (int num_threads : {1, 3}) {
+		for (bool use_transpositions : {false, true}) {
+			vector<int> board(25, 0);
+			MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations, true, false, true,
+				DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, use_transpositions, DEFAULT_VIRTUAL_LOSS, rollouts_per_leaf);
+			ASSERT(root->getConfig()->rollouts_per_leaf == rollouts_per_leaf, "The tree should keep its rollouts per leaf");
+			MCTS_Node* copy = root->copyRoot();
+			ASSERT(copy->getConfig()->rollouts_per_leaf == rollouts_per_leaf, "A copied root should keep the rollouts per leaf");
+			delete copy;
+
+			// every simulation reaches a leaf below the root, and plays all of its rollouts there
+			root = runAllSimulations(root, 4, num_threads);
+			ASSERT(root->numSimulationsFinished() == num_simulations, "Every simulation should finish");
+			vector<int> action_counts(25, 0);
+			root->getActionCounts(&action_counts);
+			int total_count = 0;
+			for (int count : action_counts) {
+				total_count += count;
+			}
+			ASSERT(total_count == num_simulations * rollouts_per_leaf, "The root should count every rollout, not " << total_count);
+			vector<double> mean_rewards(25, 0.0);
+			root->getMeanRewards(&mean_rewards);
+			for (double mean_reward : mean_rewards) {
+				ASSERT(fabs(mean_reward) <= 1, "Mean rewards should stay normalized, not " << mean_reward);
+			}
+			delete root;
+		}
+	}
+
+}
+
+
+
+void runLeafParallelTests() {
+	cout << "Running Leaf Parallel Tests..." << endl << endl;
+	testRolloutBatch();
+	testBatchPropagation();
+	testRolloutsPerLeaf();
+	cout << "Finished running Leaf Parallel Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_LEAF_PARALLEL_H
+#define TEST_LEAF_PARALLEL_H
+
+#include "../src/mcts.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runLeafParallelTests();
+
+#endif
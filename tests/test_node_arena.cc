@@ -0,0 +1,77 @@
+#include <iostream>
+#include <stdint.h>
+
+#include "test_node_arena.h"
+
+using namespace std;
+
+
+
+void testAllocateNodeArena() {
+
+	NodeArena arena(1024);
+	ASSERT(arena.capacity() == 0 && arena.numChunks() == 0, "New arena should hold no chunks");
+
+	// allocations are aligned, and do not overlap
+	char* a = (char*) arena.allocate(3, 1);
+	double* b = (double*) arena.allocate(sizeof(double), alignof(double));
+	ASSERT(((uintptr_t) b) % alignof(double) == 0, "Allocation should be aligned");
+	ASSERT((char*) b >= a + 3, "Allocations should not overlap");
+	ASSERT(arena.numChunks() == 1 && arena.capacity() == 1024, "Small allocations should share one chunk");
+
+	// arrays are zeroed
+	int* array = arena.allocateArray<int>(100);
+	for (int i = 0; i < 100; i++) {
+		ASSERT(array[i] == 0, "Arena arrays should be zero-initialized");
+	}
+
+	// filling up the chunk adds another one, and an oversized request gets a chunk of its own
+	arena.allocate(1000);
+	ASSERT(arena.numChunks() == 2, "Arena should add a chunk when the current one is full");
+	arena.allocate(5000);
+	ASSERT(arena.numChunks() == 3 && arena.capacity() >= 1024 + 1024 + 5000, "Oversized requests should get their own chunk");
+
+}
+
+
+void testResetNodeArena() {
+
+	NodeArena arena(1024);
+	for (int i = 0; i < 10; i++) {
+		arena.allocate(512);
+	}
+	size_t high_water = arena.highWater();
+	int num_chunks = arena.numChunks();
+	ASSERT(arena.bytesUsed() >= 10 * 512 && high_water == arena.bytesUsed(), "High water should track bytes used");
+
+	// reset keeps the chunks and reuses them
+	arena.reset();
+	ASSERT(arena.bytesUsed() == 0 && arena.highWater() == high_water, "Reset should clear bytes used but not the high water");
+	for (int i = 0; i < 10; i++) {
+		arena.allocate(512);
+	}
+	ASSERT(arena.numChunks() == num_chunks, "Arena should reuse its chunks after a reset");
+
+	// release frees the chunks
+	arena.release();
+	ASSERT(arena.numChunks() == 0 && arena.capacity() == 0 && arena.highWater() == high_water, "Release should free all the chunks");
+
+	// reserve sizes the arena up front
+	arena.reserve(1 << 16);
+	ASSERT(arena.capacity() >= (1 << 16), "Reserve should grow the capacity");
+	num_chunks = arena.numChunks();
+	for (int i = 0; i < 100; i++) {
+		arena.allocate(512);
+	}
+	ASSERT(arena.numChunks() == num_chunks, "Reserved capacity should be used before adding chunks");
+
+}
+
+
+
+void runNodeArenaTests() {
+	cout << "Running Node Arena Tests..." << endl << endl;
+	testAllocateNodeArena();
+	testResetNodeArena();
+	cout << "Finished running Node Arena Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_NODE_ARENA_H
+#define TEST_NODE_ARENA_H
+
+#include "../src/node_arena.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runNodeArenaTests();
+
+#endif
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "test_profiler.h"
+
+using namespace std;
+
+
+
+/* Opens DEPTH nested RUN_MCTS scopes, the way a recursive function would. */
+static void enterNested(int depth) {
+	PROFILE_SCOPE(RUN_MCTS);
+	if (depth > 1) {
+		enterNested(depth - 1);
+	}
+}
+
+
+void testScopesProfiler() {
+
+	bool was_on = profiler_on;
+	profiler_on = true;
+
+	// nested and re-entrant scopes are all counted
+	uint64_t before = profiler.count(PROFILE_RUN_MCTS);
+	enterNested(5);
+	ASSERT(profiler.count(PROFILE_RUN_MCTS) == before + 5, "Each nested scope should be counted");
+
+	// scopes opened while the profiler is off are not
+	profiler_on = false;
+	enterNested(3);
+	ASSERT(profiler.count(PROFILE_RUN_MCTS) == before + 5, "Scopes should not be counted while the profiler is off");
+
+	profiler_on = was_on;
+
+}
+
+
+void testThreadsProfiler() {
+
+	bool was_on = profiler_on;
+	profiler_on = true;
+
+	// the counts of threads that have exited are kept, and merged with the running ones
+	uint64_t before = profiler.count(PROFILE_UPDATE_STATS);
+	thread workers[4];
+	for (int t = 0; t < 4; t++) {
+		workers[t] = thread([] {
+			for (int i = 0; i < 100; i++) {
+				PROFILE_SCOPE(UPDATE_STATS);
+			}
+		});
+	}
+	for (int t = 0; t < 4; t++) {
+		workers[t].join();
+	}
+	{
+		PROFILE_SCOPE(UPDATE_STATS);
+	}
+	ASSERT(profiler.count(PROFILE_UPDATE_STATS) == before + 401, "Counts from every thread should be merged");
+
+	// the report has a line for each block that was entered
+	stringstream report;
+	profiler.report(report);
+	ASSERT(report.str().find(Profiler::blockName(PROFILE_UPDATE_STATS)) != string::npos, "Report should include updateStats");
+	ASSERT(report.str().find(Profiler::blockName(PROFILE_ROLLOUT_SIMULATION)) == string::npos, "Report should skip blocks never entered");
+
+	profiler_on = was_on;
+
+}
+
+
+void testBucketsProfiler() {
+
+	// buckets are increasing in the number of ticks, with PROFILE_SUB_BUCKETS per power of 2
+	int last_bucket = -1;
+	for (uint64_t ticks = 0; ticks < 100000; ticks++) {
+		int bucket = profileBucket(ticks);
+		ASSERT(bucket == last_bucket || bucket == last_bucket + 1, "Buckets should increase one at a time, at " << ticks << " ticks");
+		last_bucket = bucket;
+	}
+	ASSERT(profileBucket(~0ULL) < PROFILE_NUM_BUCKETS, "The largest tick count should fit in the histogram");
+
+}
+
+
+
+void runProfilerTests() {
+	cout << "Running Profiler Tests..." << endl << endl;
+	testScopesProfiler();
+	testThreadsProfiler();
+	testBucketsProfiler();
+	cout << "Finished running Profiler Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_PROFILER_H
+#define TEST_PROFILER_H
+
+#include "../src/profiler.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runProfilerTests();
+
+#endif
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <math.h>
+#include <set>
+#include <thread>
+
+#include "test_rng.h"
+
+using namespace std;
+
+
+
+void testRngDeterminism() {
+
+	Rng rng(42);
+	Rng same(42);
+	Rng other(43);
+	int num_different = 0;
+	for (int i = 0; i < 1000; i++) {
+		uint64_t x = rng.next();
+		ASSERT(x == same.next(), "Generators with the same seed should draw the same numbers");
+		if (x != other.next()) {
+			num_different++;
+		}
+	}
+	ASSERT(num_different == 1000, "Generators with nearby seeds should draw unrelated numbers");
+
+}
+
+
+void testRngRanges() {
+
+	Rng rng(7);
+	for (uint32_t n : {1, 2, 3, 121, 384, 1000000}) {
+		for (int i = 0; i < 1000; i++) {
+			ASSERT(rng.uniformInt(n) < n, "uniformInt(" << n << ") should be in range");
+		}
+	}
+
+	// each of six outcomes should come up about as often as the others
+	int num_draws = 60000;
+	vector<int> counts(6, 0);
+	for (int i = 0; i < num_draws; i++) {
+		counts[rng.uniformInt(6)]++;
+	}
+	for (int count : counts) {
+		ASSERT(fabs(count - num_draws / 6.0) < 600, "uniformInt should be uniform, but an outcome came up " << count << " times");
+	}
+
+	double total = 0;
+	for (int i = 0; i < num_draws; i++) {
+		double x = rng.uniformDouble();
+		ASSERT(0 <= x && x < 1, "uniformDouble should be in [0, 1), not " << x);
+		total += x;
+	}
+	ASSERT(fabs(total / num_draws - 0.5) < 0.01, "uniformDouble should have a mean of 0.5, not " << total / num_draws);
+
+}
+
+
+void testRngSplit() {
+
+	// the child continues the parent's stream, and the parent jumps to a new one
+	Rng parent(11);
+	Rng copy = parent;
+	Rng child = parent.split();
+	set<uint64_t> child_numbers;
+	for (int i = 0; i < 1000; i++) {
+		uint64_t x = child.next();
+		ASSERT(x == copy.next(), "A split off generator should continue its parent's stream");
+		child_numbers.insert(x);
+	}
+	for (int i = 0; i < 1000; i++) {
+		ASSERT(child_numbers.count(parent.next()) == 0, "A parent and its split off generator should not draw the same numbers");
+	}
+
+	// jumping is deterministic
+	Rng jumped(11);
+	jumped.jump();
+	Rng jumped_again(11);
+	jumped_again.jump();
+	ASSERT(jumped.next() == jumped_again.next(), "Jumps from the same state should reach the same state");
+
+}
+
+
+/* Draws a number on a new thread, whose generator is split off from the calling thread's. */
+static void drawOnThread(Rng rng, uint64_t* number) {
+	setThreadRng(rng);
+	*number = threadRng().next();
+}
+
+void testSeedRng() {
+
+	// seeding the run again repeats the numbers of the calling thread, and of the threads it starts
+	uint64_t numbers[2][3];
+	for (int run = 0; run < 2; run++) {
+		seedRng(1234);
+		numbers[run][0] = threadRng().next();
+		thread worker(drawOnThread, threadRng().split(), &numbers[run][1]);
+		worker.join();
+		numbers[run][2] = threadRng().next();
+	}
+	for (int i = 0; i < 3; i++) {
+		ASSERT(numbers[0][i] == numbers[1][i], "Runs with the same seed should draw the same numbers");
+	}
+	ASSERT(numbers[0][0] != numbers[0][1], "A new thread should draw from a stream of its own");
+
+}
+
+
+/* Returns the root action counts of a search of an empty 5x5 board, with NUM_TREES trees searched one thread each. */
+static vector<int> seededSearch(uint64_t seed, int num_trees) {
+	seedRng(seed);
+	vector<int> board(25, 0);
+	MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, 200, true, false, true,
+		DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, true, DEFAULT_VIRTUAL_LOSS, 4 /* rollouts_per_leaf */);
+	vector<int> action_counts;
+	vector<double> mean_rewards;
+	root = runEnsembleSimulations(root, num_trees, 3, &action_counts, &mean_rewards);
+	delete root;
+	return action_counts;
+}
+
+void testSeededSearch() {
+
+	// every random choice of a search (sampled actions, rollouts, batch rollouts) comes from the seeded generators
+	for (int num_trees : {1, 3}) {
+		vector<int> action_counts = seededSearch(99, num_trees);
+		ASSERT(action_counts == seededSearch(99, num_trees), "Searches with the same seed should be identical");
+		ASSERT(action_counts != seededSearch(100, num_trees), "Searches with different seeds should differ");
+	}
+
+}
+
+
+
+void runRngTests() {
+	cout << "Running RNG Tests..." << endl << endl;
+	testRngDeterminism();
+	testRngRanges();
+	testRngSplit();
+	testSeedRng();
+	testSeededSearch();
+	cout << "Finished running RNG Tests." << endl << endl;
+}
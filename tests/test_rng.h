@@ -0,0 +1,12 @@
+#ifndef TEST_RNG_H
+#define TEST_RNG_H
+
+#include "../src/rng.h"
+#include "../src/mcts.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runRngTests();
+
+#endif
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <thread>
+
+#include "test_task_scheduler.h"
+
+using namespace std;
+
+
+
+void testTaskSchedulerBlocks() {
+
+	// 10 tasks over 3 workers: blocks of 4, 3 and 3, with none left out
+	TaskScheduler scheduler(3, 10);
+	vector<int> expected_firsts = {0, 4, 7};
+	for (int worker = 0; worker < 3; worker++) {
+		int task = scheduler.nextTask(worker);
+		ASSERT(task == expected_firsts[worker], "Worker " << worker << " should start at task " << expected_firsts[worker] << ", not " << task);
+	}
+	ASSERT(scheduler.nextTask(0) == 1, "A worker should take its own tasks in order");
+	ASSERT(scheduler.numStolen() == 0, "Nothing should be stolen while every worker has tasks of its own");
+
+	TaskScheduler empty(4, 0);
+	for (int worker = 0; worker < 4; worker++) {
+		ASSERT(empty.nextTask(worker) == -1, "A scheduler with no tasks should hand none out");
+	}
+
+	// more workers than tasks: the workers without a block of their own steal
+	TaskScheduler few(4, 2);
+	ASSERT(few.nextTask(3) != -1 && few.nextTask(2) != -1, "Workers without tasks of their own should steal them");
+	ASSERT(few.nextTask(0) == -1 && few.nextTask(1) == -1, "Each task should only be handed out once");
+
+}
+
+
+void testTaskSchedulerStealing() {
+
+	// worker 1 runs through its own block of 5, then steals the back half of worker 0's untouched block, in order
+	TaskScheduler scheduler(2, 10);
+	for (int task = 5; task < 10; task++) {
+		ASSERT(scheduler.nextTask(1) == task, "Worker 1 should take its own block first");
+	}
+	vector<int> expected = {2, 3, 4};
+	for (int task : expected) {
+		ASSERT(scheduler.nextTask(1) == task, "Worker 1 should take the stolen tasks in order");
+	}
+	ASSERT(scheduler.numStolen() == 3, "Worker 1 should have stolen 3 tasks, not " << scheduler.numStolen());
+
+	// worker 0 still has the front of its block, and the last task is stolen back and forth until one of them takes it
+	ASSERT(scheduler.nextTask(0) == 0, "Worker 0 should keep the front of its block");
+	ASSERT(scheduler.nextTask(1) == 1, "Worker 1 should steal the last task");
+	ASSERT(scheduler.nextTask(0) == -1 && scheduler.nextTask(1) == -1, "Every task should have been handed out");
+
+}
+
+
+/* Takes tasks from SCHEDULER as WORKER until there are none left, marking each one in TIMES_HANDED_OUT. */
+void takeTasks(TaskScheduler* scheduler, int worker, vector<int>* times_handed_out) {
+	for (int task = scheduler->nextTask(worker); task != -1; task = scheduler->nextTask(worker)) {
+		// uneven work, so that the workers that finish first steal from the rest
+		if (worker == 0) {
+			this_thread::yield();
+		}
+		(*times_handed_out)[task]++;
+	}
+}
+
+
+void testTaskSchedulerThreads() {
+
+	int num_workers = 4;
+	int num_tasks = 1001;
+	TaskScheduler scheduler(num_workers, num_tasks);
+	vector<vector<int>> times_handed_out(num_workers, vector<int>(num_tasks, 0));
+	vector<thread> workers;
+	for (int worker = 0; worker < num_workers; worker++) {
+		workers.push_back(thread(takeTasks, &scheduler, worker, &times_handed_out[worker]));
+	}
+	for (int worker = 0; worker < num_workers; worker++) {
+		workers[worker].join();
+	}
+
+	for (int task = 0; task < num_tasks; task++) {
+		int total = 0;
+		for (int worker = 0; worker < num_workers; worker++) {
+			total += times_handed_out[worker][task];
+		}
+		ASSERT(total == 1, "Task " << task << " was handed out " << total << " times, instead of once");
+	}
+
+}
+
+
+
+void runTaskSchedulerTests() {
+	cout << "Running Task Scheduler Tests..." << endl << endl;
+	testTaskSchedulerBlocks();
+	testTaskSchedulerStealing();
+	testTaskSchedulerThreads();
+	cout << "Finished running Task Scheduler Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_TASK_SCHEDULER_H
+#define TEST_TASK_SCHEDULER_H
+
+#include "../src/task_scheduler.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runTaskSchedulerTests();
+
+#endif
@@ -6,6 +6,7 @@
 #include <chrono> // sleep
 #include <thread>
 #include <fstream>
+#include <unistd.h> // getpid
 
 
 
@@ -74,6 +75,12 @@ void threadManagerSimulation(string infile, int num_nodes, int minibatch_size, i
 	// register this thread for logging
 	data->registerThreadName(this_thread::get_id(), "Master");
 
+	// serve the NN queries with a stub evaluator, over the same socket protocol as a real evaluator process
+	string socket_path = "/tmp/hexit_thread_manager_" + to_string(getpid()) + ".sock";
+	StubRowEvaluator stub_evaluator(9);
+	EvaluatorServer server(&stub_evaluator, socket_path);
+	EvaluatorClient evaluator(socket_path);
+
 	// Spawn worker threads
 	thread worker_threads[num_threads];
 	for (int thread_num = 0; thread_num < num_threads; thread_num++) {
@@ -93,18 +100,8 @@ void threadManagerSimulation(string infile, int num_nodes, int minibatch_size, i
 
 		int round = rounds_per_minibatch->at(minibatch_num);
 
-		string state_vector_file = "data/tmp/state_vectors_" + to_string(round) + "_" + to_string(minibatch_num);
-		string action_distribution_file = "data/tmp/action_distributions_" + to_string(round) + "_" + to_string(minibatch_num);
-
-		// read the NN queue for this minibatch and write it into a file
-		data->serializeNNQueue(minibatch_num, state_vector_file);
-
-		// fork a new process and exec the NN script in that process
-		// the NN script will read from the state vectors file, and write to the action distributions file
-		data->invokePythonScript("src/script.py", state_vector_file, action_distribution_file);
-
-		// read in the resulting NN action distributions and write them into the NN output queue
-		data->deserializeNNResults(minibatch_num, action_distribution_file, round);
+		// send the NN queue for this minibatch to the evaluator, and write the resulting action distributions into the NN output queue
+		data->evaluateNNQueue(minibatch_num, &evaluator, round);
 
 		rounds_per_minibatch->at(minibatch_num)++;
 
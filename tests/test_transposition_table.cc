@@ -0,0 +1,120 @@
+#include <iostream>
+#include <stdint.h>
+#include <set>
+
+#include "test_transposition_table.h"
+
+using namespace std;
+
+
+
+void testInsertTranspositionTable() {
+
+	TranspositionTable table(100);
+	ASSERT(table.capacity() == 128 && table.size() == 0, "Capacity should be rounded up to a power of 2");
+
+	// the table never dereferences its nodes, so any distinct addresses will do
+	MCTS_Node* nodes = (MCTS_Node*) new char[sizeof(MCTS_Node) * 4];
+	ASSERT(table.lookup(42) == NULL, "Empty table should have no entries");
+	ASSERT(table.insert(42, &nodes[0]), "Insert into an empty table should succeed");
+	ASSERT(!table.insert(42, &nodes[1]), "Inserting a hash twice should fail");
+	ASSERT(table.lookup(42) == &nodes[0], "Lookup should return the first node inserted");
+
+	// hashes that collide on their slot are probed past each other, and hash 0 is a valid hash
+	ASSERT(table.insert(42 + 128, &nodes[1]) && table.insert(0, &nodes[2]), "Colliding inserts should succeed");
+	ASSERT(table.lookup(42 + 128) == &nodes[1] && table.lookup(0) == &nodes[2] && table.lookup(42) == &nodes[0], "Colliding hashes should keep their own nodes");
+	ASSERT(table.size() == 3, "Table should have 3 entries");
+
+	table.clear();
+	ASSERT(table.size() == 0 && table.lookup(42) == NULL, "Clear should remove every entry");
+
+	// inserts fail once the table is three quarters full
+	int num_inserted = 0;
+	for (uint64_t hash = 1; hash <= 128; hash++) {
+		num_inserted += table.insert(hash * 7919, &nodes[3]);
+	}
+	ASSERT(num_inserted == 96 && table.size() == 96, "Table should stop inserting at three quarters full, not " << num_inserted);
+
+	delete[] (char*) nodes;
+}
+
+
+void testTranspositionsMCTS() {
+
+	// (0, 1, 2) and (2, 1, 0) reach the same position: player 1 on cells 0 and 2, player 2 on cell 1
+	vector<int> board(9, 0);
+	MCTS_Node* root = new MCTS_Node(new HexState(3, board, "win_fast"), true, 100, true, false, false,
+		DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, false, true /* use_transpositions */);
+	MCTS_Node* node = root->makeChild(0)->makeChild(1)->makeChild(2);
+	MCTS_Node* transposed = root->makeChild(2)->makeChild(1)->makeChild(0);
+	ASSERT(node == transposed, "Transposed move orders should share a node");
+	ASSERT(root->getChild(2)->getChild(1)->getChild(0) == node, "The shared node should be a child of both parents");
+	ASSERT(root->makeChild(0)->makeChild(2) != root->makeChild(2)->makeChild(0), "Different positions should not share a node");
+
+	// a stone in a corner, and one in the opposite corner, are the same position rotated by 180 degrees
+	MCTS_Node* rotated = root->makeChild(8);
+	ASSERT(rotated == root->getChild(0), "Rotated positions should share a node");
+	ASSERT(root->getEdgeSymmetry(8) != rotated->getSymmetry() && root->getEdgeSymmetry(0) == rotated->getSymmetry(),
+		"The rotated edge should lead to a position in a different frame from the shared node's state");
+	delete root;
+
+	// a search never makes two nodes for the same position (or symmetric ones), and every simulation still reaches the root exactly once
+	for (bool use_rave : {false, true}) {
+		vector<int> board(25, 0);
+		MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, 300, true, false, use_rave,
+			DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, true /* use_transpositions */);
+		for (int sim = 0; sim < 300; sim++) {
+			MCTS_Node* node = root;
+			while (node->getDepth() < 6 && !node->isTerminal()) {
+				node = node->chooseBestAction();
+			}
+			MCTS_Node* returned = node->isTerminal() ? propagateStats(node) : rolloutSimulation(node);
+			ASSERT(returned == root && root->getPath()->empty(), "Stats propagation should walk the whole path back to the root");
+		}
+		ASSERT(root->numSimulationsFinished() == 300, "Search should finish all of its simulations");
+
+		vector<int> action_counts(25, 0);
+		root->getActionCounts(&action_counts);
+		int total_count = 0;
+		for (int count : action_counts) {
+			total_count += count;
+		}
+		ASSERT(total_count == 300, "Every simulation should update the root once, not " << total_count << " times");
+
+		// walk the graph, visiting each node once
+		set<MCTS_Node*> nodes;
+		set<uint64_t> hashes;
+		vector<MCTS_Node*> stack = {root};
+		while (!stack.empty()) {
+			MCTS_Node* node = stack.back();
+			stack.pop_back();
+			if (!nodes.insert(node).second) {
+				continue;
+			}
+			hashes.insert(node->getState()->canonicalHash());
+			for (int edge = 0; edge < node->getNumEdges(); edge++) {
+				MCTS_Node* child = node->getChild(node->getEdgeAction(edge));
+				if (child != NULL) {
+					stack.push_back(child);
+				}
+			}
+		}
+		ASSERT(nodes.size() > 300 && hashes.size() == nodes.size(), "Each class of symmetric positions should have one node, but "
+			<< nodes.size() << " nodes hold " << hashes.size() << " positions");
+		ASSERT(root->getTranspositions()->size() == nodes.size() - 1, "Every node below the root should be in the table");
+
+		root->deleteTree();
+		ASSERT(root->getTranspositions() == NULL, "Deleting the tree should free its table");
+		delete root;
+	}
+
+}
+
+
+
+void runTranspositionTableTests() {
+	cout << "Running Transposition Table Tests..." << endl << endl;
+	testInsertTranspositionTable();
+	testTranspositionsMCTS();
+	cout << "Finished running Transposition Table Tests." << endl << endl;
+}
@@ -0,0 +1,12 @@
+#ifndef TEST_TRANSPOSITION_TABLE_H
+#define TEST_TRANSPOSITION_TABLE_H
+
+#include "../src/transposition_table.h"
+#include "../src/mcts.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runTranspositionTableTests();
+
+#endif
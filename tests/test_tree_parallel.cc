@@ -0,0 +1,243 @@
+#include <iostream>
+#include <thread>
+#include <math.h>
+
+#include "test_tree_parallel.h"
+
+using namespace std;
+
+
+
+/**
+ * Checks that the stats of every edge below NODE add up to the stats of the child it leads to: every simulation through
+ * an edge updates the child once, with the same reward.  Any lost update, or virtual loss left behind, breaks this.
+ * Only holds without transpositions (where a child can have several parents).
+ */
+static void checkStatsAddUp(MCTS_Node* node) {
+	for (int edge = 0; edge < node->getNumEdges(); edge++) {
+		MCTS_Node* child = node->getChild(node->getEdgeAction(edge));
+		if (child == NULL || child->isTerminal()) {
+			continue;
+		}
+		uint32_t child_traversals = 0;
+		double child_rewards = 0;
+		for (int child_edge = 0; child_edge < child->getNumEdges(); child_edge++) {
+			child_traversals += child->edgeTraversals()[child_edge];
+			child_rewards += child->edgeRewards()[child_edge];
+		}
+		uint32_t traversals = node->edgeTraversals()[edge];
+		ASSERT(child_traversals == traversals, "An edge was taken " << traversals << " times, but its child was updated " << child_traversals << " times");
+		ASSERT(fabs(child_rewards - node->edgeRewards()[edge]) < 1e-3 * (traversals + 1), "An edge's reward should be the sum of its child's rewards");
+		checkStatsAddUp(child);
+	}
+}
+
+
+void testVirtualLossTreeParallel() {
+
+	vector<int> board(9, 0);
+	MCTS_Node* root = new MCTS_Node(new HexState(3, board, "win_fast"), true, 10, false /* sample_actions */, false, false,
+		DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, false /* use_transpositions */);
+	root->setConcurrent(true);
+
+	// with every score equal, the first edge is the best, until a virtual loss is counted on it
+	vector<PathStep> first_path;
+	vector<PathStep> second_path;
+	MCTS_Node* first = root->chooseBestAction(&first_path);
+	ASSERT(root->edgeTraversals()[0] == 1 && root->edgeRewards()[0] == -DEFAULT_VIRTUAL_LOSS, "Selection should count a virtual loss");
+	MCTS_Node* second = root->chooseBestAction(&second_path);
+	ASSERT(first != second, "Virtual loss should steer a second simulation away from the first one's edge");
+	ASSERT(first_path.size() == 1 && second_path.size() == 1, "Each simulation should keep its own path");
+
+	// finishing the simulations (in either order) takes the virtual losses back out
+	ASSERT(rolloutSimulation(second, &second_path) == root, "Rollout should return the root");
+	ASSERT(rolloutSimulation(first, &first_path) == root, "Rollout should return the root");
+	ASSERT(first_path.empty() && second_path.empty(), "Stats propagation should empty the paths");
+	ASSERT(root->edgeTraversals()[0] == 1 && root->edgeTraversals()[1] == 1, "Each edge should have been taken once");
+	checkStatsAddUp(root);
+	ASSERT(root->numSimulationsFinished() == 2, "Both simulations should have finished");
+
+	root->setConcurrent(false);
+	delete root;
+}
+
+
+void testStatsTreeParallel() {
+
+	int num_simulations = 2000;
+	for (bool use_rave : {false, true}) {
+		vector<int> board(25, 0);
+		MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations, true, false, use_rave,
+			DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, false /* use_transpositions */);
+
+		// search the tree from several threads, as runAllSimulations does, but keep the tree to check it
+		root->setConcurrent(true);
+		auto search = [root]() {
+			vector<PathStep> path;
+			while (root->claimSimulation()) {
+				MCTS_Node* node = root;
+				while (!node->isTerminal() && node->getDepth() < 5) {
+					node = node->chooseBestAction(&path);
+				}
+				if (node->isTerminal()) {
+					propagateStats(node, &path);
+				} else {
+					rolloutSimulation(node, &path);
+				}
+			}
+		};
+		vector<thread> threads;
+		for (int thread_num = 0; thread_num < 4; thread_num++) {
+			threads.push_back(thread(search));
+		}
+		for (thread& t : threads) {
+			t.join();
+		}
+		root->setConcurrent(false);
+
+		ASSERT(root->numSimulationsFinished() == num_simulations, "Threads should run exactly " << num_simulations << " simulations, not " << root->numSimulationsFinished());
+		uint32_t root_traversals = 0;
+		for (int edge = 0; edge < root->getNumEdges(); edge++) {
+			root_traversals += root->edgeTraversals()[edge];
+		}
+		ASSERT(root_traversals == num_simulations, "Every simulation should update the root once");
+		checkStatsAddUp(root);
+		delete root;
+	}
+
+	// runAllSimulations does the same, with or without transpositions, and frees the tree afterwards
+	for (bool use_transpositions : {false, true}) {
+		vector<int> board(25, 0);
+		MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations, true, false, true,
+			DEFAULT_C_B, DEFAULT_C_RAVE, DEFAULT_W_A, true, use_transpositions);
+		runAllSimulations(root, 5, 4);
+		ASSERT(root->numSimulationsFinished() == num_simulations, "runAllSimulations should finish every simulation");
+		vector<int> action_counts(25, 0);
+		root->getActionCounts(&action_counts);
+		int total_count = 0;
+		for (int count : action_counts) {
+			total_count += count;
+		}
+		ASSERT(total_count == num_simulations, "Every simulation should update the root once");
+		ASSERT(!root->getConfig()->concurrent, "The tree should no longer be marked concurrent");
+		delete root;
+	}
+
+}
+
+
+void testEnsembleSearch() {
+
+	int num_simulations = 500;
+	vector<int> board(25, 0);
+	MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations);
+
+	// a copy of a root has the same config, and an empty tree of its own
+	MCTS_Node* copy = root->copyRoot();
+	ASSERT(copy->isRoot() && copy->getArena() != root->getArena(), "A copied root should have a tree of its own");
+	ASSERT(copy->getState() != root->getState() && copy->getState()->numActions() == 25, "A copied root should copy the state");
+	ASSERT(copy->usesRave() == root->usesRave() && copy->getConfig()->c_b == root->getConfig()->c_b, "A copied root should have the same config");
+	ASSERT(copy->numSimulationsFinished() == 0 && !copy->simulationsFinished(), "A copied root should have all of its simulations to run");
+	delete copy;
+
+	// an ensemble of one tree is just that tree
+	vector<int> action_counts;
+	vector<double> mean_rewards;
+	root = runEnsembleSimulations(root, 1, 4, &action_counts, &mean_rewards);
+	vector<int> root_counts(25, 0);
+	vector<double> root_means(25, 0.0);
+	root->getActionCounts(&root_counts);
+	root->getMeanRewards(&root_means);
+	ASSERT(action_counts == root_counts, "A single tree's counts should be its root's");
+	for (int action = 0; action < 25; action++) {
+		ASSERT(fabs(mean_rewards[action] - root_means[action]) < 1e-6, "A single tree's mean rewards should be its root's");
+	}
+
+	// adding a root's stats to themselves doubles the counts, but leaves the means as they are
+	vector<int> doubled_counts(25, 0);
+	vector<double> doubled_rewards(25, 0.0);
+	root->addActionStats(&doubled_counts, &doubled_rewards);
+	root->addActionStats(&doubled_counts, &doubled_rewards);
+	for (int action = 0; action < 25; action++) {
+		ASSERT(doubled_counts[action] == 2 * root_counts[action], "Adding stats should sum the counts");
+		if (doubled_counts[action] > 0) {
+			ASSERT(fabs(doubled_rewards[action] / doubled_counts[action] - root_means[action]) < 1e-6, "Adding stats should sum the rewards");
+		}
+	}
+	delete root;
+
+	// every tree of a larger ensemble runs all of its simulations, and the merged counts cover all of them
+	for (int num_threads_per_tree : {1, 2}) {
+		root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations);
+		root = runEnsembleSimulations(root, 4, 4, &action_counts, &mean_rewards, num_threads_per_tree);
+		ASSERT(root->numSimulationsFinished() == num_simulations, "The root's own tree should run all of its simulations");
+		int total_count = 0;
+		for (int action = 0; action < 25; action++) {
+			total_count += action_counts[action];
+			ASSERT(fabs(mean_rewards[action]) <= 1, "Merged mean rewards should be normalized, not " << mean_rewards[action]);
+		}
+		ASSERT(total_count == 4 * num_simulations, "The merged counts should cover every tree's simulations, not " << total_count);
+		delete root;
+	}
+
+}
+
+
+
+void testInFlightEvaluations() {
+
+	int num_simulations = 200;
+	int max_in_flight = 8;
+	vector<int> board(25, 0);
+	MCTS_Node* root = new MCTS_Node(new HexState(5, board, "win_fast"), true, num_simulations, false /* sample_actions */,
+		true /* requires_nn */);
+
+	// the first simulation waits on the root's prior, and the rest collide with it until the prior arrives
+	vector<PendingEvaluation> in_flight;
+	int num_rounds = 0;
+	int most_in_flight = 0;
+	while (runMCTSInFlight(root, 3, max_in_flight, &in_flight) > 0) {
+		ASSERT(in_flight.size() <= max_in_flight, "At most " << max_in_flight << " simulations should be in flight, not " << in_flight.size());
+		most_in_flight = max(most_in_flight, (int) in_flight.size());
+		if (num_rounds == 0) {
+			ASSERT(in_flight.size() == 1 && in_flight[0].node == root, "Only the root should wait on the NN at first");
+		}
+
+		// give every waiting node a uniform prior, as the NN would.  no two simulations should wait on the same node
+		for (int i = 0; i < in_flight.size(); i++) {
+			MCTS_Node* node = in_flight[i].node;
+			ASSERT(node->awaitingNNResults(), "A node in flight should be waiting on its prior");
+			for (int j = 0; j < i; j++) {
+				ASSERT(in_flight[j].node != node, "Two simulations should not wait on the same node");
+			}
+			node->setNNActionDistribution(new ActionDistribution(new vector<double>(25, 1.0 / 25)));
+			node->markReceivedNNResults();
+		}
+		num_rounds++;
+	}
+	ASSERT(most_in_flight == max_in_flight, "Virtual loss should spread the simulations out enough to fill the batch");
+	ASSERT(num_rounds < num_simulations / 2, "Simulations in flight together should need fewer rounds, not " << num_rounds);
+
+	// every simulation finished once, and every virtual loss of an abandoned one was taken back out
+	ASSERT(root->simulationsFinished() && root->numSimulationsFinished() == num_simulations, "Every simulation should have finished");
+	ASSERT(!root->getConfig()->concurrent, "The tree should no longer be concurrent once no simulations are in flight");
+	uint32_t root_traversals = 0;
+	for (int edge = 0; edge < root->getNumEdges(); edge++) {
+		root_traversals += root->edgeTraversals()[edge];
+		ASSERT(fabs(root->edgeRewards()[edge]) <= root->edgeTraversals()[edge], "Each edge's reward should be within its number of traversals");
+	}
+	ASSERT(root_traversals == num_simulations, "The root's edges should have been taken " << num_simulations << " times, not " << root_traversals);
+
+	delete root;
+}
+
+
+
+void runTreeParallelTests() {
+	cout << "Running Tree Parallel Tests..." << endl << endl;
+	testVirtualLossTreeParallel();
+	testStatsTreeParallel();
+	testEnsembleSearch();
+	testInFlightEvaluations();
+	cout << "Finished running Tree Parallel Tests." << endl << endl;
+}
@@ -0,0 +1,11 @@
+#ifndef TEST_TREE_PARALLEL_H
+#define TEST_TREE_PARALLEL_H
+
+#include "../src/mcts.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runTreeParallelTests();
+
+#endif
@@ -0,0 +1,135 @@
+#include <iostream>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "test_uct_kernel.h"
+
+using namespace std;
+
+
+// 19 edges, so the AVX2 kernels run two full blocks of 8 and a scalar tail
+const int NUM_TEST_EDGES = 19;
+
+static bool closeTo(double a, double b) {
+	return fabs(a - b) <= 1e-5 * (1 + fabs(b));
+}
+
+
+
+void testScoreUCTKernel() {
+
+	uint32_t visits[NUM_TEST_EDGES];
+	float rewards[NUM_TEST_EDGES];
+	uint32_t node_visits = 0;
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		visits[e] = (e % 3 == 0) ? 0 : rand() % 50;
+		rewards[e] = visits[e] * (((rand() % 200) - 100) / 100.0);
+		node_visits += visits[e];
+	}
+	EdgeStats stats;
+	stats.num_edges = NUM_TEST_EDGES;
+	stats.node_visits = node_visits;
+	stats.visits = visits;
+	stats.rewards = rewards;
+
+	float scores[NUM_TEST_EDGES];
+	for (int turn = -1; turn <= 1; turn += 2) {
+		scoreUCT(stats, turn, 0.25, scores);
+		for (int e = 0; e < NUM_TEST_EDGES; e++) {
+			double mean = (visits[e] == 0) ? 0 : (turn * rewards[e]) / visits[e];
+			double expected = mean + 0.25 * sqrt(log(node_visits) / (visits[e] + 1.0));
+			ASSERT(closeTo(scores[e], expected), "UCT score of edge " << e << " is " << scores[e] << ", not " << expected);
+		}
+	}
+
+	// an unvisited node scores every edge 0
+	stats.node_visits = 0;
+	scoreUCT(stats, 1, 0.25, scores);
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		ASSERT(scores[e] == 0, "Edges of an unvisited node should score 0");
+	}
+
+}
+
+
+void testBlendAndPriorKernel() {
+
+	float scores[NUM_TEST_EDGES];
+	float rave_scores[NUM_TEST_EDGES];
+	float prior[NUM_TEST_EDGES];
+	uint32_t visits[NUM_TEST_EDGES];
+	float expected[NUM_TEST_EDGES];
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		scores[e] = e * 0.1;
+		rave_scores[e] = 1 - e * 0.05;
+		prior[e] = 1.0 / NUM_TEST_EDGES;
+		visits[e] = e;
+		expected[e] = (0.3 * rave_scores[e]) + (0.7 * scores[e]);
+		expected[e] += 2.0 * prior[e] / (visits[e] + 1.0);
+	}
+
+	blendScores(NUM_TEST_EDGES, 0.3, rave_scores, scores);
+	addPriorScores(NUM_TEST_EDGES, 2.0, prior, visits, scores);
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		ASSERT(closeTo(scores[e], expected[e]), "Blended score of edge " << e << " is " << scores[e] << ", not " << expected[e]);
+	}
+
+}
+
+
+void testArgmaxKernel() {
+
+	float scores[NUM_TEST_EDGES];
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		scores[e] = -1;
+	}
+	ASSERT(argmaxScore(NUM_TEST_EDGES, scores) == 0, "Argmax of equal scores should be the first edge");
+
+	// the max can be in any block, including the tail; ties go to the first edge
+	for (int best = 0; best < NUM_TEST_EDGES; best++) {
+		scores[best] = 5;
+		ASSERT(argmaxScore(NUM_TEST_EDGES, scores) == best, "Argmax should be edge " << best);
+		scores[NUM_TEST_EDGES - 1] = 5;
+		ASSERT(argmaxScore(NUM_TEST_EDGES, scores) == best, "Argmax should break ties towards edge " << best);
+		scores[best] = -1;
+		scores[NUM_TEST_EDGES - 1] = -1;
+	}
+	ASSERT(argmaxScore(3, scores) == 0, "Argmax should work on fewer than 8 edges");
+
+}
+
+
+void testSampleSoftmaxKernel() {
+
+	float scores[NUM_TEST_EDGES];
+	float weights[NUM_TEST_EDGES];
+
+	// with two edges whose weights are 1 : 3, the first gets a quarter of the uniform range
+	scores[0] = 0;
+	scores[1] = log(3.0) / log(UCT_SOFTMAX_BASE);
+	ASSERT(sampleSoftmaxScore(2, scores, 0.0, weights) == 0, "Sample at 0 should be the first edge");
+	ASSERT(sampleSoftmaxScore(2, scores, 0.24, weights) == 0, "Sample at 0.24 should be the first edge");
+	ASSERT(sampleSoftmaxScore(2, scores, 0.26, weights) == 1, "Sample at 0.26 should be the second edge");
+	ASSERT(sampleSoftmaxScore(2, scores, 0.999999, weights) == 1, "Sample near 1 should be the last edge");
+	ASSERT(closeTo(weights[0] * 3, weights[1]), "Softmax weights should be proportional to base ^ score");
+
+	// large scores do not overflow
+	for (int e = 0; e < NUM_TEST_EDGES; e++) {
+		scores[e] = 1000 + e;
+	}
+	int edge = sampleSoftmaxScore(NUM_TEST_EDGES, scores, 0.999999, weights);
+	ASSERT(edge == NUM_TEST_EDGES - 1, "Sample near 1 should be the last edge, not " << edge);
+
+}
+
+
+
+void runUCTKernelTests() {
+	cout << "Running UCT Kernel Tests (AVX2 " << (uctKernelUsesAVX2() ? "on" : "off") << ")..." << endl << endl;
+	testScoreUCTKernel();
+	testBlendAndPriorKernel();
+	testArgmaxKernel();
+	testSampleSoftmaxKernel();
+	cout << "Finished running UCT Kernel Tests." << endl << endl;
+}
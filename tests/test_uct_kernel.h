@@ -0,0 +1,11 @@
+#ifndef TEST_UCT_KERNEL_H
+#define TEST_UCT_KERNEL_H
+
+#include "../src/uct_kernel.h"
+#include "test_utils.h"
+
+using namespace std;
+
+void runUCTKernelTests();
+
+#endif